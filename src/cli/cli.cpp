@@ -1,8 +1,18 @@
 #include "cli.h"
 #include "../core/core.h"
+#include "../models/ModelBackend.h"
+#include "../queue/queue_log.h"
+#include "../queue/spool.h"
 #include "../ui/SchedulerUI.h"
+#include "../utils/batch_io.h"
 #include "../utils/json_utils.h"
+#include "../utils/ndjson.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
 #include <iostream>
+#include <unordered_map>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -10,9 +20,233 @@
 #include <fstream>
 #include <filesystem>
 
+namespace {
+
+// Same switch the coordinator reads: queue.backend=log in .quanta.
+bool usingQueueLog() { return ModelBackend().config_value("queue.backend", "files") == "log"; }
+
+// Splits CSV into records of fields (RFC 4180 quoting; a quoted field may
+// span lines). lines receives the 1-based line each record starts on.
+void splitCsv(std::string_view input, std::vector<std::vector<std::string>>& records, std::vector<size_t>& lines) {
+    size_t line = 1;
+    size_t i = 0;
+    while (i < input.size()) {
+        if (input[i] == '\n' || input[i] == '\r') { // blank line
+            if (input[i] == '\n') ++line;
+            ++i;
+            continue;
+        }
+        records.emplace_back(1);
+        lines.push_back(line);
+        std::vector<std::string>& fields = records.back();
+        bool quoted = false;
+        for (; i < input.size(); ++i) {
+            char c = input[i];
+            if (quoted) {
+                if (c == '"' && i + 1 < input.size() && input[i + 1] == '"') fields.back() += input[++i];
+                else if (c == '"') quoted = false;
+                else {
+                    if (c == '\n') ++line;
+                    fields.back() += c;
+                }
+            } else if (c == '"') {
+                quoted = true;
+            } else if (c == ',') {
+                fields.emplace_back();
+            } else if (c == '\n') {
+                ++line;
+                ++i;
+                break;
+            } else if (c != '\r') {
+                fields.back() += c;
+            }
+        }
+    }
+}
+
+// Tasks from CSV with a header row naming the columns: task_id, description,
+// priority, component, max_runtime_sec, dependencies (comma-separated within
+// the field), owner, due_date. status is accepted and ignored, so the
+// scheduler's CSV export reads back.
+void parseCsvTasks(std::string_view input, NdjsonBatch& batch) {
+    std::vector<std::vector<std::string>> records;
+    std::vector<size_t> lines;
+    splitCsv(input, records, lines);
+    batch.lines = records.size();
+    if (records.empty()) return;
+    const std::vector<std::string>& header = records[0];
+    for (size_t c = 0; c < header.size(); ++c) {
+        static const char* known[] = {"task_id", "description", "priority", "component", "max_runtime_sec",
+                                      "dependencies", "owner", "due_date", "status"};
+        if (std::find(std::begin(known), std::end(known), header[c]) == std::end(known)) {
+            batch.errors.push_back(NdjsonLineError{lines[0], 0, "unknown column \"" + header[c] + "\""});
+        }
+    }
+    if (!batch.errors.empty()) return;
+    for (size_t r = 1; r < records.size(); ++r) {
+        const std::vector<std::string>& fields = records[r];
+        if (fields.size() != header.size()) {
+            batch.errors.push_back(NdjsonLineError{lines[r], 0, "expected " + std::to_string(header.size()) + " fields, found " + std::to_string(fields.size())});
+            continue;
+        }
+        Task task;
+        bool ok = true;
+        for (size_t c = 0; c < header.size() && ok; ++c) {
+            const std::string& name = header[c];
+            const std::string& value = fields[c];
+            if (name == "task_id") task.task_id = value;
+            else if (name == "description") task.description = value;
+            else if (name == "priority") task.priority = value;
+            else if (name == "component") task.component = value;
+            else if (name == "owner") task.owner = value;
+            else if (name == "due_date") task.due_date = value;
+            else if (name == "dependencies") {
+                std::stringstream ss(value);
+                std::string dep;
+                while (std::getline(ss, dep, ',')) if (!dep.empty()) task.dependencies.push_back(dep);
+            } else if (name == "max_runtime_sec" && !value.empty()) {
+                auto parsed = std::from_chars(value.data(), value.data() + value.size(), task.max_runtime_sec);
+                if (parsed.ec != std::errc() || parsed.ptr != value.data() + value.size()) {
+                    batch.errors.push_back(NdjsonLineError{lines[r], 0, "max_runtime_sec \"" + value + "\" is not a number"});
+                    ok = false;
+                }
+            }
+        }
+        if (!ok) continue;
+        batch.tasks.push_back(std::move(task));
+        batch.task_lines.push_back(lines[r]);
+    }
+}
+
+// Checks what the queue needs of every task: an id usable as a file name,
+// a description, and ids that are unique within the batch and, if pending is
+// set, not already queued there.
+void validateBatch(NdjsonBatch& batch, const std::filesystem::path& pending = {}) {
+    std::unordered_map<std::string_view, size_t> first_line;
+    first_line.reserve(batch.tasks.size());
+    for (size_t i = 0; i < batch.tasks.size(); ++i) {
+        const Task& task = batch.tasks[i];
+        size_t line = batch.task_lines[i];
+        auto error = [&](const std::string& message) { batch.errors.push_back(NdjsonLineError{line, 0, message}); };
+        if (task.task_id.empty()) error("task_id is missing");
+        else if (task.task_id[0] == '.' || task.task_id.find('/') != std::string::npos) error("task_id \"" + task.task_id + "\" cannot be used as a file name");
+        else if (!first_line.emplace(task.task_id, line).second) error("task_id \"" + task.task_id + "\" repeats line " + std::to_string(first_line[task.task_id]));
+        else if (!pending.empty() && std::filesystem::exists(pending / (task.task_id + ".json"))) error("task_id \"" + task.task_id + "\" is already pending");
+        if (task.description.empty()) error("description is missing");
+        if (task.max_runtime_sec < 0) error("max_runtime_sec is negative");
+    }
+    std::stable_sort(batch.errors.begin(), batch.errors.end(), [](const NdjsonLineError& a, const NdjsonLineError& b) { return a.line < b.line; });
+}
+
+// Writes every task to pending/ under a hidden temp name, then renames them
+// all in. A failed write removes the temp files and a failed rename removes
+// the tasks already renamed, so nothing is enqueued unless a coordinator
+// claimed one of them in between.
+bool spoolBatch(const std::filesystem::path& pending, const std::vector<Task>& tasks) {
+    std::filesystem::create_directories(pending);
+    BatchIo io(ModelBackend().config_value("queue.io_uring", "0") == "1" ? 256 : 0);
+    constexpr size_t kChunk = 256; // every file of a chunk is open at once
+    std::vector<std::pair<std::string, std::string>> moves;
+    moves.reserve(tasks.size());
+    std::vector<BatchIo::Write> writes;
+    std::vector<int> errors;
+    std::string failure;
+    for (size_t begin = 0; begin < tasks.size() && failure.empty(); begin += kChunk) {
+        writes.clear();
+        for (size_t i = begin; i < std::min(tasks.size(), begin + kChunk); ++i) {
+            std::string name = tasks[i].task_id + ".json";
+            writes.push_back(BatchIo::Write{(pending / ("." + name + ".tmp")).string(), to_json(tasks[i]) + "\n", {}, {}});
+            moves.emplace_back(writes.back().path, (pending / name).string());
+        }
+        io.write(writes, errors);
+        for (size_t k = 0; k < errors.size() && failure.empty(); ++k) {
+            if (errors[k]) failure = "cannot write " + writes[k].path + ": " + std::strerror(errors[k]);
+        }
+    }
+    if (!failure.empty()) {
+        std::vector<std::string> temps;
+        for (const auto& move : moves) temps.push_back(move.first);
+        io.unlink(temps, errors);
+        std::cerr << failure << "; no tasks added." << std::endl;
+        return false;
+    }
+    io.rename(moves, errors);
+    auto failed = std::find_if(errors.begin(), errors.end(), [](int error) { return error != 0; });
+    if (failed == errors.end()) return true;
+    const auto& move = moves[failed - errors.begin()];
+    failure = "cannot rename " + move.first + ": " + std::strerror(*failed);
+    // Remove each task where it is now: renamed in, or still a temp file.
+    std::vector<int> rename_errors = errors;
+    std::vector<std::string> undo;
+    for (size_t i = 0; i < moves.size(); ++i) undo.push_back(rename_errors[i] ? moves[i].first : moves[i].second);
+    io.unlink(undo, errors);
+    size_t claimed = 0;
+    for (size_t i = 0; i < undo.size(); ++i) claimed += !rename_errors[i] && errors[i] == ENOENT;
+    if (claimed) {
+        std::cerr << failure << "; " << claimed << " of " << moves.size() << " tasks were already claimed and will run, the rest were not added."
+                  << std::endl;
+    } else {
+        std::cerr << failure << "; no tasks added." << std::endl;
+    }
+    return false;
+}
+
+} // namespace
+
+int addTaskBatch(std::string_view input) {
+    NdjsonBatch batch;
+    size_t start = input.find_first_not_of(" \t\r\n");
+    if (start != std::string_view::npos && input[start] == '{') parse_ndjson_tasks(input, batch);
+    else parseCsvTasks(input, batch);
+    const std::filesystem::path pending = "./queue/pending";
+    bool queue_log = usingQueueLog();
+    validateBatch(batch, queue_log ? std::filesystem::path() : pending);
+    if (!batch.errors.empty()) {
+        for (const auto& error : batch.errors) {
+            std::cerr << "line " << error.line;
+            if (error.column) std::cerr << ", column " << error.column;
+            std::cerr << ": " << error.message << "\n";
+        }
+        std::cerr << batch.errors.size() << (batch.errors.size() == 1 ? " error" : " errors") << "; no tasks added." << std::endl;
+        return -1;
+    }
+    if (queue_log) {
+        std::vector<QueueRecord> records;
+        records.reserve(batch.tasks.size());
+        for (const auto& task : batch.tasks) records.push_back(QueueRecord{QueueRecordType::Enqueue, task.task_id, to_json(task)});
+        QueueLog log("./queue/log");
+        // One append: the log commits the batch whole or not at all.
+        if (!log.append(records)) {
+            std::cerr << "Failed to enqueue the batch: " << log.error() << "; no tasks added." << std::endl;
+            return -1;
+        }
+    } else if (!spoolBatch(pending, batch.tasks)) {
+        return -1;
+    }
+    std::cout << batch.tasks.size() << " tasks added to the queue." << std::endl;
+    return static_cast<int>(batch.tasks.size());
+}
+
 void addTask(int argc, char* argv[]) {
+    if (argc >= 3 && std::string(argv[2]) == "--batch") {
+        std::string source = argc > 3 ? argv[3] : "-";
+        std::ostringstream input;
+        if (source == "-") {
+            input << std::cin.rdbuf();
+        } else {
+            std::ifstream file(source, std::ios::binary);
+            if (!file) {
+                std::cerr << "Cannot read " << source << std::endl;
+                exit(1);
+            }
+            input << file.rdbuf();
+        }
+        if (addTaskBatch(input.str()) < 0) exit(1);
+        return;
+    }
     if (argc < 7) {
         std::cerr << "Usage: " << argv[0] << " add <task_id> <description> <priority> <component> <max_runtime_sec> [dependencies]" << std::endl;
+        std::cerr << "       " << argv[0] << " add --batch [-|file]   (NDJSON, or CSV with a header row)" << std::endl;
         exit(1);
     }
     Task task;
@@ -28,31 +262,63 @@ void addTask(int argc, char* argv[]) {
         while (std::getline(ss, dep, ',')) task.dependencies.push_back(dep);
     }
     std::string task_json_str = to_json(task);
+    if (usingQueueLog()) {
+        QueueLog log("./queue/log");
+        if (!log.append(QueueRecord{QueueRecordType::Enqueue, task.task_id, task_json_str})) {
+            std::cerr << "Failed to enqueue task " << task.task_id << ": " << log.error() << std::endl;
+            exit(1);
+        }
+        std::cout << "Task " << task.task_id << " added to the queue." << std::endl;
+        return;
+    }
     std::filesystem::create_directories("./queue/pending");
-    std::string filename = "./queue/pending/" + task.task_id + ".json";
-    std::ofstream o(filename);
-    o << task_json_str << std::endl;
+    // Renamed into place, so a coordinator never reads a half-written task.
+    if (!spoolWriteFile("./queue/pending", task.task_id + ".json", task_json_str + "\n")) {
+        std::cerr << "Failed to write task " << task.task_id << " to ./queue/pending" << std::endl;
+        exit(1);
+    }
     std::cout << "Task " << task.task_id << " added to the queue." << std::endl;
 }
 
 void listTasks() {
+    if (usingQueueLog()) {
+        QueueLog log("./queue/log");
+        std::map<QueueRecordType, std::vector<std::string>> by_state;
+        for (const auto& entry : log.states()) by_state[entry.second.last].push_back(entry.first);
+        const std::pair<QueueRecordType, const char*> sections[] = {
+            {QueueRecordType::Enqueue, "Pending"}, {QueueRecordType::Claim, "In Progress"},
+            {QueueRecordType::Complete, "Completed"}, {QueueRecordType::Fail, "Failed"}};
+        for (const auto& section : sections) {
+            std::cout << "--- " << section.second << " Tasks ---" << std::endl;
+            for (const auto& id : by_state[section.first]) std::cout << id << std::endl;
+        }
+        if (!log.ok()) std::cerr << log.error() << std::endl;
+        return;
+    }
     std::filesystem::create_directories("./queue/pending");
     std::filesystem::create_directories("./queue/in_progress");
     std::filesystem::create_directories("./queue/completed");
     std::filesystem::create_directories("./queue/failed");
+    // Hidden files are temp files and claim leases, not tasks.
+    auto list = [](const char* dir) {
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().filename().string()[0] != '.') std::cout << entry.path().filename() << std::endl;
+        }
+    };
     std::cout << "--- Pending Tasks ---" << std::endl;
-    if (std::filesystem::exists("./queue/pending")) for (const auto& entry : std::filesystem::directory_iterator("./queue/pending")) std::cout << entry.path().filename() << std::endl;
+    list("./queue/pending");
     std::cout << "--- In Progress Tasks ---" << std::endl;
-    if (std::filesystem::exists("./queue/in_progress")) for (const auto& entry : std::filesystem::directory_iterator("./queue/in_progress")) std::cout << entry.path().filename() << std::endl;
+    list("./queue/in_progress");
     std::cout << "--- Completed Tasks ---" << std::endl;
-    if (std::filesystem::exists("./queue/completed")) for (const auto& entry : std::filesystem::directory_iterator("./queue/completed")) std::cout << entry.path().filename() << std::endl;
+    list("./queue/completed");
     std::cout << "--- Failed Tasks ---" << std::endl;
-    if (std::filesystem::exists("./queue/failed")) for (const auto& entry : std::filesystem::directory_iterator("./queue/failed")) std::cout << entry.path().filename() << std::endl;
+    list("./queue/failed");
 }
 
 void showHelp() {
     std::cout << "QuantaLista CLI - Supported Commands:" << std::endl;
     std::cout << "  add <id> <desc> <prio> <comp> <runtime> [deps] - Add a task" << std::endl;
+    std::cout << "  add --batch [-|file]                          - Add NDJSON or CSV tasks, all or none" << std::endl;
     std::cout << "  list                                          - List tasks" << std::endl;
     std::cout << "  dashboard                                     - Show dashboard" << std::endl;
     std::cout << "  agent <subcommand>                            - Agent management" << std::endl;
@@ -1,7 +1,13 @@
 #ifndef CLI_H
 #define CLI_H
 
+#include <string_view>
+
 void addTask(int argc, char* argv[]);
+// Adds every task in input (NDJSON, or CSV with a header row) or, if any
+// line is invalid or a write fails, none. Errors go to stderr by line number.
+// Returns the number of tasks added, or -1.
+int addTaskBatch(std::string_view input);
 void listTasks();
 void showHelp();
 void handleCommand(int argc, char* argv[]);
@@ -1,14 +1,72 @@
 #include "core.h"
 #include "../utils/json_utils.h"
 #include "../models/ModelBackend.h"
+#include "../utils/metrics.h"
+#include "../utils/tracing.h"
+#include "../utils/worker_pool.h"
+#include "../utils/batch_io.h"
+#include "../utils/logger.h"
+#include "../utils/mapped_file.h"
+#include "../utils/dir_watcher.h"
+#include "../utils/fd_sink.h"
+#include "../utils/ndjson.h"
+#include "../queue/queue_log.h"
+#include "../queue/spool.h"
+#include "../storage/backup.h"
+#include "../storage/columnar.h"
+#include "../storage/compressed_file.h"
+#include "../storage/snapshot.h"
+#include "../storage/task_codec.h"
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <map>
 #include <set>
 #include <iomanip>
 #include <random>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+struct CoreMetrics {
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    Counter& tasks_submitted = registry.counter("quantalista_tasks_submitted_total", "Tasks submitted to the scheduler");
+    Counter& tasks_dispatched = registry.counter("quantalista_tasks_dispatched_total", "Tasks handed out by getNextAvailableTask");
+    Counter& tasks_completed = registry.counter("quantalista_tasks_completed_total", "Tasks marked as completed");
+    Counter& task_failures = registry.counter("quantalista_task_failures_total", "Task failures reported to handleTaskFailure");
+    Counter& tasks_dead_lettered = registry.counter("quantalista_tasks_dead_lettered_total", "Tasks moved to dead-letter storage after max retries");
+    Gauge& queue_depth = registry.gauge("quantalista_queue_depth", "Tasks waiting in the pending queue");
+    Gauge& tasks_in_progress = registry.gauge("quantalista_tasks_in_progress", "Tasks currently dispatched");
+    Histogram& task_duration = registry.histogram("quantalista_task_duration_seconds", "Time from dispatch to completion");
+    Counter& circuit_open = registry.counter("quantalista_circuit_transitions_total", "Circuit breaker state transitions", "to=\"open\"");
+    Counter& circuit_half_open = registry.counter("quantalista_circuit_transitions_total", "Circuit breaker state transitions", "to=\"half_open\"");
+    Counter& circuit_closed = registry.counter("quantalista_circuit_transitions_total", "Circuit breaker state transitions", "to=\"closed\"");
+    Counter& agent_state_changes = registry.counter("quantalista_agent_state_changes_total", "Agent state transitions");
+    Counter& result_batches = registry.counter("quantalista_result_batches_total", "Batches of completed task results written");
+    Counter& result_commits = registry.counter("quantalista_result_commits_total", "Directory, filesystem or log syncs making result batches durable");
+
+    Gauge& agents_idle = registry.gauge("quantalista_agents", "Registered agents by state", "state=\"idle\"");
+    Gauge& agents_busy = registry.gauge("quantalista_agents", "Registered agents by state", "state=\"busy\"");
+    Gauge& agents_error = registry.gauge("quantalista_agents", "Registered agents by state", "state=\"error\"");
+
+    Gauge& agents(AgentState state) {
+        switch (state) {
+            case AgentState::IDLE: return agents_idle;
+            case AgentState::BUSY: return agents_busy;
+            default: return agents_error;
+        }
+    }
+};
+
+CoreMetrics& coreMetrics() {
+    static CoreMetrics metrics;
+    return metrics;
+}
+}
 
 // --- AgentManager Implementation ---
 
@@ -16,6 +74,7 @@ AgentManager::AgentManager(Publisher& pub) : publisher(pub) {}
 
 void AgentManager::registerAgent(const Agent& agent) {
     agents.emplace(agent.id, agent);
+    coreMetrics().agents(agent.state).add(1);
     publisher.publish(AgentStateChangedEvent(agent.id, agent.state));
 }
 
@@ -48,6 +107,9 @@ void AgentManager::setAgentState(const std::string& agentId, AgentState newState
     auto it = agents.find(agentId);
     if (it != agents.end()) {
         if (it->second.state != newState) {
+            coreMetrics().agents(it->second.state).add(-1);
+            coreMetrics().agents(newState).add(1);
+            coreMetrics().agent_state_changes.inc();
             it->second.state = newState;
             publisher.publish(AgentStateChangedEvent(agentId, newState));
         }
@@ -102,9 +164,21 @@ const Agent* AgentManager::getAgent(const std::string& agentId) const {
 
 Scheduler::Scheduler(Publisher& pub) : publisher(pub), pending_tasks(TaskComparator{&tasks}) {}
 
+Scheduler::~Scheduler() = default;
+
 void Scheduler::submitTask(const Task& task) {
+    TraceSpan span("submitTask", traceId(task));
+    if (wal) {
+        std::string encoded;
+        encode_task(encoded, task);
+        logTransition(WalOp::Submit, encoded);
+    }
     tasks[task.task_id] = task;
     pending_tasks.insert(task.task_id);
+    recordChange(task.task_id);
+    invalidateCachedCalculations(task.task_id);
+    coreMetrics().tasks_submitted.inc();
+    coreMetrics().queue_depth.set(pending_tasks.size());
     publisher.publish(TaskCreatedEvent(task.task_id, task.description));
 }
 
@@ -116,80 +190,143 @@ bool Scheduler::areDependenciesMet(const Task& task) {
 }
 
 Task* Scheduler::getNextAvailableTask() {
+    TraceSpan span("dispatch");
     if (isCircuitBroken()) return nullptr;
     for (auto it = pending_tasks.begin(); it != pending_tasks.end(); ++it) {
         Task& task = tasks[*it];
         if (std::find(paused_task_ids.begin(), paused_task_ids.end(), *it) != paused_task_ids.end()) continue;
         if (areDependenciesMet(task)) {
             std::string tid = *it;
+            span.tag(traceId(task));
+            logTransition(WalOp::Dispatch, tid);
             in_progress_task_ids.push_back(tid);
             task_start_times[tid] = std::chrono::steady_clock::now();
+            invalidateCachedCalculations(tid);
             publisher.publish(TaskStatusChangedEvent(tid, TaskStatus::InProgress));
             Task* t_ptr = &tasks.at(tid);
             pending_tasks.erase(it);
+            coreMetrics().tasks_dispatched.inc();
+            coreMetrics().queue_depth.set(pending_tasks.size());
+            coreMetrics().tasks_in_progress.set(in_progress_task_ids.size());
             return t_ptr;
         }
     }
     return nullptr;
 }
 
-void Scheduler::markTaskAsCompleted(const std::string& taskId) {
+void Scheduler::markTaskAsCompleted(const std::string& taskId, const std::string& agentId) {
+    TraceSpan span("markTaskAsCompleted", taskId);
     auto it = std::find(in_progress_task_ids.begin(), in_progress_task_ids.end(), taskId);
     if (it != in_progress_task_ids.end()) {
+        logTransition(WalOp::Complete, taskId, agentId);
         in_progress_task_ids.erase(it);
         if (task_start_times.count(taskId)) {
             auto end = std::chrono::steady_clock::now();
             std::chrono::duration<double> diff = end - task_start_times[taskId];
-            completion_times.push_back(diff.count());
+            const Task& done = tasks[taskId];
+            span.tag(traceId(done));
+            completion_latency.record(diff.count());
+            completion_window.record(diff.count(), end);
+            component_latency[done.component].record(diff.count());
+            priority_latency[done.priority].record(diff.count());
+            if (!agentId.empty()) agent_latency[agentId].record(diff.count());
+            coreMetrics().task_duration.observe(diff.count());
             tasks[taskId].actual_effort = static_cast<int>(diff.count());
+            recordChange(taskId);
             task_start_times.erase(taskId);
         }
         completed_task_ids.push_back(taskId); // Mark as complete
+        invalidateCachedCalculations(taskId);
+        coreMetrics().tasks_completed.inc();
+        coreMetrics().tasks_in_progress.set(in_progress_task_ids.size());
         if (circuit_state == CircuitState::HALF_OPEN) {
              circuit_state = CircuitState::CLOSED;
              circuit_breaker_failures = 0;
+             coreMetrics().circuit_closed.inc();
         }
         publisher.publish(TaskStatusChangedEvent(taskId, TaskStatus::Completed));
     }
 }
 
-void Scheduler::setSchedule(const Schedule& schedule) {
-    std::map<std::string, int> visit;
-    std::function<bool(const std::string&)> hasCycle = [&](const std::string& u) {
-        visit[u] = 1;
-        for (const auto& task : schedule.tasks) {
-            if (task.task_id == u) {
-                for (const auto& v : task.dependencies) {
-                    if (visit[v] == 1) return true;
-                    if (visit[v] == 0 && hasCycle(v)) return true;
-                }
-            }
-        }
-        visit[u] = 2;
+bool Scheduler::setSchedule(const Schedule& schedule) { return setSchedule(Schedule(schedule)); }
+
+bool Scheduler::setSchedule(Schedule&& schedule) {
+    std::vector<size_t> order;
+    if (!dependencyOrder(schedule.tasks, order)) {
+        logEvent("ERROR", "Dependency cycle detected in schedule: " + schedule.name);
         return false;
-    };
-    for (const auto& t : schedule.tasks) {
-        if (visit[t.task_id] == 0) {
-            if (hasCycle(t.task_id)) {
-                logEvent("ERROR", "Dependency cycle detected in schedule: " + schedule.name);
-                return;
+    }
+    applySchedule(std::move(schedule), order);
+    return true;
+}
+
+void Scheduler::applySchedule(Schedule&& schedule, const std::vector<size_t>& order) {
+    current_schedule = std::move(schedule);
+    logEvent("INFO", "Setting new schedule: " + current_schedule.name);
+    for (size_t idx : order) submitTask(current_schedule.tasks[idx]);
+}
+
+// Empties the task table and every status list; drafts are left alone.
+void Scheduler::clearTaskState() {
+    pending_tasks.clear();
+    tasks.clear();
+    in_progress_task_ids.clear();
+    completed_task_ids.clear();
+    paused_task_ids.clear();
+    retry_counts.clear();
+    cancellation_reasons.clear();
+    task_start_times.clear();
+    resetChangeTracking();
+    coreMetrics().queue_depth.set(0);
+    coreMetrics().tasks_in_progress.set(0);
+}
+
+// Dependency-first order of task indices via iterative DFS; false on a cycle.
+// Works on indices so large schedules are neither copied nor recursed through.
+bool Scheduler::dependencyOrder(const std::vector<Task>& list, std::vector<size_t>& order) const {
+    std::unordered_map<std::string_view, size_t> index;
+    index.reserve(list.size());
+    for (size_t i = 0; i < list.size(); ++i) index[list[i].task_id] = i;
+    enum : uint8_t { UNVISITED, ON_STACK, DONE };
+    std::vector<uint8_t> state(list.size(), UNVISITED);
+    std::vector<std::pair<size_t, size_t>> stack; // node, next dependency to examine
+    order.clear();
+    order.reserve(index.size());
+    for (size_t root = 0; root < list.size(); ++root) {
+        if (state[root] != UNVISITED || index[list[root].task_id] != root) continue;
+        state[root] = ON_STACK;
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            size_t node = stack.back().first;
+            const auto& deps = list[node].dependencies;
+            if (stack.back().second < deps.size()) {
+                auto it = index.find(deps[stack.back().second++]);
+                if (it == index.end()) continue;
+                if (state[it->second] == ON_STACK) return false;
+                if (state[it->second] == UNVISITED) {
+                    state[it->second] = ON_STACK;
+                    stack.emplace_back(it->second, 0);
+                }
+            } else {
+                state[node] = DONE;
+                order.push_back(node);
+                stack.pop_back();
             }
         }
     }
-    current_schedule = schedule;
-    logEvent("INFO", "Setting new schedule: " + schedule.name);
-    std::vector<Task> sorted = getTopologicallySortedTasks(current_schedule.tasks);
-    for (const auto& task : sorted) submitTask(task);
+    return true;
 }
 
-void Scheduler::saveSchedule(const std::string& filepath) {
+void Scheduler::saveSchedule(const std::string& filepath, bool durable) {
     if (!isValidPath(filepath)) {
         logEvent("ERROR", "Invalid path for saveSchedule: " + filepath);
         return;
     }
-    std::ofstream file(filepath);
-    file << to_json(current_schedule);
-    file.close();
+    std::string error;
+    if (!replaceFile(filepath, durable, [&](FdSink& sink) { return write_json(current_schedule, sink); }, error)) {
+        logEvent("ERROR", "Failed to save schedule: " + error);
+        return;
+    }
     logEvent("INFO", "Schedule saved to " + filepath);
 }
 
@@ -198,24 +335,234 @@ void Scheduler::loadSchedule(const std::string& filepath) {
         logEvent("ERROR", "Invalid path for loadSchedule: " + filepath);
         return;
     }
-    std::ifstream file(filepath);
-    if (file.is_open()) {
-        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-        setSchedule(schedule_from_json(content));
-        file.close();
-        logEvent("INFO", "Schedule loaded from " + filepath);
+    MappedFile file(filepath);
+    if (file.is_open()) applyScheduleText(file.view(), filepath);
+}
+
+bool Scheduler::applyScheduleText(std::string_view text, const std::string& source) {
+    Schedule schedule;
+    JsonParseError error;
+    if (!parse_schedule(text, schedule, error)) {
+        // The parser may have stopped inside a task; applying what it read
+        // would submit a half-filled task, so the schedule is left untouched.
+        logEvent("ERROR", "Schedule " + source + " not loaded, parse stopped at byte " + std::to_string(error.position) + ": " +
+                              error.message);
+        return false;
+    }
+    setSchedule(std::move(schedule));
+    logEvent("INFO", "Schedule loaded from " + source);
+    return true;
+}
+
+bool Scheduler::saveSnapshot(const std::string& filepath, bool durable) {
+    if (!isValidPath(filepath)) {
+        logEvent("ERROR", "Invalid path for saveSnapshot: " + filepath);
+        return false;
+    }
+    SnapshotWriter snapshot;
+    std::unordered_set<std::string_view> pending(pending_tasks.begin(), pending_tasks.end());
+    for (const auto& [id, task] : tasks) snapshot.addTask(task, kSnapshotLive | (pending.count(id) ? kSnapshotPending : 0));
+    for (const auto& [id, task] : drafts) snapshot.addTask(task, kSnapshotDraft);
+    for (const auto& task : current_schedule.tasks) snapshot.addScheduledTask(task);
+    for (const auto& id : in_progress_task_ids) snapshot.addListEntry(SnapshotList::InProgress, id);
+    for (const auto& id : completed_task_ids) snapshot.addListEntry(SnapshotList::Completed, id);
+    for (const auto& id : paused_task_ids) snapshot.addListEntry(SnapshotList::Paused, id);
+    for (const auto& [id, count] : retry_counts) snapshot.addRetryCount(id, static_cast<uint32_t>(count));
+    for (const auto& [id, reason] : cancellation_reasons) snapshot.addCancellation(id, reason);
+    SnapshotMeta meta;
+    meta.schedule_id = current_schedule.schedule_id;
+    meta.schedule_name = current_schedule.name;
+    meta.retry_limit = retry_limit;
+    meta.circuit_failures = circuit_breaker_failures;
+    meta.circuit_state = static_cast<uint32_t>(circuit_state);
+    meta.wal_lsn = wal ? wal->lastLsn() : 0;
+    snapshot.setMeta(meta);
+    if (!snapshot.write(filepath, durable)) {
+        logEvent("ERROR", "Failed to write snapshot " + filepath + ": " + std::strerror(snapshot.lastError()));
+        return false;
+    }
+    logEvent("INFO", "Snapshot saved to " + filepath + " (" + std::to_string(tasks.size()) + " tasks)");
+    return true;
+}
+
+// The snapshot was consistent when written, so tasks go straight into the
+// maps: no cycle detection, no topological resubmission, no per-task events.
+bool Scheduler::loadSnapshot(const std::string& filepath) {
+    if (!isValidPath(filepath)) {
+        logEvent("ERROR", "Invalid path for loadSnapshot: " + filepath);
+        return false;
+    }
+    SnapshotReader snapshot;
+    if (!snapshot.open(filepath)) {
+        logEvent("ERROR", "Failed to load snapshot " + filepath + ": " + snapshot.error());
+        return false;
+    }
+    clearTaskState();
+    drafts.clear();
+    last_backup_path.clear(); // the old chain no longer describes this state
+
+    // Live and draft records were written in map order, so each insert lands at
+    // the end. The pending queue is sorted once on precomputed priorities and
+    // filled the same way, instead of paying map lookups per comparison.
+    std::vector<std::pair<int, const std::string*>> pending;
+    const TaskComparator queue_order{&tasks};
+    for (size_t i = 0; i < snapshot.taskCount(); ++i) {
+        uint32_t flags = snapshot.taskFlags(i);
+        if (!(flags & (kSnapshotLive | kSnapshotDraft))) continue;
+        Task task = snapshot.task(i);
+        auto& table = (flags & kSnapshotLive) ? tasks : drafts;
+        std::string id = task.task_id;
+        auto it = table.emplace_hint(table.end(), std::move(id), std::move(task));
+        if (flags & kSnapshotPending) pending.emplace_back(queue_order.priority_to_int(it->second.priority), &it->first);
+    }
+    std::sort(pending.begin(), pending.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : *a.second < *b.second;
+    });
+    for (const auto& entry : pending) pending_tasks.insert(pending_tasks.end(), *entry.second);
+    SnapshotMeta meta = snapshot.meta();
+    Schedule schedule(meta.schedule_id, meta.schedule_name);
+    schedule.tasks.reserve(snapshot.scheduled().size());
+    for (uint32_t record : snapshot.scheduled()) schedule.tasks.push_back(snapshot.task(record));
+    current_schedule = std::move(schedule);
+    auto restoreList = [&](SnapshotList list, std::vector<std::string>& ids) {
+        ids.reserve(snapshot.list(list).size());
+        for (uint32_t s : snapshot.list(list)) ids.emplace_back(snapshot.string(s));
+    };
+    restoreList(SnapshotList::InProgress, in_progress_task_ids);
+    restoreList(SnapshotList::Completed, completed_task_ids);
+    restoreList(SnapshotList::Paused, paused_task_ids);
+    SnapshotIndices retries = snapshot.retryCounts();
+    for (size_t i = 0; i < retries.size(); i += 2) retry_counts[std::string(snapshot.string(retries[i]))] = static_cast<int>(retries[i + 1]);
+    SnapshotIndices cancelled = snapshot.cancellations();
+    for (size_t i = 0; i < cancelled.size(); i += 2) {
+        cancellation_reasons[std::string(snapshot.string(cancelled[i]))] = std::string(snapshot.string(cancelled[i + 1]));
+    }
+    retry_limit = meta.retry_limit;
+    circuit_breaker_failures = meta.circuit_failures;
+    circuit_state = static_cast<CircuitState>(meta.circuit_state);
+    last_circuit_failure = std::chrono::steady_clock::now();
+    invalidateCachedCalculations();
+    coreMetrics().queue_depth.set(pending_tasks.size());
+    coreMetrics().tasks_in_progress.set(in_progress_task_ids.size());
+    snapshot_wal_lsn = meta.wal_lsn;
+    logEvent("INFO", "Snapshot loaded from " + filepath + " (" + std::to_string(tasks.size()) + " tasks)");
+    // Logged transitions predate the loaded state; start the log over from it.
+    if (wal) checkpoint();
+    return true;
+}
+
+bool Scheduler::enableWriteAheadLog(const std::string& directory, const WalOptions& options) {
+    if (wal) {
+        logEvent("WARNING", "Write-ahead log already enabled in " + wal_directory);
+        return false;
+    }
+    if (!isValidPath(directory)) {
+        logEvent("ERROR", "Invalid path for enableWriteAheadLog: " + directory);
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    std::string checkpoint_path = directory + "/checkpoint.snap";
+    std::string log_path = directory + "/wal.log";
+    uint64_t checkpoint_lsn = 0;
+    if (std::filesystem::exists(checkpoint_path, ec)) {
+        if (!loadSnapshot(checkpoint_path)) return false;
+        checkpoint_lsn = snapshot_wal_lsn;
+    }
+    // Replay runs before the log is attached, so replayed operations are not logged again.
+    uint64_t last_lsn = 0;
+    size_t replayed = 0;
+    std::string error;
+    if (!WriteAheadLog::replay(log_path, checkpoint_lsn, [&](const WalRecord& record) { applyWalRecord(record); replayed++; },
+                               last_lsn, error)) {
+        logEvent("ERROR", "Write-ahead log replay failed: " + error);
+        return false;
+    }
+    // Replayed dispatches have no agent and nothing will finish them; the
+    // tasks in flight when the process stopped go back to the queue.
+    size_t interrupted = 0;
+    for (const auto& id : in_progress_task_ids) interrupted += tasks.count(id) && pending_tasks.insert(id).second;
+    in_progress_task_ids.clear();
+    task_start_times.clear();
+    coreMetrics().queue_depth.set(pending_tasks.size());
+    coreMetrics().tasks_in_progress.set(0);
+    auto log = std::make_unique<WriteAheadLog>();
+    if (!log->open(log_path, last_lsn + 1, options)) {
+        logEvent("ERROR", "Failed to open write-ahead log " + log_path + ": " + std::strerror(log->lastError()));
+        return false;
+    }
+    wal = std::move(log);
+    wal_directory = directory;
+    wal_options = options;
+    logEvent("INFO", "Write-ahead log enabled in " + directory + ", replayed " + std::to_string(replayed) + " operations, requeued " +
+                         std::to_string(interrupted) + " interrupted tasks");
+    return true;
+}
+
+bool Scheduler::checkpoint() {
+    if (!wal) return false;
+    std::string path = wal_directory + "/checkpoint.snap";
+    // A crash between the snapshot and the truncation is safe: replay skips
+    // records at or below the LSN the snapshot recorded.
+    if (!saveSnapshot(path, true)) return false;
+    if (!wal->truncate()) {
+        logEvent("ERROR", "Failed to truncate write-ahead log: " + std::string(std::strerror(wal->lastError())));
+        return false;
+    }
+    return true;
+}
+
+bool Scheduler::syncWriteAheadLog() { return wal && wal->sync(); }
+
+void Scheduler::logTransition(WalOp op, std::string_view a, std::string_view b) {
+    if (!wal) return;
+    // A failed log takes no more records; a checkpoint captures the state
+    // instead and starts the log over.
+    if (wal->lastError() != 0 || wal->size() >= wal_options.checkpoint_bytes) checkpoint();
+    if (wal->append(op, a, b) == 0) logEvent("ERROR", "Write-ahead log is failing: " + std::string(std::strerror(wal->lastError())));
+}
+
+void Scheduler::applyWalRecord(const WalRecord& record) {
+    std::string id(record.fields[0]);
+    switch (record.op) {
+        case WalOp::Submit: {
+            std::string_view encoded = record.fields[0];
+            Task task;
+            if (decode_task(encoded, task)) submitTask(task);
+            break;
+        }
+        case WalOp::Dispatch:
+            if (tasks.count(id) && pending_tasks.erase(id)) in_progress_task_ids.push_back(id);
+            break;
+        case WalOp::Complete: markTaskAsCompleted(id, std::string(record.fields[1])); break;
+        case WalOp::Fail: replayTaskFailure(id); break;
+        case WalOp::Pause: pauseTask(id); break;
+        case WalOp::Resume: resumeTask(id); break;
+        case WalOp::Cancel: cancelTask(id, std::string(record.fields[1])); break;
+        case WalOp::Archive: archiveTask(id); break;
+        case WalOp::Restore: restoreTask(id); break;
+        case WalOp::Remove: removeTask(id); break;
+        case WalOp::AgePriorities: agePriorities(); break;
     }
 }
 
 void Scheduler::removeTask(const std::string& taskId) {
+    logTransition(WalOp::Remove, taskId);
     auto it = std::remove_if(current_schedule.tasks.begin(), current_schedule.tasks.end(),
         [&taskId](const Task& t) { return t.task_id == taskId; });
     current_schedule.tasks.erase(it, current_schedule.tasks.end());
+    // The pending queue's comparator looks tasks up, so leave it before the task goes.
+    if (tasks.count(taskId)) {
+        pending_tasks.erase(taskId);
+        task_changes.erase(taskId);
+        removed_since_backup.insert(taskId);
+        change_sequence++;
+    }
     tasks.erase(taskId);
-    pending_tasks.erase(taskId);
     in_progress_task_ids.erase(std::remove(in_progress_task_ids.begin(), in_progress_task_ids.end(), taskId), in_progress_task_ids.end());
     paused_task_ids.erase(std::remove(paused_task_ids.begin(), paused_task_ids.end(), taskId), paused_task_ids.end());
     completed_task_ids.erase(std::remove(completed_task_ids.begin(), completed_task_ids.end(), taskId), completed_task_ids.end());
+    invalidateCachedCalculations(taskId);
     logEvent("INFO", "Removed task: " + taskId);
 }
 
@@ -223,7 +570,9 @@ void Scheduler::pauseTask(const std::string& taskId) {
     if (tasks.find(taskId) != tasks.end()) {
         if (pending_tasks.find(taskId) != pending_tasks.end()) {
              if (std::find(paused_task_ids.begin(), paused_task_ids.end(), taskId) == paused_task_ids.end()) {
+                logTransition(WalOp::Pause, taskId);
                 paused_task_ids.push_back(taskId);
+                invalidateCachedCalculations(taskId);
                 logEvent("INFO", "Paused task: " + taskId);
                 publisher.publish(TaskStatusChangedEvent(taskId, TaskStatus::Paused));
              }
@@ -234,7 +583,9 @@ void Scheduler::pauseTask(const std::string& taskId) {
 void Scheduler::resumeTask(const std::string& taskId) {
     auto it = std::find(paused_task_ids.begin(), paused_task_ids.end(), taskId);
     if (it != paused_task_ids.end()) {
+        logTransition(WalOp::Resume, taskId);
         paused_task_ids.erase(it);
+        invalidateCachedCalculations(taskId);
         logEvent("INFO", "Resumed task: " + taskId);
         publisher.publish(TaskStatusChangedEvent(taskId, TaskStatus::Pending));
     }
@@ -244,7 +595,7 @@ TaskStatus Scheduler::getTaskStatus(const std::string& taskId) const {
     if (std::find(completed_task_ids.begin(), completed_task_ids.end(), taskId) != completed_task_ids.end()) return TaskStatus::Completed;
     if (std::find(in_progress_task_ids.begin(), in_progress_task_ids.end(), taskId) != in_progress_task_ids.end()) return TaskStatus::InProgress;
     if (std::find(paused_task_ids.begin(), paused_task_ids.end(), taskId) != paused_task_ids.end()) return TaskStatus::Paused;
-    if (pending_tasks.find(taskId) != pending_tasks.end()) return TaskStatus::Pending;
+    if (tasks.count(taskId) && pending_tasks.find(taskId) != pending_tasks.end()) return TaskStatus::Pending;
     return TaskStatus::Failed;
 }
 
@@ -277,6 +628,7 @@ Task Scheduler::cloneTask(const std::string& sourceTaskId, const std::string& ne
 
 void Scheduler::cancelTask(const std::string& taskId, const std::string& reason) {
     if (tasks.find(taskId) != tasks.end()) {
+        logTransition(WalOp::Cancel, taskId, reason);
         cancellation_reasons[taskId] = reason;
         removeTask(taskId);
         publisher.publish(TaskStatusChangedEvent(taskId, TaskStatus::Failed));
@@ -301,45 +653,114 @@ void Scheduler::batchCreateTasks(const std::vector<Task>& tasks_to_add) {
     for (const auto& t : tasks_to_add) submitTask(t);
 }
 
-std::string Scheduler::exportToCSV() const {
-    std::stringstream ss;
-    ss << "task_id,description,priority,status,owner,due_date\n";
+namespace {
+// Appends s as a quoted CSV field, doubling embedded quotes.
+void appendCsvField(std::string& row, std::string_view s) {
+    row += '"';
+    for (size_t quote; (quote = s.find('"')) != std::string_view::npos; s.remove_prefix(quote + 1)) {
+        row.append(s.data(), quote + 1);
+        row += '"';
+    }
+    row.append(s.data(), s.size());
+    row += '"';
+}
+} // namespace
+
+// Visits tasks in id order with their status. Statuses come from one pass
+// over the lists (first match wins, in getTaskStatus order) instead of four
+// scans per task.
+template <typename Visit>
+void Scheduler::forEachTaskStatus(Visit visit) const {
+    std::unordered_map<std::string_view, TaskStatus> status;
+    status.reserve(completed_task_ids.size() + in_progress_task_ids.size() + paused_task_ids.size() + pending_tasks.size());
+    for (const auto& id : completed_task_ids) status.emplace(id, TaskStatus::Completed);
+    for (const auto& id : in_progress_task_ids) status.emplace(id, TaskStatus::InProgress);
+    for (const auto& id : paused_task_ids) status.emplace(id, TaskStatus::Paused);
+    for (const auto& id : pending_tasks) status.emplace(id, TaskStatus::Pending);
     for (const auto& pair : tasks) {
-        const Task& t = pair.second;
-        auto escape = [](std::string s) {
-            size_t pos = 0;
-            while ((pos = s.find("\"", pos)) != std::string::npos) {
-                s.replace(pos, 1, "\"\"");
-                pos += 2;
-            }
-            return "\"" + s + "\"";
-        };
-        ss << escape(t.task_id) << "," << escape(t.description) << "," << escape(t.priority) << ","
-           << (int)getTaskStatus(t.task_id) << "," << escape(t.owner) << "," << escape(t.due_date) << "\n";
+        auto found = status.find(pair.first);
+        visit(pair.second, found != status.end() ? found->second : TaskStatus::Failed);
     }
-    return ss.str();
+}
+
+namespace {
+void appendCsvRow(std::string& row, const Task& t, TaskStatus status) {
+    row.clear();
+    appendCsvField(row, t.task_id);
+    row += ',';
+    appendCsvField(row, t.description);
+    row += ',';
+    appendCsvField(row, t.priority);
+    row += ',';
+    row += std::to_string(static_cast<int>(status));
+    row += ',';
+    appendCsvField(row, t.owner);
+    row += ',';
+    appendCsvField(row, t.due_date);
+    row += '\n';
+}
+
+constexpr char kCsvHeader[] = "task_id,description,priority,status,owner,due_date\n";
+} // namespace
+
+std::string Scheduler::exportToCSV() const {
+    std::string csv = kCsvHeader;
+    std::string row;
+    forEachTaskStatus([&](const Task& t, TaskStatus status) {
+        appendCsvRow(row, t, status);
+        csv += row;
+    });
+    return csv;
+}
+
+bool Scheduler::exportToCSV(FdSink& sink) const {
+    sink.write(kCsvHeader);
+    std::string row;
+    forEachTaskStatus([&](const Task& t, TaskStatus status) {
+        appendCsvRow(row, t, status);
+        sink.write(row);
+    });
+    return sink.ok();
+}
+
+bool Scheduler::exportColumnar(FdSink& sink, size_t rows_per_group) const {
+    ColumnarWriter writer(sink, rows_per_group);
+    forEachTaskStatus([&](const Task& t, TaskStatus status) { writer.addRow(t, status); });
+    return writer.finish();
 }
 
 void Scheduler::archiveTask(const std::string& taskId) {
     if (tasks.find(taskId) != tasks.end()) {
+        logTransition(WalOp::Archive, taskId);
         tasks[taskId].archived = true;
+        recordChange(taskId);
+        invalidateCachedCalculations(taskId);
         logEvent("INFO", "Archived task: " + taskId);
     }
 }
 
 void Scheduler::restoreTask(const std::string& taskId) {
-    if (tasks.find(taskId) != tasks.end()) tasks[taskId].archived = false;
+    if (tasks.find(taskId) != tasks.end()) {
+        logTransition(WalOp::Restore, taskId);
+        tasks[taskId].archived = false;
+        recordChange(taskId);
+        invalidateCachedCalculations(taskId);
+    }
 }
 
 void Scheduler::agePriorities() {
     logEvent("INFO", "Aging task priorities...");
+    logTransition(WalOp::AgePriorities);
     std::vector<std::string> tids;
     for (const auto& tid : pending_tasks) tids.push_back(tid);
     pending_tasks.clear();
     for (const auto& taskId : tids) {
         Task& t = tasks.at(taskId);
-        if (t.priority == "low") t.priority = "medium";
-        else if (t.priority == "medium") t.priority = "high";
+        if (t.priority == "low" || t.priority == "medium") {
+            t.priority = t.priority == "low" ? "medium" : "high";
+            recordChange(taskId);
+            invalidateCachedCalculations(taskId);
+        }
         pending_tasks.insert(taskId);
     }
 }
@@ -368,14 +789,27 @@ std::vector<Task> Scheduler::getTopologicallySortedTasks(const std::vector<Task>
 }
 
 std::string Scheduler::getCachedCalculation(const std::string& key) {
-    if (calculation_cache.count(key)) return calculation_cache[key];
+    std::string value;
+    if (calculation_cache.get(key, value)) return value;
     return "";
 }
 
-void Scheduler::setCachedCalculation(const std::string& key, const std::string& value) {
-    calculation_cache[key] = value;
+void Scheduler::setCachedCalculation(const std::string& key, const std::string& value, const std::vector<std::string>& taskIds) {
+    calculation_cache.put(key, value, taskIds);
 }
 
+void Scheduler::configureCache(size_t capacity, int ttl_sec) {
+    calculation_cache.reconfigure(capacity, std::chrono::seconds(ttl_sec));
+}
+
+CacheStats Scheduler::getCacheStats() const { return calculation_cache.stats(); }
+
+// Cached calculations are derived from task state: a task update stales the
+// values computed from that task, replacing the whole state stales them all.
+void Scheduler::invalidateCachedCalculations() { calculation_cache.invalidateAll(); }
+
+void Scheduler::invalidateCachedCalculations(const std::string& taskId) { calculation_cache.invalidate(taskId); }
+
 std::vector<Task> Scheduler::searchTasks(const std::string& query) {
     std::vector<Task> results;
     std::string lower_query = query;
@@ -425,22 +859,252 @@ void Scheduler::importFromJSON(const std::string& json) {
 }
 
 std::string Scheduler::exportToLineDelimitedJSON() const {
-    std::stringstream ss;
-    for (const auto& t : current_schedule.tasks) ss << to_json(t) << "\n";
-    return ss.str();
+    std::string out;
+    for (const auto& t : current_schedule.tasks) {
+        out += to_json(t);
+        out += '\n';
+    }
+    return out;
 }
 
-void Scheduler::createBackup(const std::string& backupPath) { saveSchedule(backupPath); }
+bool Scheduler::exportToLineDelimitedJSON(FdSink& sink) const {
+    std::string line;
+    for (const auto& t : current_schedule.tasks) {
+        JsonWriter writer(line);
+        writer.reset();
+        write_json(writer, t);
+        sink.write(line.data(), writer.size());
+        sink.write("\n", 1);
+    }
+    return sink.ok();
+}
 
-void Scheduler::restoreBackup(const std::string& backupPath) { loadSchedule(backupPath); }
+ImportSummary Scheduler::importFromLineDelimitedJSON(std::string_view ndjson, unsigned threads) {
+    NdjsonBatch batch;
+    parse_ndjson_tasks(ndjson, batch, threads);
+    return mergeImportedTasks(batch);
+}
+
+ImportSummary Scheduler::importLineDelimitedFile(const std::string& filepath, unsigned threads) {
+    if (!isValidPath(filepath)) {
+        logEvent("ERROR", "Invalid path for importLineDelimitedFile: " + filepath);
+        return ImportSummary();
+    }
+    MappedFile file(filepath);
+    if (!file.is_open()) {
+        logEvent("ERROR", "Failed to open import file " + filepath);
+        return ImportSummary();
+    }
+    return importFromLineDelimitedJSON(file.view(), threads);
+}
+
+ImportSummary Scheduler::mergeImportedTasks(NdjsonBatch& batch) {
+    ImportSummary summary;
+    summary.lines = batch.lines;
+    summary.malformed = batch.errors.size();
+    for (const auto& error : batch.errors) {
+        logEvent("WARNING", "Import line " + std::to_string(error.line) + ", column " + std::to_string(error.column) + ": " + error.message);
+    }
+    // One pass: validation and duplicates against the scheduler and earlier lines.
+    std::vector<size_t> accepted;
+    accepted.reserve(batch.tasks.size());
+    {
+        std::unordered_set<std::string_view> seen;
+        seen.reserve(batch.tasks.size());
+        for (size_t i = 0; i < batch.tasks.size(); ++i) {
+            const Task& task = batch.tasks[i];
+            if (!validateTask(task)) {
+                summary.invalid++;
+                continue;
+            }
+            if (tasks.count(task.task_id) || !seen.insert(task.task_id).second) {
+                logEvent("WARNING", "Import duplicate detected: " + task.task_id + " (line " + std::to_string(batch.task_lines[i]) + "). Skipping.");
+                summary.duplicates++;
+                continue;
+            }
+            accepted.push_back(i);
+        }
+    }
+    std::vector<Task> imported;
+    imported.reserve(accepted.size());
+    for (size_t i : accepted) imported.push_back(std::move(batch.tasks[i]));
+    std::vector<size_t> order;
+    if (!dependencyOrder(imported, order)) {
+        logEvent("ERROR", "Dependency cycle detected in import; no tasks imported.");
+        summary.cycle = true;
+        return summary;
+    }
+    for (size_t idx : order) submitTask(imported[idx]);
+    summary.imported = order.size();
+    logEvent("INFO", "Imported " + std::to_string(summary.imported) + " of " + std::to_string(summary.lines) + " lines.");
+    return summary;
+}
+
+void Scheduler::recordChange(const std::string& taskId) {
+    task_changes[taskId] = ++change_sequence;
+    removed_since_backup.erase(taskId);
+}
+
+// Everything so far counts as captured by the backup that follows.
+void Scheduler::resetChangeTracking() {
+    task_changes.clear();
+    removed_since_backup.clear();
+}
+
+bool Scheduler::writeBackup(const std::string& backupPath, bool incremental) {
+    if (!isValidPath(backupPath)) {
+        logEvent("ERROR", "Invalid path for backup: " + backupPath);
+        return false;
+    }
+    std::filesystem::path target(backupPath);
+    BackupInfo info;
+    if (incremental && !last_backup_path.empty() && std::filesystem::exists(last_backup_path) &&
+        std::filesystem::path(last_backup_path).parent_path() == target.parent_path() &&
+        std::filesystem::path(last_backup_path).filename() != target.filename()) {
+        info.kind = BackupKind::Incremental;
+        info.parent = std::filesystem::path(last_backup_path).filename().string();
+        info.parent_sequence = last_backup_sequence;
+    } else if (incremental) {
+        logEvent("INFO", "No parent backup next to " + backupPath + "; writing a full backup.");
+    }
+    info.sequence = change_sequence;
+    info.created_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    info.schedule_id = current_schedule.schedule_id;
+    info.schedule_name = current_schedule.name;
+    size_t written = 0;
+    std::string error;
+    bool ok = writeBackupFile(backupPath, info, [&](BackupWriter& writer) {
+        for (const auto& pair : tasks) {
+            if (info.kind == BackupKind::Incremental) {
+                auto changed = task_changes.find(pair.first);
+                if (changed == task_changes.end() || changed->second <= last_backup_sequence) continue;
+            }
+            writer.addTask(pair.second);
+            written++;
+        }
+        if (info.kind == BackupKind::Incremental) for (const auto& id : removed_since_backup) writer.addRemoval(id);
+    }, error);
+    if (!ok) {
+        logEvent("ERROR", "Failed to write backup: " + error);
+        return false;
+    }
+    last_backup_path = backupPath;
+    last_backup_sequence = change_sequence;
+    removed_since_backup.clear();
+    logEvent("INFO", std::string(info.kind == BackupKind::Full ? "Full" : "Incremental") + " backup written to " + backupPath +
+                         " (" + std::to_string(written) + " tasks)");
+    return true;
+}
+
+void Scheduler::createBackup(const std::string& backupPath) { writeBackup(backupPath, false); }
+
+bool Scheduler::createIncrementalBackup(const std::string& backupPath) { return writeBackup(backupPath, true); }
+
+void Scheduler::restoreBackup(const std::string& backupPath) {
+    if (!isValidPath(backupPath)) {
+        logEvent("ERROR", "Invalid path for restoreBackup: " + backupPath);
+        return;
+    }
+    BackupInfo info;
+    if (readBackupInfo(backupPath, info)) {
+        restoreBackupChain(backupPath);
+    } else if (isCompressedFile(backupPath)) {
+        std::string json;
+        std::string error;
+        if (!readCompressedFile(backupPath, json, error)) {
+            logEvent("ERROR", "Failed to restore backup " + backupPath + ": " + error);
+            return;
+        }
+        applyScheduleText(json, backupPath);
+    } else if (isSnapshotFile(backupPath)) {
+        loadSnapshot(backupPath);
+    } else {
+        loadSchedule(backupPath);
+    }
+}
+
+bool Scheduler::restoreBackupChain(const std::string& backupPath) {
+    BackupInfo info;
+    std::map<std::string, Task> restored;
+    std::string error;
+    if (!loadBackupChain(backupPath, info, restored, error)) {
+        logEvent("ERROR", "Failed to restore backup: " + error);
+        return false;
+    }
+    Schedule schedule(info.schedule_id, info.schedule_name);
+    schedule.tasks.reserve(restored.size());
+    for (auto& entry : restored) schedule.tasks.push_back(std::move(entry.second));
+    std::vector<size_t> order;
+    if (!dependencyOrder(schedule.tasks, order)) {
+        logEvent("ERROR", "Failed to restore backup " + backupPath + ": dependency cycle in " + schedule.name);
+        return false;
+    }
+    // The chain is the whole task table, so tasks it removed must not survive.
+    clearTaskState();
+    applySchedule(std::move(schedule), order);
+    // The restored backup is the parent of the next incremental one.
+    resetChangeTracking();
+    // setSchedule counted every restored task as a change; the next delta's
+    // parent is still the file at the sequence it was written with.
+    change_sequence = std::max(change_sequence, info.sequence);
+    last_backup_path = backupPath;
+    last_backup_sequence = info.sequence;
+    logEvent("INFO", "Backup restored from " + backupPath);
+    // Logged transitions predate the restored state; start the log over from it.
+    if (wal) checkpoint();
+    return true;
+}
+
+bool Scheduler::restoreLatestBackup(const std::string& directory) {
+    std::vector<BackupEntry> entries;
+    std::string error;
+    if (!isValidPath(directory) || !loadBackupCatalog(directory, entries, error)) {
+        logEvent("ERROR", "Cannot read backup catalog for " + directory + (error.empty() ? "" : ": " + error));
+        return false;
+    }
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+        if (restoreBackupChain((std::filesystem::path(directory) / it->file).string())) return true;
+    }
+    logEvent("ERROR", "No restorable backup in " + directory);
+    return false;
+}
 
 void Scheduler::pruneBackups(const std::string& directory, int maxBackups) {
-    std::vector<std::filesystem::path> backups;
-    for (const auto& entry : std::filesystem::directory_iterator(directory)) if (entry.is_regular_file()) backups.push_back(entry.path());
-    if (backups.size() > (size_t)maxBackups) {
-        std::sort(backups.begin(), backups.end(), [](const auto& a, const auto& b) { return std::filesystem::last_write_time(a) < std::filesystem::last_write_time(b); });
-        for (size_t i = 0; i < backups.size() - maxBackups; ++i) std::filesystem::remove(backups[i]);
+    // The catalog already holds every backup's time and parent, so pruning
+    // neither stats nor opens the backups it keeps.
+    std::vector<BackupEntry> entries;
+    std::string error;
+    if (!loadBackupCatalog(directory, entries, error)) {
+        logEvent("ERROR", "Cannot read backup catalog: " + error);
+        return;
     }
+    if (maxBackups < 0 || entries.size() <= static_cast<size_t>(maxBackups)) return;
+    size_t cut = entries.size() - maxBackups;
+    std::set<std::string> pruned;
+    for (size_t i = 0; i < cut; ++i) pruned.insert(entries[i].file);
+    for (size_t i = cut; i < entries.size(); ++i) {
+        const BackupEntry& entry = entries[i];
+        if (entry.info.kind != BackupKind::Incremental || !pruned.count(entry.info.parent)) continue;
+        std::string path = (std::filesystem::path(directory) / entry.file).string();
+        if (!rebaseBackup(path, error)) {
+            logEvent("ERROR", "Not pruning " + directory + ": " + error);
+            return;
+        }
+        logEvent("INFO", "Rebased " + path + " into a full backup.");
+    }
+    // Rebasing rewrote catalog entries, so drop the pruned ones from the current catalog.
+    if (!readBackupCatalog(directory, entries)) {
+        logEvent("ERROR", "Backup catalog for " + directory + " changed unreadably; not pruning.");
+        return;
+    }
+    for (const auto& file : pruned) {
+        std::error_code ec;
+        std::filesystem::remove(std::filesystem::path(directory) / file, ec);
+    }
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const BackupEntry& e) { return pruned.count(e.file) > 0; }),
+                  entries.end());
+    if (!writeBackupCatalog(directory, entries, error)) logEvent("ERROR", "Failed to update backup catalog: " + error);
+    else logEvent("INFO", "Pruned " + std::to_string(pruned.size()) + " backups from " + directory);
 }
 
 void Scheduler::runMigration(const std::string& targetVersion) {
@@ -457,28 +1121,33 @@ void Scheduler::rollbackMigration(const std::string& rollbackFile) {
     if (r_file >> prev_version) runMigration(prev_version);
 }
 
-void Scheduler::shutdown() {
+void Scheduler::shutdown(const std::string& snapshotPath) {
     logEvent("INFO", "Scheduler shutting down gracefully...");
-    saveSchedule("shutdown_state.json");
-    logEvent("INFO", "State saved to shutdown_state.json");
+    if (wal) checkpoint();
+    if (saveSnapshot(snapshotPath, true)) logEvent("INFO", "State saved to " + snapshotPath);
 }
 
 void Scheduler::logEvent(const std::string& level, const std::string& message) const {
-    auto now = std::chrono::system_clock::now();
-    auto in_time_t = std::chrono::system_clock::to_time_t(now);
-    std::cout << "{\"timestamp\": \"" << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S")
-              << "\", \"level\": \"" << level << "\", \"message\": \"" << message << "\"}" << std::endl;
+    Logger::instance().log(parseLogLevel(level), message);
 }
 
 int Scheduler::getCompletedTaskCount() const { return completed_task_ids.size(); }
 int Scheduler::getFailedTaskCount() const { return cancellation_reasons.size(); }
-double Scheduler::getRollingAverageCompletionTime() const {
-    if (completion_times.empty()) return 0.0;
-    double sum = 0;
-    for (double t : completion_times) sum += t;
-    return sum / completion_times.size();
+double Scheduler::getRollingAverageCompletionTime() const { return completion_window.average(); }
+
+double Scheduler::getCompletionTimePercentile(double percentile) const { return completion_latency.percentile(percentile); }
+
+namespace {
+LatencyHistogram lookupLatency(const std::map<std::string, LatencyHistogram>& by_key, const std::string& key) {
+    auto it = by_key.find(key);
+    return it != by_key.end() ? it->second : LatencyHistogram();
+}
 }
 
+LatencyHistogram Scheduler::getComponentLatency(const std::string& component) const { return lookupLatency(component_latency, component); }
+LatencyHistogram Scheduler::getPriorityLatency(const std::string& priority) const { return lookupLatency(priority_latency, priority); }
+LatencyHistogram Scheduler::getAgentLatency(const std::string& agentId) const { return lookupLatency(agent_latency, agentId); }
+
 bool Scheduler::validateTask(const Task& task) const {
     if (task.task_id.empty()) { logEvent("ERROR", "Validation failed: task_id is empty."); return false; }
     if (task.description.empty()) { logEvent("ERROR", "Validation failed: description is empty."); return false; }
@@ -495,9 +1164,13 @@ std::string Scheduler::renderHumanReadableTimestamp(const std::string& utc_times
 void Scheduler::setRetryLimit(int limit) { retry_limit = limit; }
 
 void Scheduler::handleTaskFailure(const std::string& taskId) {
+    logTransition(WalOp::Fail, taskId);
     retry_counts[taskId]++;
     circuit_breaker_failures++;
+    invalidateCachedCalculations(taskId);
+    coreMetrics().task_failures.inc();
     if (circuit_breaker_failures >= circuit_breaker_threshold) {
+        if (circuit_state != CircuitState::OPEN) coreMetrics().circuit_open.inc();
         circuit_state = CircuitState::OPEN;
         last_circuit_failure = std::chrono::steady_clock::now();
         logEvent("ERROR", "Circuit breaker OPENED due to multiple failures.");
@@ -511,6 +1184,7 @@ void Scheduler::handleTaskFailure(const std::string& taskId) {
         publisher.publish(TaskStatusChangedEvent(taskId, TaskStatus::Pending));
     } else {
         logEvent("ERROR", "Task " + taskId + " reached max retries. Moving to dead-letter storage.");
+        coreMetrics().tasks_dead_lettered.inc();
         cancelTask(taskId, "Max retries reached");
         std::filesystem::create_directories("./queue/dead_letter");
         std::string filename = "./queue/dead_letter/" + taskId + ".json";
@@ -519,11 +1193,24 @@ void Scheduler::handleTaskFailure(const std::string& taskId) {
     }
 }
 
+// The counting half of handleTaskFailure. The dead-letter file, metrics and
+// circuit state belong to the original failure, and a task out of retries is
+// removed by the Cancel record logged after it.
+void Scheduler::replayTaskFailure(const std::string& taskId) {
+    retry_counts[taskId]++;
+    circuit_breaker_failures++;
+    if (retry_counts[taskId] >= retry_limit) return;
+    auto it = std::find(in_progress_task_ids.begin(), in_progress_task_ids.end(), taskId);
+    if (it != in_progress_task_ids.end()) in_progress_task_ids.erase(it);
+    if (tasks.count(taskId)) pending_tasks.insert(taskId);
+}
+
 bool Scheduler::isCircuitBroken() const {
     if (circuit_state == CircuitState::OPEN) {
         auto now = std::chrono::steady_clock::now();
         if (now - last_circuit_failure > std::chrono::seconds(30)) {
              const_cast<Scheduler*>(this)->circuit_state = CircuitState::HALF_OPEN;
+             coreMetrics().circuit_half_open.inc();
              return false;
         }
         return true;
@@ -531,7 +1218,11 @@ bool Scheduler::isCircuitBroken() const {
     return false;
 }
 
-void Scheduler::resetCircuitBreaker() { circuit_breaker_failures = 0; circuit_state = CircuitState::CLOSED; }
+void Scheduler::resetCircuitBreaker() {
+    if (circuit_state != CircuitState::CLOSED) coreMetrics().circuit_closed.inc();
+    circuit_breaker_failures = 0;
+    circuit_state = CircuitState::CLOSED;
+}
 
 // --- Coordinator Implementation ---
 
@@ -545,45 +1236,472 @@ Coordinator::Coordinator(Project p, const std::string& queue_dir)
     std::filesystem::create_directories(in_progress_dir);
     std::filesystem::create_directories(completed_dir);
     std::filesystem::create_directories(failed_dir);
+    model_backend = std::make_unique<ModelBackend>();
+    unsigned configured = static_cast<unsigned>(std::strtoul(model_backend->config_value("queue.workers", "0").c_str(), nullptr, 10));
+    setWorkerCount(configured ? configured : std::thread::hardware_concurrency());
+    owner = spoolOwner();
+    long lease = std::strtol(model_backend->config_value("queue.lease_sec", "600").c_str(), nullptr, 10);
+    if (lease > 0) lease_duration = std::chrono::seconds(lease);
+    // Opt-in: the kernel runs renames, opens and unlinks from the ring on
+    // worker threads, which is no faster than plain syscalls on most filesystems.
+    batch_io = std::make_unique<BatchIo>(model_backend->config_value("queue.io_uring", "0") == "1" ? 256 : 0);
+    std::string durability = model_backend->config_value("queue.durability", "none");
+    long window_ms = std::strtol(model_backend->config_value("queue.group_commit_ms", "5").c_str(), nullptr, 10);
+    long max_batch = std::strtol(model_backend->config_value("queue.group_commit_max", "64").c_str(), nullptr, 10);
+    setDurability(durability == "group" ? Durability::Group : durability == "each" ? Durability::Each : Durability::None,
+                  std::chrono::milliseconds(std::max(0L, window_ms)), static_cast<size_t>(std::max(1L, max_batch)));
+#ifdef __linux__
+    sync_filesystem = model_backend->config_value("queue.syncfs", "0") == "1";
+#else
+    if (model_backend->config_value("queue.syncfs", "0") == "1") scheduler.logEvent("WARN", "queue.syncfs needs Linux; fsyncing each result.");
+#endif
+    if (model_backend->config_value("queue.backend", "files") == "log") {
+        queue_log = std::make_unique<QueueLog>((std::filesystem::path(queue_dir) / "log").string());
+        if (!queue_log->ok()) {
+            scheduler.logEvent("ERROR", "Queue log unavailable, using task files: " + queue_log->error());
+            queue_log.reset();
+        }
+    }
+    std::string wal_dir = model_backend->config_value("scheduler.wal_dir", (std::filesystem::path(queue_dir) / "state").string());
+    if (wal_dir != "none") {
+        state_dir = wal_dir;
+        restoreState();
+    }
+    lease_renewer = std::thread([this] { renewLeases(); });
+}
+
+// A log is checkpointed on shutdown, so once the directory has one it is at
+// least as new as the shutdown snapshot. The snapshot is loaded only into a
+// directory without a log, and checkpointed at once so the log carries it.
+void Coordinator::restoreState() {
+    std::error_code ec;
+    std::filesystem::path dir(state_dir);
+    std::string snapshot = (dir / "shutdown_state.snap").string();
+    bool logged = std::filesystem::exists(dir / "checkpoint.snap", ec) || std::filesystem::exists(dir / "wal.log", ec);
+    bool warm = !logged && std::filesystem::exists(snapshot, ec) && scheduler.loadSnapshot(snapshot);
+    if (!scheduler.enableWriteAheadLog(state_dir)) {
+        scheduler.logEvent("ERROR", "Scheduler state in " + state_dir + " is not logged and will not survive a restart");
+        return;
+    }
+    if (warm) scheduler.checkpoint();
+}
+
+void Coordinator::shutdown() {
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    if (state_dir.empty()) {
+        scheduler.shutdown();
+    } else {
+        scheduler.shutdown((std::filesystem::path(state_dir) / "shutdown_state.snap").string());
+    }
 }
 
 void Coordinator::registerAgent(const Agent& agent) { agent_manager.registerAgent(agent); }
 
+void Coordinator::setDurability(Durability mode, std::chrono::milliseconds window, size_t max_batch) {
+    std::lock_guard<std::mutex> lock(result_mutex);
+    result_durability = mode;
+    group_window = window;
+    group_max = max_batch ? max_batch : 1;
+}
+
+Coordinator::~Coordinator() {
+    {
+        std::lock_guard<std::mutex> lock(lease_mutex);
+        stop_renewing = true;
+    }
+    lease_wake.notify_all();
+    lease_renewer.join();
+}
+
+void Coordinator::setLeaseDuration(std::chrono::seconds lease) {
+    std::lock_guard<std::mutex> lock(lease_mutex);
+    lease_duration = lease;
+    lease_wake.notify_all();
+}
+
+void Coordinator::holdClaim(const std::string& name) {
+    std::lock_guard<std::mutex> lock(lease_mutex);
+    held_claims.insert(name);
+}
+
+// Once dropped, a claim's lease is never written again, so it can be
+// released or left to run out.
+void Coordinator::dropClaim(const std::string& name) {
+    {
+        std::lock_guard<std::mutex> lock(lease_mutex);
+        held_claims.erase(name);
+    }
+    claim_slots.notify_all();
+}
+
+// A model call may outlast the lease, and a claimed file may wait in the
+// pool's queue; neither is abandoned while this process is alive.
+void Coordinator::renewLeases() {
+    std::unique_lock<std::mutex> lock(lease_mutex);
+    while (!stop_renewing) {
+        auto every = std::max<std::chrono::milliseconds>(std::chrono::milliseconds(100), lease_duration / 3);
+        lease_wake.wait_for(lock, every, [this] { return stop_renewing; });
+        if (stop_renewing) break;
+        for (const auto& name : held_claims) spoolRenewLease(in_progress_dir, name, owner, lease_duration);
+    }
+}
+
 void Coordinator::processPendingTasks() {
-    ModelBackend model_backend;
+    if (queue_log) {
+        queue_log->requeueAbandoned(spoolOwnerGone);
+        WorkerPool pool(worker_count);
+        drainQueueLog(pool);
+        pool.wait();
+        return;
+    }
+    spoolReclaimStale(in_progress_dir, pending_dir, lease_duration);
+    std::vector<std::string> names;
     for (const auto& entry : std::filesystem::directory_iterator(pending_dir)) {
-        if (entry.is_regular_file() && entry.path().extension() == ".json") {
-            auto filename = entry.path().filename();
-            std::ifstream task_file(entry.path());
-            std::string content((std::istreambuf_iterator<char>(task_file)), std::istreambuf_iterator<char>());
-            Task task = from_json(content);
-            task_file.close();
-
-            auto in_progress_path = in_progress_dir / filename;
-            std::filesystem::rename(entry.path(), in_progress_path);
-            scheduler.submitTask(task);
-
-            std::string output = "Task processed successfully.";
-            if (model_backend.is_available()) {
-                output = model_backend.run_model(task.description);
-            } else {
-                std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (entry.is_regular_file()) names.push_back(entry.path().filename().string());
+    }
+    if (names.empty()) return;
+    WorkerPool pool(std::min<size_t>(worker_count, names.size()));
+    runTaskFiles(names, pool);
+    pool.wait();
+}
+
+// Files are claimed only as workers come free, so a lease starts when its
+// task does and files this coordinator cannot run yet stay in pending/ for
+// others. By default each worker claims (queue/spool.h) and reads its own
+// file. With io_uring, the calling thread claims, leases and reads one file
+// per idle worker as a batch (utils/batch_io.h). Names that are not task
+// files, or that another worker or process claims first, are skipped.
+void Coordinator::runTaskFiles(const std::vector<std::string>& names, WorkerPool& pool) {
+    std::vector<std::string> candidates;
+    for (const auto& name : names) {
+        if (!name.empty() && name[0] != '.' && std::filesystem::path(name).extension() == ".json") candidates.push_back(name);
+    }
+    if (!batch_io->usingIoUring()) {
+        for (const auto& name : candidates) pool.submit([this, name] { runTaskFile(name); });
+        return;
+    }
+    for (size_t begin = 0; begin < candidates.size();) {
+        size_t idle;
+        {
+            std::unique_lock<std::mutex> lock(lease_mutex);
+            claim_slots.wait(lock, [&] { return held_claims.size() < pool.size(); });
+            idle = pool.size() - held_claims.size();
+        }
+        size_t end = std::min(candidates.size(), begin + idle);
+        std::vector<std::pair<std::string, std::string>> moves;
+        for (size_t i = begin; i < end; ++i) moves.emplace_back((pending_dir / candidates[i]).string(), (in_progress_dir / candidates[i]).string());
+        std::vector<int> errors;
+        batch_io->rename(moves, errors);
+        std::vector<std::string> claimed, paths;
+        std::vector<BatchIo::Write> leases;
+        // Written like spoolClaim's, through a hidden temp file; until a lease
+        // exists, reclaimers go by the claim's ctime.
+        std::string record = spoolLeaseRecord(owner, lease_duration);
+        for (size_t i = 0; i < moves.size(); ++i) {
+            if (errors[i] != 0) continue;
+            const std::string& name = candidates[begin + i];
+            std::string lease = spoolLeaseName(name);
+            holdClaim(name);
+            claimed.push_back(name);
+            paths.push_back(moves[i].second);
+            leases.push_back(BatchIo::Write{(in_progress_dir / ("." + lease + ".tmp")).string(), record, (in_progress_dir / lease).string(), {}});
+        }
+        begin = end;
+        batch_io->write(leases, errors);
+        std::vector<std::string> contents;
+        {
+            TraceSpan read_span("queue_read", std::to_string(paths.size()) + " files");
+            batch_io->read(paths, contents, errors);
+        }
+        for (size_t i = 0; i < claimed.size(); ++i) {
+            if (errors[i] != 0) { // reclaimed as stale in between
+                dropClaim(claimed[i]);
+                continue;
             }
+            pool.submit([this, name = claimed[i], content = std::move(contents[i])] { runClaimedTask(name, content); });
+        }
+    }
+}
+
+void Coordinator::runTaskFile(const std::string& name) {
+    if (!spoolClaim(pending_dir, in_progress_dir, name, owner, lease_duration)) return;
+    holdClaim(name);
+    std::string content;
+    {
+        TraceSpan read_span("queue_read", name);
+        std::ifstream in(in_progress_dir / name, std::ios::binary);
+        if (!in) { // reclaimed as stale in between
+            dropClaim(name);
+            return;
+        }
+        content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    runClaimedTask(name, content);
+}
+
+void Coordinator::runClaimedTask(const std::string& name, const std::string& content) {
+    Task task = from_json(content);
+    {
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        scheduler.submitTask(task);
+    }
+
+    std::string output = "Task processed successfully.";
+    {
+        TraceSpan model_span("model_invocation", traceId(task));
+        if (model_backend->is_available()) {
+            output = model_backend->run_model(task.description);
+        } else {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
 
-            scheduler.markTaskAsCompleted(task.task_id);
-            auto completed_path = completed_dir / filename;
-            std::ofstream result_file(completed_path);
-            result_file << "{\"task_id\": \"" << task.task_id << "\", \"status\": \"completed\", \"output\": \"" << output << "\"}" << std::endl;
-            result_file.close();
-            std::filesystem::remove(in_progress_path);
+    // Model output is free text (quotes, newlines), so both strings are escaped.
+    std::string result = "{\"task_id\": \"";
+    result.reserve(task.task_id.size() + output.size() + 64);
+    append_json_escaped(result, task.task_id);
+    result += "\", \"status\": \"completed\", \"output\": \"";
+    append_json_escaped(result, output);
+    result += "\"}\n";
+    if (!finishTaskFile(name, std::move(result))) return; // stays claimed; requeued once its lease runs out
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    scheduler.markTaskAsCompleted(task.task_id);
+}
+
+// Group commit: each worker hands in its result and waits until it has been
+// written. Whichever waiter finds no write under way becomes the writer: in
+// Group mode it first waits up to group_window for group_max results, then
+// writes everything queued as one batch. False if the result was not written.
+// With the queue log, name is the task id and result the Complete output.
+bool Coordinator::finishTaskFile(const std::string& name, std::string result) {
+    dropClaim(name);
+    std::unique_lock<std::mutex> lock(result_mutex);
+    uint64_t ticket = ++results_handed_in;
+    finished_tasks.push_back(FinishedTask{name, std::move(result), ticket});
+    results_changed.notify_all();
+    while (results_done < ticket) {
+        if (flushing_results) {
+            results_changed.wait(lock);
+            continue;
         }
+        flushing_results = true;
+        if (result_durability == Durability::Group) {
+            results_changed.wait_for(lock, group_window, [this] { return finished_tasks.size() >= group_max; });
+        }
+        size_t take = result_durability == Durability::Each ? 1 : finished_tasks.size();
+        std::vector<FinishedTask> batch(std::make_move_iterator(finished_tasks.begin()), std::make_move_iterator(finished_tasks.begin() + take));
+        finished_tasks.erase(finished_tasks.begin(), finished_tasks.begin() + take);
+        lock.unlock();
+        std::vector<bool> written = writeResults(batch);
+        lock.lock();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (!written[i]) failed_results.insert(batch[i].ticket);
+        }
+        results_done = batch.back().ticket;
+        flushing_results = false;
+        results_changed.notify_all();
+    }
+    return failed_results.erase(ticket) == 0;
+}
+
+// Without durability each result is one chain: write it, then release the
+// claim (the in_progress file, then its lease, as spoolRelease does). With
+// it, each result is fsynced in its chain (the fsyncs of a batch overlap
+// through io_uring), then completed/ is, and only then are the claims
+// released, so a crash never loses a result whose claim is gone. With
+// queue.syncfs=1 one syncfs replaces all of those fsyncs. With the queue log the batch is one append of Complete records,
+// fdatasynced if durable.
+std::vector<bool> Coordinator::writeResults(const std::vector<FinishedTask>& batch) {
+    TraceSpan write_span("result_write", std::to_string(batch.size()) + " results");
+    bool durable = result_durability != Durability::None;
+    if (queue_log) {
+        std::vector<QueueRecord> records;
+        records.reserve(batch.size());
+        for (const auto& task : batch) records.push_back(QueueRecord{QueueRecordType::Complete, task.name, task.result});
+        bool appended = queue_log->append(records, nullptr, durable);
+        coreMetrics().result_batches.inc();
+        if (durable) coreMetrics().result_commits.inc();
+        if (!appended) {
+            std::lock_guard<std::mutex> lock(scheduler_mutex);
+            scheduler.logEvent("ERROR", "Results not written to the queue log: " + queue_log->error());
+        }
+        return std::vector<bool>(batch.size(), appended);
+    }
+    std::vector<BatchIo::Write> writes;
+    std::vector<std::string> releases;
+    writes.reserve(batch.size());
+    for (const auto& task : batch) {
+        std::vector<std::string> release = {(in_progress_dir / task.name).string(), (in_progress_dir / spoolLeaseName(task.name)).string()};
+        writes.push_back(BatchIo::Write{(completed_dir / task.name).string(), task.result, "", durable ? std::vector<std::string>() : release,
+                                        durable && !sync_filesystem});
+        if (durable) releases.insert(releases.end(), release.begin(), release.end());
+    }
+    std::vector<int> errors, sync_errors;
+    batch_io->write(writes, errors);
+    coreMetrics().result_batches.inc();
+    if (durable) {
+        if (sync_filesystem) {
+            batch_io->syncFilesystems({completed_dir.string()}, sync_errors);
+        } else {
+            batch_io->syncDirectories({completed_dir.string()}, sync_errors);
+        }
+        coreMetrics().result_commits.inc();
+        for (auto& error : errors) {
+            if (error == 0) error = sync_errors[0];
+        }
+        std::vector<std::string> released;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (errors[i] == 0) released.insert(released.end(), releases.begin() + 2 * i, releases.begin() + 2 * i + 2);
+        }
+        std::vector<int> ignored; // as with spoolRelease, a claim already gone is fine
+        batch_io->unlink(released, ignored);
+    }
+    std::vector<bool> written(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        written[i] = errors[i] == 0;
+        if (written[i]) continue;
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        scheduler.logEvent("WARN", "Result for " + batch[i].name + ": " + std::strerror(errors[i]));
     }
+    return written;
+}
+
+// Claims what is enqueued past the coordinator cursor and queues it on the
+// pool, one record per idle worker at a time: other coordinators sharing the
+// log take the rest, and a crash strands no more than were running. Returns
+// the number claimed.
+size_t Coordinator::drainQueueLog(WorkerPool& pool) {
+    size_t total = 0;
+    std::vector<QueueRecord> batch;
+    for (;;) {
+        size_t idle;
+        {
+            std::unique_lock<std::mutex> lock(lease_mutex);
+            claim_slots.wait(lock, [&] { return running_log_tasks < pool.size(); });
+            idle = pool.size() - running_log_tasks;
+        }
+        if (!queue_log->claim("coordinator", idle, owner, batch) || batch.empty()) break;
+        {
+            std::lock_guard<std::mutex> lock(lease_mutex);
+            running_log_tasks += batch.size();
+        }
+        total += batch.size();
+        for (auto& record : batch) {
+            pool.submit([this, id = std::move(record.task_id), payload = std::move(record.payload)] {
+                processQueuedTask(id, payload);
+                {
+                    std::lock_guard<std::mutex> lock(lease_mutex);
+                    running_log_tasks--;
+                }
+                claim_slots.notify_all();
+            });
+        }
+    }
+    if (!queue_log->ok()) scheduler.logEvent("ERROR", "Queue log: " + queue_log->error());
+    return total;
+}
+
+void Coordinator::processQueuedTask(const std::string& task_id, const std::string& payload) {
+    Task task = from_json(payload);
+    if (task.task_id.empty()) {
+        queue_log->append(QueueRecord{QueueRecordType::Fail, task_id, "unreadable task"});
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        scheduler.submitTask(task);
+    }
+    std::string output = "Task processed successfully.";
+    {
+        TraceSpan model_span("model_invocation", traceId(task));
+        if (model_backend->is_available()) {
+            output = model_backend->run_model(task.description);
+        } else {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+    if (!finishTaskFile(task_id, std::move(output))) return; // stays claimed; requeued once this process is gone
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    scheduler.markTaskAsCompleted(task.task_id);
+}
+
+void Coordinator::watchPendingTasks() {
+    {
+        std::lock_guard<std::mutex> lock(watch_mutex);
+        if (stop_requested) {
+            stop_requested = false;
+            return;
+        }
+        // Watch before the first scan so nothing written in between is missed.
+        watcher = std::make_unique<DirectoryWatcher>(queue_log ? (pending_dir.parent_path() / "log").string() : pending_dir.string());
+    }
+    if (!watcher->usingInotify()) scheduler.logEvent("WARN", "inotify unavailable for the task queue; polling instead.");
+    if (queue_log) {
+        // Every append ends with the segment and its index closed, so an
+        // append wakes the watch with the .idx name; the records say what
+        // changed. Cursor writes (including this drain's own) wake it too
+        // and are ignored. Claims of exited processes are looked for every 30s.
+        WorkerPool pool(worker_count);
+        std::vector<std::string> names;
+        DirectoryWatcher::Wake wake = DirectoryWatcher::Wake::Rescan;
+        const auto requeue_every = std::chrono::seconds(30);
+        auto next_requeue = std::chrono::steady_clock::now();
+        while (wake != DirectoryWatcher::Wake::Stopped) {
+            bool appended = wake != DirectoryWatcher::Wake::Files ||
+                            std::any_of(names.begin(), names.end(), [](const std::string& name) { return std::filesystem::path(name).extension() == ".idx"; });
+            if (std::chrono::steady_clock::now() >= next_requeue) {
+                queue_log->requeueAbandoned(spoolOwnerGone);
+                next_requeue = std::chrono::steady_clock::now() + requeue_every;
+                appended = true;
+            }
+            if (appended) drainQueueLog(pool);
+            names.clear();
+            auto until_requeue = std::chrono::duration_cast<std::chrono::milliseconds>(next_requeue - std::chrono::steady_clock::now());
+            wake = watcher->wait(names, std::max(until_requeue, std::chrono::milliseconds(0)));
+        }
+    } else {
+        // Declared inside so queued files finish before the watcher goes away.
+        WorkerPool pool(worker_count);
+        std::vector<std::string> names;
+        DirectoryWatcher::Wake wake = DirectoryWatcher::Wake::Rescan;
+        // Stale claims are checked a few times per lease period; requeued
+        // files come back through the watch like any other arrival.
+        auto reclaim_every = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::max<std::chrono::seconds>(std::chrono::seconds(1), std::min<std::chrono::seconds>(lease_duration / 4, std::chrono::minutes(1))));
+        while (wake != DirectoryWatcher::Wake::Stopped) {
+            if (wake == DirectoryWatcher::Wake::Timeout || wake == DirectoryWatcher::Wake::Rescan) {
+                spoolReclaimStale(in_progress_dir, pending_dir, lease_duration);
+            }
+            if (wake == DirectoryWatcher::Wake::Rescan) {
+                for (const auto& entry : std::filesystem::directory_iterator(pending_dir)) {
+                    if (entry.is_regular_file()) names.push_back(entry.path().filename().string());
+                }
+            }
+            runTaskFiles(names, pool);
+            names.clear();
+            wake = watcher->wait(names, reclaim_every);
+        }
+    }
+    std::lock_guard<std::mutex> lock(watch_mutex);
+    watcher.reset();
+    stop_requested = false;
+}
+
+void Coordinator::stopWatching() {
+    std::lock_guard<std::mutex> lock(watch_mutex);
+    if (watcher) watcher->stop();
+    else stop_requested = true;
 }
 
 void Coordinator::run() {
 
     int total_tasks = 0;
-    for (const auto& workflow : project.workflows) for (const auto& task : workflow.tasks) { scheduler.submitTask(task); total_tasks++; }
+    for (const auto& workflow : project.workflows) {
+        for (const auto& task : workflow.tasks) {
+            if (!scheduler.hasTask(task.task_id)) scheduler.submitTask(task); // restored tasks keep their state
+            total_tasks++;
+        }
+    }
     std::map<std::string, std::chrono::steady_clock::time_point> task_finish_times;
     std::map<std::string, std::string> agent_assignments;
     while (scheduler.getCompletedTaskIds().size() < total_tasks) {
@@ -591,15 +1709,18 @@ void Coordinator::run() {
         for (auto it = task_finish_times.begin(); it != task_finish_times.end(); ) {
             if (now >= it->second) {
                 const std::string& task_id = it->first;
-                scheduler.markTaskAsCompleted(task_id);
+                std::string assigned_agent;
                 for (auto const& [agent_id, assigned_task_id] : agent_assignments) {
                     if (assigned_task_id == task_id) {
-                        agent_manager.setAgentState(agent_id, AgentState::IDLE);
-
-                        agent_assignments.erase(agent_id);
+                        assigned_agent = agent_id;
                         break;
                     }
                 }
+                scheduler.markTaskAsCompleted(task_id, assigned_agent);
+                if (!assigned_agent.empty()) {
+                    agent_manager.setAgentState(assigned_agent, AgentState::IDLE);
+                    agent_assignments.erase(assigned_agent);
+                }
 
                 it = task_finish_times.erase(it);
             } else ++it;
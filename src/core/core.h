@@ -13,27 +13,69 @@
 #include <fstream>
 #include <set>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "../models/models.h"
 #include "../events/events.h"
+#include "../utils/cache.h"
+#include "../utils/latency_histogram.h"
+#include "../storage/wal.h"
+
+struct NdjsonBatch;
+class FdSink;
+class DirectoryWatcher;
+class ModelBackend;
+class BatchIo;
+class QueueLog;
+class WorkerPool;
+
+// Outcome of a bulk import.
+struct ImportSummary {
+    size_t lines = 0;      // non-blank input lines
+    size_t imported = 0;
+    size_t malformed = 0;  // lines that did not parse
+    size_t invalid = 0;    // rejected by validateTask
+    size_t duplicates = 0; // already scheduled, or repeated within the input
+    bool cycle = false;    // batch rejected: its dependencies form a cycle
+};
 
 class Scheduler {
 public:
     Scheduler(Publisher& pub);
+    ~Scheduler();
     void submitTask(const Task& task);
     Task* getNextAvailableTask();
-    void markTaskAsCompleted(const std::string& taskId);
+    void markTaskAsCompleted(const std::string& taskId, const std::string& agentId = "");
 
     // Schedule Management
-    void setSchedule(const Schedule& schedule);
+    // Merges the schedule's tasks into the table; false (nothing applied) on a dependency cycle.
+    bool setSchedule(const Schedule& schedule);
+    bool setSchedule(Schedule&& schedule);
     const Schedule& getSchedule() const { return current_schedule; }
-    void saveSchedule(const std::string& filepath);
+    void saveSchedule(const std::string& filepath, bool durable = false); // durable: fsync before returning
     void loadSchedule(const std::string& filepath);
+    // Binary snapshot of the whole scheduler state (storage/snapshot.h). Loading
+    // replaces tasks, drafts, queue and retry state instead of merging.
+    bool saveSnapshot(const std::string& filepath, bool durable = false);
+    bool loadSnapshot(const std::string& filepath);
+    // Write-ahead log (storage/wal.h): restores directory/checkpoint.snap, replays
+    // directory/wal.log on top of it, then logs every state transition with group
+    // commit. Tasks that were in progress are queued again. checkpoint() snapshots
+    // the state and truncates the log; it also runs on its own once the log
+    // reaches options.checkpoint_bytes.
+    bool enableWriteAheadLog(const std::string& directory, const WalOptions& options = WalOptions());
+    bool checkpoint();
+    bool syncWriteAheadLog(); // waits until every logged transition is on disk
     void removeTask(const std::string& taskId);
 
     void pauseTask(const std::string& taskId);
     void resumeTask(const std::string& taskId);
     TaskStatus getTaskStatus(const std::string& taskId) const;
+    bool hasTask(const std::string& taskId) const { return tasks.count(taskId) > 0; }
 
     // Enhancements
     void addTaskTemplate(const TaskTemplate& tmpl);
@@ -44,28 +86,65 @@ public:
     void submitDraftTask(const std::string& taskId);
     void batchCreateTasks(const std::vector<Task>& tasks);
     std::string exportToCSV() const;
+    // Streams the same CSV row by row (one status lookup per row), so memory
+    // stays bounded by the sink buffer. False on a write error; the caller
+    // flushes or closes the sink.
+    bool exportToCSV(FdSink& sink) const;
     void archiveTask(const std::string& taskId);
     void restoreTask(const std::string& taskId);
     void agePriorities();
     std::vector<Task> getTopologicallySortedTasks(const std::vector<Task>& tasks_to_sort) const;
     std::vector<Task> searchTasks(const std::string& query);
     std::string getCachedCalculation(const std::string& key);
-    void setCachedCalculation(const std::string& key, const std::string& value);
+    // The value is dropped once any of taskIds changes, the scheduler state is
+    // replaced wholesale (snapshot load) or the cache TTL runs out.
+    void setCachedCalculation(const std::string& key, const std::string& value, const std::vector<std::string>& taskIds = {});
+    void configureCache(size_t capacity, int ttl_sec);
+    CacheStats getCacheStats() const;
     std::vector<std::string> detectOrphanedDependencies() const;
     void compactArchive();
     std::string exportToJSON() const;
     void importFromJSON(const std::string& json);
     std::string exportToLineDelimitedJSON() const;
+    bool exportToLineDelimitedJSON(FdSink& sink) const;
+    // Columnar analytics export (storage/columnar.h) of every task with its
+    // status, one row group of rows_per_group tasks at a time.
+    bool exportColumnar(FdSink& sink, size_t rows_per_group = 64 * 1024) const;
+    // Parallel NDJSON import, one task per line (utils/ndjson.h). The parsed
+    // batch is merged in one pass (validateTask, duplicates against the
+    // scheduler and within the batch) and cycle-checked as a whole, then
+    // submitted dependency-first. A cycle rejects the whole batch.
+    ImportSummary importFromLineDelimitedJSON(std::string_view ndjson, unsigned threads = 0);
+    ImportSummary importLineDelimitedFile(const std::string& filepath, unsigned threads = 0);
+    // Full backup of the task table (storage/backup.h), block-compressed on
+    // all hardware threads. restoreBackup replays incremental chains, replacing the task table, and also
+    // takes plain or compressed schedule JSON and snapshots.
     void createBackup(const std::string& backupPath);
+    // Writes only the tasks changed or removed since the last backup this
+    // scheduler wrote or restored, chained to it (a full backup if there is
+    // none in the same directory).
+    bool createIncrementalBackup(const std::string& backupPath);
     void restoreBackup(const std::string& backupPath);
+    // Restores the newest backup in the directory's catalog whose chain is
+    // intact, falling back to older ones.
+    bool restoreLatestBackup(const std::string& directory);
+    // Keeps the newest maxBackups backups listed in the directory's catalog.
+    // An incremental backup whose parent would be pruned is first rebased into
+    // a full backup.
     void pruneBackups(const std::string& directory, int maxBackups);
     void runMigration(const std::string& targetVersion);
     void rollbackMigration(const std::string& rollbackFile);
-    void shutdown();
+    // Checkpoints the write-ahead log, if any, and saves a snapshot.
+    void shutdown(const std::string& snapshotPath = "shutdown_state.snap");
     void logEvent(const std::string& level, const std::string& message) const;
     int getCompletedTaskCount() const;
     int getFailedTaskCount() const;
     double getRollingAverageCompletionTime() const;
+    double getCompletionTimePercentile(double percentile) const;
+    const LatencyHistogram& getCompletionLatency() const { return completion_latency; }
+    LatencyHistogram getComponentLatency(const std::string& component) const;
+    LatencyHistogram getPriorityLatency(const std::string& priority) const;
+    LatencyHistogram getAgentLatency(const std::string& agentId) const;
     bool validateTask(const Task& task) const;
     std::string renderHumanReadableTimestamp(const std::string& utc_timestamp) const;
     void setRetryLimit(int limit);
@@ -107,10 +186,43 @@ private:
     enum class CircuitState { CLOSED, OPEN, HALF_OPEN } circuit_state = CircuitState::CLOSED;
     std::chrono::steady_clock::time_point last_circuit_failure;
 
-    std::map<std::string, std::string> calculation_cache;
-    std::vector<double> completion_times;
+    CalculationCache calculation_cache;
+    LatencyHistogram completion_latency;
+    RollingWindow completion_window;
+    std::map<std::string, LatencyHistogram> component_latency;
+    std::map<std::string, LatencyHistogram> priority_latency;
+    std::map<std::string, LatencyHistogram> agent_latency;
     std::map<std::string, std::chrono::steady_clock::time_point> task_start_times;
     bool areDependenciesMet(const Task& task);
+    bool dependencyOrder(const std::vector<Task>& list, std::vector<size_t>& order) const;
+    void applySchedule(Schedule&& schedule, const std::vector<size_t>& order);
+    void clearTaskState();
+    template <typename Visit>
+    void forEachTaskStatus(Visit visit) const;
+    bool applyScheduleText(std::string_view text, const std::string& source); // false (nothing applied) on a parse error
+    void invalidateCachedCalculations();
+    void invalidateCachedCalculations(const std::string& taskId);
+    ImportSummary mergeImportedTasks(NdjsonBatch& batch);
+
+    std::unique_ptr<WriteAheadLog> wal;
+    std::string wal_directory;
+    WalOptions wal_options;
+    uint64_t snapshot_wal_lsn = 0; // LSN recorded in the last loaded snapshot
+    void logTransition(WalOp op, std::string_view a = {}, std::string_view b = {});
+    void applyWalRecord(const WalRecord& record);
+    void replayTaskFailure(const std::string& taskId);
+
+    // Change tracking for incremental backups: every edit to a task record
+    // takes the next sequence number.
+    uint64_t change_sequence = 0;
+    std::unordered_map<std::string, uint64_t> task_changes;
+    std::unordered_set<std::string> removed_since_backup;
+    std::string last_backup_path; // parent of the next incremental backup
+    uint64_t last_backup_sequence = 0;
+    void recordChange(const std::string& taskId);
+    void resetChangeTracking();
+    bool writeBackup(const std::string& backupPath, bool incremental);
+    bool restoreBackupChain(const std::string& backupPath);
 
 public:
     const std::vector<std::string>& getCompletedTaskIds() const { return completed_task_ids; }
@@ -137,14 +249,73 @@ private:
 class Coordinator {
 public:
     Coordinator(Project p, const std::string& queue_dir);
+    ~Coordinator();
     void run();
     void registerAgent(const Agent& agent);
     const Scheduler& getScheduler() const { return scheduler; }
     const AgentManager& getAgentManager() const { return agent_manager; }
     Publisher& getEventPublisher() { return event_publisher; }
+    // Runs every pending task file on the worker pool and returns when all are done.
     void processPendingTasks();
+    // Processes what is already pending, then each task file as soon as it is
+    // written into or renamed into pending/ (utils/dir_watcher.h), until
+    // stopWatching() is called from another thread.
+    void watchPendingTasks();
+    void stopWatching();
+    // Task files processed at once (queue.workers in .quanta, default one per
+    // hardware thread). Model calls are further capped by model.max_concurrency.
+    void setWorkerCount(unsigned workers) { worker_count = workers ? workers : 1; }
+    unsigned workerCount() const { return worker_count; }
+    // Several coordinator processes may share one queue directory
+    // (queue/spool.h). Claims are leased for this long (queue.lease_sec,
+    // default 600) and then handed to another worker. A background thread
+    // renews the leases of claims this coordinator still holds every third
+    // of that, so only claims of a stopped or hung process run out.
+    void setLeaseDuration(std::chrono::seconds lease);
+    const std::string& ownerId() const { return owner; }
+    // With queue.backend=log in .quanta, tasks are records in queue/log
+    // (queue/queue_log.h) instead of files in pending/, and results are
+    // Complete records.
+    bool usingQueueLog() const { return queue_log != nullptr; }
+    // Scheduler state survives restarts (scheduler.wal_dir in .quanta, default
+    // <queue_dir>/state, "none" to turn off): the constructor restores it from
+    // the write-ahead log there, or else from the snapshot shutdown() left,
+    // requeueing tasks that were in progress, and logs every transition.
+    const std::string& stateDirectory() const { return state_dir; }
+    // Checkpoints the log and saves shutdown_state.snap in the state directory.
+    void shutdown();
+    // How results reach the disk (queue.durability in .quanta): None writes
+    // them without syncing. Group fsyncs each batch of results and then their
+    // directory (or, with the queue log, fdatasyncs the log once), waiting up
+    // to window (queue.group_commit_ms) for max_batch results
+    // (queue.group_commit_max) to share one commit. queue.syncfs=1 replaces
+    // a batch's fsyncs with one syncfs of the whole filesystem; it needs
+    // Linux 5.8 or later to report writeback errors. Each commits every result
+    // on its own. A task counts as completed, and its claim is released, only
+    // once its result is written and, unless None, durable.
+    enum class Durability { None, Group, Each };
+    void setDurability(Durability mode, std::chrono::milliseconds window = std::chrono::milliseconds(5), size_t max_batch = 64);
+    Durability durability() const { return result_durability; }
 
 private:
+    struct FinishedTask {
+        std::string name; // of the task file, or the task id with the queue log
+        std::string result;
+        uint64_t ticket = 0; // position in the order results were handed in
+    };
+
+    void runTaskFiles(const std::vector<std::string>& names, WorkerPool& pool);
+    void runTaskFile(const std::string& name);
+    void runClaimedTask(const std::string& name, const std::string& content);
+    bool finishTaskFile(const std::string& name, std::string result);
+    void holdClaim(const std::string& name);
+    void dropClaim(const std::string& name);
+    void renewLeases();
+    void restoreState();
+    std::vector<bool> writeResults(const std::vector<FinishedTask>& batch);
+    void processQueuedTask(const std::string& task_id, const std::string& payload);
+    size_t drainQueueLog(WorkerPool& pool);
+
     Publisher event_publisher;
     Scheduler scheduler;
     AgentManager agent_manager;
@@ -153,6 +324,35 @@ private:
     std::filesystem::path in_progress_dir;
     std::filesystem::path completed_dir;
     std::filesystem::path failed_dir;
+    std::unique_ptr<ModelBackend> model_backend; // shared by all workers
+    unsigned worker_count = 1;
+    std::mutex scheduler_mutex; // workers share the scheduler
+    std::string state_dir;      // of the scheduler's write-ahead log; empty if off
+    std::string owner;
+    std::chrono::seconds lease_duration{600};
+    std::mutex lease_mutex;
+    std::condition_variable lease_wake;
+    std::set<std::string> held_claims; // task files claimed and not yet finished
+    std::condition_variable claim_slots; // a held claim was dropped or a log task finished
+    size_t running_log_tasks = 0;        // queue log records claimed and not yet finished
+    bool stop_renewing = false;
+    std::thread lease_renewer; // runs renewLeases() until the destructor
+    std::unique_ptr<QueueLog> queue_log;
+    std::unique_ptr<BatchIo> batch_io; // task file claims, reads and results
+    std::mutex result_mutex;
+    std::condition_variable results_changed;
+    std::deque<FinishedTask> finished_tasks; // waiting for the next result batch
+    bool flushing_results = false;
+    uint64_t results_handed_in = 0;
+    uint64_t results_done = 0;        // every ticket up to here is written (or failed)
+    std::set<uint64_t> failed_results; // tickets whose write failed, until collected
+    Durability result_durability = Durability::None;
+    bool sync_filesystem = false; // queue.syncfs: one syncfs per durable batch instead of fsyncs
+    std::chrono::milliseconds group_window{5};
+    size_t group_max = 64;
+    std::mutex watch_mutex;
+    std::unique_ptr<DirectoryWatcher> watcher;
+    bool stop_requested = false;
 };
 
 #endif // CORE_H
@@ -2,6 +2,10 @@
 #include "cli/cli.h"
 #include "ui/SchedulerUI.h"
 #include "utils/json_utils.h"
+#include "utils/metrics.h"
+#include "utils/tracing.h"
+#include "utils/logger.h"
+#include "utils/fd_sink.h"
 #include <iostream>
 #include <string>
 #include <vector>
@@ -9,6 +13,25 @@
 #include <iomanip>
 #include <fstream>
 #include <filesystem>
+#include <charconv>
+#include <cstring>
+#include <unistd.h>
+
+// Tasks currently waiting in ./queue/pending as a schedule.
+Schedule loadPendingSchedule() {
+    Schedule sch("cli_sch", "CLI Schedule");
+    std::filesystem::path pending_dir("./queue/pending");
+    if (std::filesystem::exists(pending_dir)) {
+        for (const auto& entry : std::filesystem::directory_iterator(pending_dir)) {
+            if (entry.path().extension() == ".json") {
+                std::ifstream f(entry.path());
+                std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+                sch.addTask(from_json(content));
+            }
+        }
+    }
+    return sch;
+}
 
 // --- Helper functions for logging enums ---
 std::string to_string(TaskStatus status) {
@@ -77,9 +100,47 @@ int main(int argc, char* argv[]) {
             pub.subscribe(EventType::TaskStatusChanged, &logger);
             pub.subscribe(EventType::AgentStateChanged, &logger);
             std::cout << "Logging subscriber registered." << std::endl;
+            MetricsExporter metrics_exporter;
+            std::string trace_path;
+            LoggerConfig log_config;
+            for (int i = 2; i + 1 < argc; ++i) {
+                std::string flag = argv[i];
+                if (flag == "--metrics-port") {
+                    int port = 0;
+                    const char* value = argv[i + 1];
+                    auto parsed = std::from_chars(value, value + std::strlen(value), port);
+                    if (parsed.ec != std::errc() || *parsed.ptr != '\0' || port < 0 || port > 65535) {
+                        std::cerr << "Usage: quantalista daemon [--watch] [--metrics-port <0-65535>] [--metrics-file <path>] [--trace-file <path>] [--log-file <path>] [--log-level <level>]" << std::endl;
+                        return 1;
+                    }
+                    if (metrics_exporter.startHttpEndpoint(port)) {
+                        std::cout << "Serving metrics on http://127.0.0.1:" << argv[i + 1] << "/metrics" << std::endl;
+                    } else {
+                        std::cerr << "Failed to bind metrics port " << argv[i + 1] << std::endl;
+                    }
+                } else if (flag == "--metrics-file") {
+                    metrics_exporter.startFileExport(argv[i + 1], std::chrono::seconds(5));
+                } else if (flag == "--trace-file") {
+                    trace_path = argv[i + 1];
+                    Tracer::instance().enable();
+                } else if (flag == "--log-file") {
+                    log_config.file_path = argv[i + 1];
+                } else if (flag == "--log-level") {
+                    log_config.min_level = parseLogLevel(argv[i + 1]);
+                }
+            }
+            Logger::instance().configure(log_config);
             coordinator.registerAgent(Agent("agent-001", "Researcher"));
             coordinator.registerAgent(Agent("agent-002", "Writer"));
             coordinator.run();
+            if (std::find(argv + 2, argv + argc, std::string("--watch")) != argv + argc) {
+                std::cout << "Watching ./queue/pending for new tasks." << std::endl;
+                coordinator.watchPendingTasks();
+            }
+            coordinator.shutdown();
+            if (!trace_path.empty() && Tracer::instance().dumpChromeTrace(trace_path)) {
+                std::cout << "Trace written to " << trace_path << std::endl;
+            }
         } else if (command == "ui") {
             Greenhouse::UI::SchedulerUI ui;
             std::string view = (argc > 2) ? argv[2] : "patient";
@@ -108,17 +169,7 @@ int main(int argc, char* argv[]) {
                 Publisher pub;
                 Scheduler scheduler(pub);
                 if (subCommand == "save") {
-                    Schedule sch("cli_sch", "CLI Schedule");
-                    std::filesystem::path pending_dir("./queue/pending");
-                    if (std::filesystem::exists(pending_dir)) {
-                        for (const auto& entry : std::filesystem::directory_iterator(pending_dir)) {
-                            if (entry.path().extension() == ".json") {
-                                std::ifstream f(entry.path());
-                                std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
-                                sch.addTask(from_json(content));
-                            }
-                        }
-                    }
+                    Schedule sch = loadPendingSchedule();
                     scheduler.setSchedule(sch);
                     scheduler.saveSchedule(path);
                     std::cout << "Schedule saved to " << path << ". Saved " << sch.tasks.size() << " tasks." << std::endl;
@@ -130,14 +181,43 @@ int main(int argc, char* argv[]) {
             } else {
                 std::cout << "Usage: quantalista schedule <save|load> <path>" << std::endl;
             }
+        } else if (command == "export") {
+            std::string format = "csv";
+            std::string input;
+            for (int i = 2; i + 1 < argc; ++i) {
+                std::string flag = argv[i];
+                if (flag == "--format") format = argv[++i];
+                else if (flag == "--input") input = argv[++i];
+            }
+            if (format != "csv" && format != "ndjson" && format != "columnar") {
+                std::cerr << "Usage: quantalista export [--format csv|ndjson|columnar] [--input <schedule-or-snapshot>]" << std::endl;
+                return 1;
+            }
+            // stdout carries the export, so log records go to stderr.
+            LoggerConfig log_config;
+            log_config.console_stderr = true;
+            Logger::instance().configure(log_config);
+            Publisher pub;
+            Scheduler scheduler(pub);
+            if (input.empty()) scheduler.setSchedule(loadPendingSchedule());
+            else scheduler.restoreBackup(input);
+            FdSink out(STDOUT_FILENO);
+            bool ok = format == "csv"        ? scheduler.exportToCSV(out)
+                      : format == "ndjson"   ? scheduler.exportToLineDelimitedJSON(out)
+                                             : scheduler.exportColumnar(out);
+            if (!out.close() || !ok) {
+                std::cerr << "Export failed: " << std::strerror(out.lastError()) << std::endl;
+                return 1;
+            }
         } else handleCommand(argc, argv);
     } else {
         std::cout << "Usage: " << argv[0] << " <command>" << std::endl;
         std::cout << "Commands:" << std::endl;
-        std::cout << "  daemon      - Run the QuantaLista daemon" << std::endl;
+        std::cout << "  daemon      - Run the QuantaLista daemon [--watch] [--metrics-port <port>] [--metrics-file <path>] [--trace-file <path>] [--log-file <path>] [--log-level <level>]" << std::endl;
         std::cout << "  add         - Add a new task to the queue" << std::endl;
         std::cout << "  list        - List all tasks in the queue" << std::endl;
         std::cout << "  schedule    - Save or load a schedule (save|load <path>)" << std::endl;
+        std::cout << "  export      - Stream tasks to stdout [--format csv|ndjson|columnar] [--input <schedule-or-snapshot>]" << std::endl;
         std::cout << "  ui [view]   - Display the Greenhouse Scheduler UI (patient|dashboard|admin)" << std::endl;
     }
     return 0;
@@ -5,9 +5,25 @@
 #include <array>
 #include <memory>
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include "../utils/metrics.h"
+
+namespace {
+Histogram& modelLatency() {
+    static Histogram& h = MetricsRegistry::instance().histogram("quantalista_model_run_seconds", "ModelBackend::run_model latency");
+    return h;
+}
+
+Counter& modelErrors() {
+    static Counter& c = MetricsRegistry::instance().counter("quantalista_model_errors_total", "ModelBackend::run_model calls that returned an error");
+    return c;
+}
+}
 
 ModelBackend::ModelBackend() {
     load_config();
+    concurrency_limit = static_cast<unsigned>(std::strtoul(config_value("model.max_concurrency", "0").c_str(), nullptr, 10));
 }
 
 void ModelBackend::load_config() {
@@ -32,30 +48,57 @@ bool ModelBackend::is_available() const {
     return config.count("model.llama_cli_path") && config.count("engine.model_path");
 }
 
+std::string ModelBackend::config_value(const std::string& key, const std::string& fallback) const {
+    auto it = config.find(key);
+    return it == config.end() ? fallback : it->second;
+}
+
 std::string ModelBackend::run_model(const std::string& input) {
     if (!is_available()) {
+        modelErrors().inc();
         return "Error: Model backend not configured.";
     }
 
+    // Hold one of the backend's slots until this call returns.
+    struct Slot {
+        ModelBackend& backend;
+        explicit Slot(ModelBackend& b) : backend(b) {
+            std::unique_lock<std::mutex> lock(backend.slot_mutex);
+            backend.slot_freed.wait(lock, [this] { return backend.concurrency_limit == 0 || backend.running < backend.concurrency_limit; });
+            backend.running++;
+        }
+        ~Slot() {
+            {
+                std::lock_guard<std::mutex> lock(backend.slot_mutex);
+                backend.running--;
+            }
+            backend.slot_freed.notify_one();
+        }
+    } slot(*this);
+
     std::string llama_path = config.at("model.llama_cli_path");
     std::string model_path = config.at("engine.model_path");
 
     std::stringstream cmd;
     cmd << llama_path << " -m " << model_path << " -p \"" << input << "\" -n 128 --temp 0 --no-display-prompt --log-disable --simple-io --single-turn --no-show-timings 2>/dev/null";
 
+    auto started = std::chrono::steady_clock::now();
     std::array<char, 256> buffer;
     std::string result;
     std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.str().c_str(), "r"), pclose);
 
     if (!pipe) {
+        modelErrors().inc();
         return "Error: Failed to launch llama-cli.";
     }
 
     while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
         result += buffer.data();
     }
+    modelLatency().observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
 
     if (result.empty()) {
+        modelErrors().inc();
         return "Error: No output from model.";
     }
 
@@ -1,18 +1,30 @@
 #ifndef MODEL_BACKEND_H
 #define MODEL_BACKEND_H
 
+#include <condition_variable>
 #include <string>
 #include <map>
+#include <mutex>
 
+// Reads .quanta once; run_model may be called from several threads.
 class ModelBackend {
 public:
     ModelBackend();
+    // Waits while model.max_concurrency runs are already in flight.
     std::string run_model(const std::string& input);
     bool is_available() const;
+    // A .quanta setting, or fallback if it is not set.
+    std::string config_value(const std::string& key, const std::string& fallback = "") const;
+    unsigned max_concurrency() const { return concurrency_limit; } // 0: unlimited
 
 private:
     std::map<std::string, std::string> config;
     void load_config();
+
+    std::mutex slot_mutex;
+    std::condition_variable slot_freed;
+    unsigned running = 0;
+    unsigned concurrency_limit = 0;
 };
 
 #endif // MODEL_BACKEND_H
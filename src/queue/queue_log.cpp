@@ -0,0 +1,407 @@
+#include "queue_log.h"
+#include "../utils/crc32c.h"
+#include "../utils/mapped_file.h"
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kSegmentMagic[8] = {'Q', 'L', 'Q', 'L', 'O', 'G', '0', '1'};
+constexpr size_t kRecordHeaderBytes = 8; // body length, crc
+constexpr uint32_t kMaxBodyBytes = 64u << 20;
+constexpr uint64_t kBatchEnd = 1ull << 63; // set on the index entry of each batch's last record
+
+std::string segmentName(uint64_t base, const char* extension) {
+    char name[40];
+    std::snprintf(name, sizeof(name), "%020" PRIu64 "%s", base, extension);
+    return name;
+}
+
+bool writeAllAt(int fd, const char* data, size_t n, uint64_t offset) {
+    while (n > 0) {
+        ssize_t w = ::pwrite(fd, data, n, static_cast<off_t>(offset));
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        data += w;
+        n -= static_cast<size_t>(w);
+        offset += static_cast<uint64_t>(w);
+    }
+    return true;
+}
+
+uint64_t fileSize(int fd) {
+    struct stat st;
+    return ::fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+void encodeRecord(std::string& out, const QueueRecord& record) {
+    size_t start = out.size();
+    uint32_t header[2] = {0, 0};
+    out.append(reinterpret_cast<const char*>(header), sizeof(header));
+    out.push_back(static_cast<char>(record.type));
+    uint32_t id_bytes = static_cast<uint32_t>(record.task_id.size());
+    out.append(reinterpret_cast<const char*>(&id_bytes), sizeof(id_bytes));
+    out += record.task_id;
+    out += record.payload;
+    header[0] = static_cast<uint32_t>(out.size() - start - kRecordHeaderBytes);
+    header[1] = crc32c(out.data() + start + kRecordHeaderBytes, header[0]);
+    std::memcpy(&out[start], header, sizeof(header));
+}
+
+// Parses the record at offset; size receives its total length. False if it
+// is cut short or fails its checksum.
+bool decodeRecord(std::string_view bytes, uint64_t offset, QueueRecord* record, uint64_t& size) {
+    uint32_t header[2];
+    if (offset > bytes.size() || bytes.size() - offset < kRecordHeaderBytes) return false;
+    std::memcpy(header, bytes.data() + offset, sizeof(header));
+    if (header[0] < 5 || header[0] > kMaxBodyBytes || bytes.size() - offset - kRecordHeaderBytes < header[0]) return false;
+    const char* body = bytes.data() + offset + kRecordHeaderBytes;
+    if (crc32c(body, header[0]) != header[1]) return false;
+    uint32_t id_bytes;
+    std::memcpy(&id_bytes, body + 1, sizeof(id_bytes));
+    if (id_bytes > header[0] - 5) return false;
+    if (record) {
+        record->type = static_cast<QueueRecordType>(body[0]);
+        record->task_id.assign(body + 5, id_bytes);
+        record->payload.assign(body + 5 + id_bytes, header[0] - 5 - id_bytes);
+    }
+    size = kRecordHeaderBytes + header[0];
+    return true;
+}
+
+} // namespace
+
+struct QueueLog::Segment {
+    uint64_t base = 0;
+    std::string seg_path;
+    std::string idx_path;
+    MappedFile seg; // remapped when the files have grown
+    MappedFile idx;
+    int seg_fd = -1; // open only under the lock, on the tail
+    int idx_fd = -1;
+
+    ~Segment() { closeFds(); }
+    void closeFds() {
+        if (seg_fd >= 0) ::close(seg_fd);
+        if (idx_fd >= 0) ::close(idx_fd);
+        seg_fd = idx_fd = -1;
+    }
+    // Entries up to the end of the last whole batch; a batch whose index
+    // write is still going (or was cut short) is not visible.
+    uint64_t count() const { return visible; }
+    uint64_t entry(uint64_t k) const {
+        uint64_t value;
+        std::memcpy(&value, idx.view().data() + k * sizeof(value), sizeof(value));
+        return value;
+    }
+    uint64_t offset(uint64_t k) const { return entry(k) & ~kBatchEnd; }
+    // Maps the index (and segment) again if it holds fewer than `needed` entries.
+    void remapFor(uint64_t needed) {
+        if (count() >= needed && seg.is_open()) return;
+        idx.open(idx_path);
+        seg.open(seg_path);
+        visible = idx.size() / sizeof(uint64_t);
+        while (visible > 0 && !(entry(visible - 1) & kBatchEnd)) --visible;
+    }
+
+    uint64_t visible = 0;
+};
+
+// Holds the process mutex and the directory's flock. The tail is closed on
+// release, so each batch ends in IN_CLOSE_WRITE for a DirectoryWatcher.
+class QueueLog::Lock {
+public:
+    explicit Lock(QueueLog& owner) : log(owner), guard(owner.mutex) {
+        while (log.lock_fd >= 0 && ::flock(log.lock_fd, LOCK_EX) != 0 && errno == EINTR) {}
+    }
+    ~Lock() {
+        for (auto& entry : log.segments) entry.second->closeFds();
+        if (log.lock_fd >= 0) ::flock(log.lock_fd, LOCK_UN);
+    }
+
+private:
+    QueueLog& log;
+    std::lock_guard<std::mutex> guard;
+};
+
+QueueLog::QueueLog(const std::string& dir, uint64_t bytes) : directory(dir), segment_bytes(bytes) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    lock_fd = ::open((std::filesystem::path(directory) / "lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lock_fd < 0) {
+        fail("cannot open " + directory + "/lock: " + std::strerror(errno));
+        return;
+    }
+    Lock lock(*this);
+    refreshSegments();
+    if (segments.empty()) createSegment(0);
+}
+
+QueueLog::~QueueLog() {
+    segments.clear();
+    if (lock_fd >= 0) ::close(lock_fd);
+}
+
+bool QueueLog::fail(const std::string& message) {
+    error_message = message;
+    return false;
+}
+
+bool QueueLog::refreshSegments() {
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".seg") continue;
+        std::string stem = it->path().stem().string();
+        char* parsed_end = nullptr;
+        uint64_t base = std::strtoull(stem.c_str(), &parsed_end, 10);
+        if (stem.empty() || *parsed_end != '\0' || segments.count(base)) continue;
+        auto segment = std::make_unique<Segment>();
+        segment->base = base;
+        segment->seg_path = (std::filesystem::path(directory) / segmentName(base, ".seg")).string();
+        segment->idx_path = (std::filesystem::path(directory) / segmentName(base, ".idx")).string();
+        segments.emplace(base, std::move(segment));
+    }
+    return !ec;
+}
+
+bool QueueLog::createSegment(uint64_t base) {
+    std::string seg_path = (std::filesystem::path(directory) / segmentName(base, ".seg")).string();
+    std::string idx_path = (std::filesystem::path(directory) / segmentName(base, ".idx")).string();
+    // The index first: a segment is only listed once its index exists.
+    int idx_fd = ::open(idx_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    int seg_fd = idx_fd < 0 ? -1 : ::open(seg_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (seg_fd < 0 || !writeAllAt(seg_fd, kSegmentMagic, sizeof(kSegmentMagic), 0)) {
+        if (idx_fd >= 0) ::close(idx_fd);
+        if (seg_fd >= 0) ::close(seg_fd);
+        return fail("cannot create segment " + seg_path + ": " + std::strerror(errno));
+    }
+    ::close(seg_fd);
+    ::close(idx_fd);
+    refreshSegments();
+    return true;
+}
+
+bool QueueLog::openTail() {
+    if (segments.empty()) refreshSegments();
+    if (segments.empty()) return fail("no segments in " + directory);
+    Segment* last = segments.rbegin()->second.get();
+    uint64_t idx_size = 0;
+    for (;;) {
+        if (last->seg_fd < 0) {
+            last->seg_fd = ::open(last->seg_path.c_str(), O_RDWR | O_CLOEXEC);
+            last->idx_fd = ::open(last->idx_path.c_str(), O_RDWR | O_CLOEXEC);
+            if (last->seg_fd < 0 || last->idx_fd < 0) {
+                last->closeFds();
+                return fail("cannot open segment " + last->seg_path + ": " + std::strerror(errno));
+            }
+        }
+        idx_size = fileSize(last->idx_fd);
+        // A segment rolled by another process starts right after this one's
+        // last indexed record.
+        if (!nextSegmentExists(*last, idx_size / sizeof(uint64_t))) break;
+        last->closeFds();
+        refreshSegments();
+        last = segments.rbegin()->second.get();
+    }
+    Segment& tail = *last;
+    uint64_t seg_size = fileSize(tail.seg_fd);
+    tail.remapFor(UINT64_MAX);
+    uint64_t end = sizeof(kSegmentMagic);
+    uint64_t size = 0;
+    if (tail.count() > 0) {
+        if (!decodeRecord(tail.seg.view(), tail.offset(tail.count() - 1), nullptr, size)) return fail(tail.seg_path + ": last indexed record is corrupt");
+        end = tail.offset(tail.count() - 1) + size;
+    }
+    // Anything past the last whole batch was written by an append that died
+    // before finishing its index: drop it, so a batch lands whole or not at all.
+    uint64_t idx_end = tail.count() * sizeof(uint64_t);
+    if (idx_size != idx_end && ::ftruncate(tail.idx_fd, static_cast<off_t>(idx_end)) != 0) return fail("cannot repair " + tail.idx_path);
+    if (seg_size != end && ::ftruncate(tail.seg_fd, static_cast<off_t>(end)) != 0) return fail("cannot repair " + tail.seg_path);
+    return true;
+}
+
+bool QueueLog::append(const std::vector<QueueRecord>& records, uint64_t* first, bool durable) {
+    if (records.empty() || lock_fd < 0) return records.empty();
+    Lock lock(*this);
+    return appendLocked(records, first, durable);
+}
+
+bool QueueLog::appendLocked(const std::vector<QueueRecord>& records, uint64_t* first, bool durable) {
+    if (!openTail()) return false;
+    Segment& tail = *segments.rbegin()->second;
+    uint64_t seg_end = fileSize(tail.seg_fd);
+    uint64_t idx_bytes = tail.count() * sizeof(uint64_t);
+    std::string bytes;
+    std::vector<uint64_t> offsets;
+    offsets.reserve(records.size());
+    for (const auto& record : records) {
+        offsets.push_back(seg_end + bytes.size());
+        encodeRecord(bytes, record);
+    }
+    offsets.back() |= kBatchEnd;
+    // Records, then their index entries: a reader sees a record only once it is indexed.
+    if (!writeAllAt(tail.seg_fd, bytes.data(), bytes.size(), seg_end) ||
+        !writeAllAt(tail.idx_fd, reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t), idx_bytes)) {
+        return fail("cannot append to " + tail.seg_path + ": " + std::strerror(errno));
+    }
+    if (durable) {
+        if (::fdatasync(tail.seg_fd) != 0 || ::fdatasync(tail.idx_fd) != 0) {
+            return fail("cannot sync " + tail.seg_path + ": " + std::strerror(errno));
+        }
+        if (synced_base != tail.base) {
+            int dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            bool synced = dir_fd >= 0 && ::fsync(dir_fd) == 0;
+            if (dir_fd >= 0) ::close(dir_fd);
+            if (!synced) return fail("cannot sync " + directory + ": " + std::strerror(errno));
+            synced_base = tail.base;
+        }
+    }
+    uint64_t next = tail.base + idx_bytes / sizeof(uint64_t) + records.size();
+    if (first) *first = next - records.size();
+    if (seg_end + bytes.size() >= segment_bytes) {
+        tail.closeFds();
+        return createSegment(next);
+    }
+    return true;
+}
+
+QueueLog::Segment* QueueLog::segmentFor(uint64_t sequence) {
+    if (segments.empty()) refreshSegments();
+    auto it = segments.upper_bound(sequence);
+    if (it == segments.begin()) return nullptr;
+    Segment* segment = std::prev(it)->second.get();
+    segment->remapFor(sequence - segment->base + 1);
+    uint64_t count = segment->count();
+    if (sequence - segment->base < count) return segment;
+    if (it != segments.end() || !nextSegmentExists(*segment, count)) return nullptr;
+    refreshSegments(); // another process rolled to a new segment
+    return segmentFor(sequence);
+}
+
+bool QueueLog::nextSegmentExists(const Segment& segment, uint64_t count) const {
+    struct stat st;
+    // An empty segment was never rolled past.
+    return count > 0 && ::stat((std::filesystem::path(directory) / segmentName(segment.base + count, ".seg")).c_str(), &st) == 0;
+}
+
+uint64_t QueueLog::endSequence() {
+    std::lock_guard<std::mutex> guard(mutex);
+    refreshSegments();
+    if (segments.empty()) return 0;
+    Segment& tail = *segments.rbegin()->second;
+    tail.remapFor(UINT64_MAX);
+    return tail.base + tail.count();
+}
+
+bool QueueLog::scan(uint64_t from, const std::function<bool(uint64_t, const QueueRecord&)>& visit) {
+    std::lock_guard<std::mutex> guard(mutex);
+    return scanLocked(from, visit);
+}
+
+bool QueueLog::scanLocked(uint64_t from, const std::function<bool(uint64_t, const QueueRecord&)>& visit) {
+    QueueRecord record;
+    for (uint64_t sequence = from;; ++sequence) {
+        Segment* segment = segmentFor(sequence);
+        if (!segment) return true;
+        uint64_t size;
+        if (!decodeRecord(segment->seg.view(), segment->offset(sequence - segment->base), &record, size)) {
+            return fail(segment->seg_path + ": record " + std::to_string(sequence) + " is corrupt");
+        }
+        if (!visit(sequence, record)) return true;
+    }
+}
+
+std::map<std::string, QueueTaskState> QueueLog::states() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return statesLocked();
+}
+
+std::map<std::string, QueueTaskState> QueueLog::statesLocked() {
+    std::map<std::string, QueueTaskState> result;
+    refreshSegments();
+    if (segments.empty()) return result;
+    scanLocked(segments.begin()->first, [&](uint64_t sequence, const QueueRecord& record) {
+        QueueTaskState& state = result[record.task_id];
+        state.last = record.type;
+        if (record.type == QueueRecordType::Enqueue) state.enqueued = sequence;
+        if (record.type == QueueRecordType::Claim) state.owner = record.payload;
+        return true;
+    });
+    return result;
+}
+
+uint64_t QueueLog::cursorPosition(const std::string& cursor) {
+    int fd = ::open((std::filesystem::path(directory) / ("cursor." + cursor)).c_str(), O_RDONLY | O_CLOEXEC);
+    uint64_t position = 0;
+    if (fd >= 0) {
+        if (::pread(fd, &position, sizeof(position), 0) != static_cast<ssize_t>(sizeof(position))) position = 0;
+        ::close(fd);
+    }
+    return position;
+}
+
+bool QueueLog::claim(const std::string& cursor, size_t max, const std::string& owner, std::vector<QueueRecord>& claimed) {
+    claimed.clear();
+    if (lock_fd < 0) return false;
+    Lock lock(*this);
+    // Scanned through the read-only maps: the tail is opened for writing
+    // (and its close seen by watchers) only if claims are appended.
+    const uint64_t start = cursorPosition(cursor);
+    uint64_t position = start;
+    std::vector<QueueRecord> claims;
+    bool ok = scanLocked(position, [&](uint64_t sequence, const QueueRecord& record) {
+        if (claimed.size() == max) return false;
+        position = sequence + 1;
+        if (record.type == QueueRecordType::Enqueue) {
+            claims.push_back(QueueRecord{QueueRecordType::Claim, record.task_id, owner});
+            claimed.push_back(record);
+        }
+        return true;
+    });
+    if (!ok || position == start) return ok;
+    if (!claims.empty() && !appendLocked(claims, nullptr)) return false;
+    // If this write is lost the same tasks are claimed again: at-least-once.
+    int fd = ::open((std::filesystem::path(directory) / ("cursor." + cursor)).c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    ok = fd >= 0 && writeAllAt(fd, reinterpret_cast<const char*>(&position), sizeof(position), 0);
+    if (fd >= 0) ::close(fd);
+    return ok || fail("cannot advance cursor " + cursor);
+}
+
+size_t QueueLog::requeueAbandoned(const std::function<bool(const std::string& owner)>& gone) {
+    if (lock_fd < 0) return 0;
+    Lock lock(*this);
+    // Only records appended since the last call are replayed.
+    scanLocked(tracked_end, [&](uint64_t sequence, const QueueRecord& record) {
+        tracked_end = sequence + 1;
+        if (record.type == QueueRecordType::Enqueue) {
+            outstanding[record.task_id] = Outstanding{sequence, std::string()};
+        } else if (record.type == QueueRecordType::Claim) {
+            auto it = outstanding.find(record.task_id);
+            if (it != outstanding.end()) it->second.owner = record.payload;
+        } else {
+            outstanding.erase(record.task_id);
+        }
+        return true;
+    });
+    std::vector<QueueRecord> requeue;
+    std::map<std::string, bool> owner_gone; // one check per owner, not per claim
+    for (const auto& entry : outstanding) {
+        const std::string& claimed_by = entry.second.owner;
+        if (claimed_by.empty()) continue;
+        auto known = owner_gone.find(claimed_by);
+        if (known == owner_gone.end()) known = owner_gone.emplace(claimed_by, gone(claimed_by)).first;
+        if (!known->second) continue;
+        scanLocked(entry.second.enqueued, [&](uint64_t, const QueueRecord& record) {
+            requeue.push_back(QueueRecord{QueueRecordType::Enqueue, record.task_id, record.payload});
+            return false;
+        });
+    }
+    return requeue.empty() || appendLocked(requeue, nullptr) ? requeue.size() : 0;
+}
@@ -0,0 +1,116 @@
+#ifndef QUEUE_LOG_H
+#define QUEUE_LOG_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Append-only queue log, the alternative to one file per task (spool.h).
+// Every state change of a task is a record; a record's sequence number is
+// its position in the log. The log is cut into segments:
+//
+//   <base>.seg  "QLQLOG01" then records: u32 body length | u32 crc32c(body) |
+//               body = u8 type | u32 id length | id | payload
+//   <base>.idx  u64 file offset of each record in the segment, read via mmap;
+//               the top bit marks the last record of each appended batch
+//   cursor.<name>  u64 next sequence a consumer group has not yet claimed
+//   lock        flock'ed by whichever process is appending or claiming
+//
+// <base> is the zero-padded sequence of the segment's first record. Several
+// processes may append and claim; each holds the lock for one batch. Readers
+// see a batch only once its last index entry is written, and the next append
+// cuts off a batch that a crash left unfinished, so a batch is all or
+// nothing. Segments are never deleted.
+
+enum class QueueRecordType : uint8_t {
+    Enqueue = 1, // payload: task JSON
+    Claim,       // payload: owner ("host:pid")
+    Complete,    // payload: result output
+    Fail         // payload: reason
+};
+
+struct QueueRecord {
+    QueueRecordType type = QueueRecordType::Enqueue;
+    std::string task_id;
+    std::string payload;
+};
+
+// A task's latest state, from replaying the log.
+struct QueueTaskState {
+    QueueRecordType last = QueueRecordType::Enqueue;
+    std::string owner;     // of the latest claim
+    uint64_t enqueued = 0; // sequence of the latest Enqueue
+};
+
+class QueueLog {
+public:
+    static constexpr uint64_t kDefaultSegmentBytes = 64ull << 20;
+
+    // Creates the directory if needed.
+    explicit QueueLog(const std::string& directory, uint64_t segment_bytes = kDefaultSegmentBytes);
+    ~QueueLog();
+    QueueLog(const QueueLog&) = delete;
+    QueueLog& operator=(const QueueLog&) = delete;
+
+    bool ok() const { return error_message.empty(); }
+    const std::string& error() const { return error_message; }
+
+    // Appends the batch with one write per segment touched; first receives
+    // the sequence of records[0]. durable: fdatasync the segment and its
+    // index (and, for a new segment, the directory) before returning.
+    bool append(const std::vector<QueueRecord>& records, uint64_t* first = nullptr, bool durable = false);
+    bool append(const QueueRecord& record) { return append(std::vector<QueueRecord>{record}); }
+
+    // One past the last record.
+    uint64_t endSequence();
+    // Visits records from `from` in order until visit returns false.
+    bool scan(uint64_t from, const std::function<bool(uint64_t sequence, const QueueRecord&)>& visit);
+    std::map<std::string, QueueTaskState> states();
+
+    // Takes up to max Enqueue records past the named cursor, appends a Claim
+    // for each and advances the cursor, all under the lock, so each enqueue
+    // goes to exactly one consumer of that cursor.
+    bool claim(const std::string& cursor, size_t max, const std::string& owner, std::vector<QueueRecord>& claimed);
+    uint64_t cursorPosition(const std::string& cursor);
+    // Enqueues again every task whose latest record is a Claim by an owner
+    // for which gone() is true. Returns the number requeued. The claims are
+    // tracked across calls, so each call reads only the records appended
+    // since the last one.
+    size_t requeueAbandoned(const std::function<bool(const std::string& owner)>& gone);
+
+private:
+    struct Segment;
+    class Lock;
+    struct Outstanding {
+        uint64_t enqueued = 0; // sequence of the latest Enqueue
+        std::string owner;     // of a Claim after it; empty while unclaimed
+    };
+
+    bool refreshSegments();
+    Segment* segmentFor(uint64_t sequence);
+    bool nextSegmentExists(const Segment& segment, uint64_t count) const;
+    bool openTail(); // under the lock: drop an unfinished batch from the tail
+    bool appendLocked(const std::vector<QueueRecord>& records, uint64_t* first, bool durable = false);
+    bool scanLocked(uint64_t from, const std::function<bool(uint64_t sequence, const QueueRecord&)>& visit);
+    std::map<std::string, QueueTaskState> statesLocked();
+    bool createSegment(uint64_t base);
+    bool fail(const std::string& message);
+
+    std::string directory;
+    uint64_t segment_bytes;
+    int lock_fd = -1;
+    std::mutex mutex; // one batch at a time within the process; the flock covers other processes
+    std::map<uint64_t, std::unique_ptr<Segment>> segments; // by base sequence
+    std::unordered_map<std::string, Outstanding> outstanding; // tasks neither completed nor failed, up to tracked_end
+    uint64_t tracked_end = 0;
+    uint64_t synced_base = UINT64_MAX; // segment whose directory entry a durable append has synced
+    std::string error_message;
+};
+
+#endif // QUEUE_LOG_H
@@ -0,0 +1,138 @@
+#include "spool.h"
+#include "../utils/fd_sink.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string hostName() {
+    char name[256] = {};
+    if (::gethostname(name, sizeof(name) - 1) != 0) return "localhost";
+    return name;
+}
+
+std::filesystem::path leasePath(const std::filesystem::path& in_progress, const std::string& name) {
+    return in_progress / spoolLeaseName(name);
+}
+
+bool syncDirectory(const std::filesystem::path& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+} // namespace
+
+std::string spoolOwner() { return hostName() + ":" + std::to_string(::getpid()); }
+
+std::string spoolLeaseName(const std::string& name) { return "." + name + ".lease"; }
+
+std::string spoolLeaseRecord(const std::string& owner, std::chrono::seconds lease) {
+    return "owner=" + owner + "\nexpires_ms=" + std::to_string(nowMs() + lease.count() * 1000) + "\n";
+}
+
+bool spoolOwnerGone(const std::string& owner) {
+    size_t colon = owner.rfind(':');
+    if (colon == std::string::npos || owner.compare(0, colon, hostName()) != 0) return false;
+    long pid = std::strtol(owner.c_str() + colon + 1, nullptr, 10);
+    return pid > 0 && ::kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH;
+}
+
+bool spoolWriteFile(const std::filesystem::path& dir, const std::string& name, std::string_view content, bool durable) {
+    std::filesystem::path tmp = dir / ("." + name + ".tmp");
+    FdSink sink;
+    bool ok = sink.open(tmp.string());
+    sink.write(content);
+    ok = sink.close(durable) && ok && std::rename(tmp.c_str(), (dir / name).c_str()) == 0;
+    if (!ok) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return !durable || syncDirectory(dir);
+}
+
+bool spoolClaim(const std::filesystem::path& pending, const std::filesystem::path& in_progress, const std::string& name,
+                const std::string& owner, std::chrono::seconds lease) {
+    std::error_code ec;
+    std::filesystem::rename(pending / name, in_progress / name, ec);
+    if (ec) return false;
+    // Until the lease exists, reclaimers go by the rename's ctime, so a slow
+    // lease write is not mistaken for an abandoned claim.
+    spoolWriteFile(in_progress, spoolLeaseName(name), spoolLeaseRecord(owner, lease));
+    return true;
+}
+
+bool spoolRenewLease(const std::filesystem::path& in_progress, const std::string& name, const std::string& owner,
+                     std::chrono::seconds lease) {
+    std::error_code ec;
+    if (!std::filesystem::exists(in_progress / name, ec)) return false;
+    SpoolLease current;
+    if (spoolReadLease(in_progress, name, current) && current.owner != owner) return false;
+    return spoolWriteFile(in_progress, spoolLeaseName(name), spoolLeaseRecord(owner, lease));
+}
+
+void spoolRelease(const std::filesystem::path& in_progress, const std::string& name) {
+    std::error_code ec;
+    std::filesystem::remove(in_progress / name, ec);
+    std::filesystem::remove(leasePath(in_progress, name), ec);
+}
+
+bool spoolReadLease(const std::filesystem::path& in_progress, const std::string& name, SpoolLease& lease) {
+    FILE* file = std::fopen(leasePath(in_progress, name).c_str(), "r");
+    if (!file) return false;
+    char owner[512] = {};
+    long long expires = 0;
+    bool ok = std::fscanf(file, "owner=%511[^\n]\nexpires_ms=%lld", owner, &expires) == 2;
+    std::fclose(file);
+    if (!ok) return false;
+    lease.owner = owner;
+    lease.expires_ms = expires;
+    return true;
+}
+
+size_t spoolReclaimStale(const std::filesystem::path& in_progress, const std::filesystem::path& pending, std::chrono::seconds lease) {
+    size_t requeued = 0;
+    int64_t now = nowMs();
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(in_progress, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name.empty()) continue;
+        if (name[0] == '.') {
+            // A lease whose task finished or was requeued without it.
+            const std::string suffix = ".lease";
+            if (name.size() > suffix.size() + 1 && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0 &&
+                !std::filesystem::exists(in_progress / name.substr(1, name.size() - 1 - suffix.size()))) {
+                std::error_code ignored;
+                std::filesystem::remove(it->path(), ignored);
+            }
+            continue;
+        }
+        if (it->path().extension() != ".json") continue;
+        SpoolLease current;
+        bool stale;
+        if (spoolReadLease(in_progress, name, current)) {
+            stale = current.expires_ms <= now || spoolOwnerGone(current.owner);
+        } else {
+            struct stat st;
+            stale = ::stat(it->path().c_str(), &st) == 0 && static_cast<int64_t>(st.st_ctime) * 1000 + lease.count() * 1000 <= now;
+        }
+        if (!stale) continue;
+        // Drop the lease first so a new claim's lease is never the one removed.
+        std::error_code ignored;
+        std::filesystem::remove(leasePath(in_progress, name), ignored);
+        std::filesystem::rename(it->path(), pending / name, ignored);
+        if (!ignored) requeued++;
+    }
+    return requeued;
+}
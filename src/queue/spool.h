@@ -0,0 +1,60 @@
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// File-per-task queue shared by several coordinator processes. Files become
+// visible only complete (written to a hidden temp file, then renamed in). A
+// worker claims a task by renaming it from pending/ into in_progress/, which
+// succeeds for exactly one process, then records a lease next to it:
+//
+//   in_progress/.<name>.lease = "owner=<host>:<pid>\nexpires_ms=<unix ms>\n"
+//
+// A claim whose lease has expired, whose owner process on this host is gone,
+// or that never got a lease within the lease period is stale and is renamed
+// back into pending/. Processing is therefore at-least-once.
+
+struct SpoolLease {
+    std::string owner;
+    int64_t expires_ms = 0;
+};
+
+// "<hostname>:<pid>" of this process.
+std::string spoolOwner();
+
+// ".<name>.lease", the lease file of a claimed task, and its contents.
+std::string spoolLeaseName(const std::string& name);
+std::string spoolLeaseRecord(const std::string& owner, std::chrono::seconds lease);
+
+// Writes dir/name through dir/.<name>.tmp and a rename. durable: fsync the
+// file and the directory before returning.
+bool spoolWriteFile(const std::filesystem::path& dir, const std::string& name, std::string_view content, bool durable = false);
+
+// Moves pending/name into in_progress/ and leases it to owner. False if the
+// file is gone, i.e. another worker or process claimed it first.
+bool spoolClaim(const std::filesystem::path& pending, const std::filesystem::path& in_progress, const std::string& name,
+                const std::string& owner, std::chrono::seconds lease);
+
+// Pushes owner's lease on a claim it still holds out to now + lease. False,
+// writing nothing, if the claim is gone or leased to another owner.
+bool spoolRenewLease(const std::filesystem::path& in_progress, const std::string& name, const std::string& owner,
+                     std::chrono::seconds lease);
+
+// Drops a finished claim: the in_progress file, then its lease.
+void spoolRelease(const std::filesystem::path& in_progress, const std::string& name);
+
+// True only if owner ran on this host and that process has exited; owners
+// on other hosts are judged by lease expiry alone.
+bool spoolOwnerGone(const std::string& owner);
+
+bool spoolReadLease(const std::filesystem::path& in_progress, const std::string& name, SpoolLease& lease);
+
+// Returns stale claims in in_progress/ to pending/ and removes leases whose
+// task file is gone. Returns the number of tasks requeued.
+size_t spoolReclaimStale(const std::filesystem::path& in_progress, const std::filesystem::path& pending, std::chrono::seconds lease);
+
+#endif // SPOOL_H
@@ -0,0 +1,348 @@
+#include "backup.h"
+#include "compressed_file.h"
+#include "task_codec.h"
+#include "../utils/crc32c.h"
+#include "../utils/fd_sink.h"
+#include "../utils/mapped_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'Q', 'L', 'B', 'A', 'C', 'K', 'U', 'P'};
+constexpr char kCatalogMagic[8] = {'Q', 'L', 'C', 'A', 'T', 'L', 'O', 'G'};
+constexpr uint32_t kCatalogVersion = 1;
+constexpr size_t kPrefixBytes = 16; // magic, version, header length
+constexpr uint32_t kMaxHeaderBytes = 1 << 20;
+constexpr size_t kMaxChainLength = 100000;
+
+enum : uint8_t { kTaskRecord = 1, kRemovalRecord = 2 };
+
+template <typename T>
+void putScalar(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putString(std::string& out, std::string_view s) {
+    putScalar(out, static_cast<uint32_t>(s.size()));
+    out.append(s.data(), s.size());
+}
+
+template <typename T>
+bool takeScalar(std::string_view& in, T& value) {
+    if (in.size() < sizeof(T)) return false;
+    std::memcpy(&value, in.data(), sizeof(T));
+    in.remove_prefix(sizeof(T));
+    return true;
+}
+
+bool takeBytes(std::string_view& in, std::string_view& bytes) {
+    uint32_t n;
+    if (!takeScalar(in, n) || in.size() < n) return false;
+    bytes = in.substr(0, n);
+    in.remove_prefix(n);
+    return true;
+}
+
+bool takeString(std::string_view& in, std::string& s) {
+    std::string_view bytes;
+    if (!takeBytes(in, bytes)) return false;
+    s.assign(bytes);
+    return true;
+}
+
+std::string encodeHeader(const BackupInfo& info) {
+    std::string header;
+    putScalar(header, static_cast<uint32_t>(info.kind));
+    putScalar(header, info.sequence);
+    putScalar(header, info.parent_sequence);
+    putScalar(header, info.created_ms);
+    putString(header, info.parent);
+    putString(header, info.schedule_id);
+    putString(header, info.schedule_name);
+    return header;
+}
+
+bool decodeHeader(std::string_view& in, BackupInfo& info) {
+    uint32_t kind;
+    if (!takeScalar(in, kind) || !takeScalar(in, info.sequence) || !takeScalar(in, info.parent_sequence) ||
+        !takeScalar(in, info.created_ms) || !takeString(in, info.parent) || !takeString(in, info.schedule_id) ||
+        !takeString(in, info.schedule_name)) {
+        return false;
+    }
+    if (kind != static_cast<uint32_t>(BackupKind::Full) && kind != static_cast<uint32_t>(BackupKind::Incremental)) return false;
+    info.kind = static_cast<BackupKind>(kind);
+    return true;
+}
+
+// Validates the prefix and header CRC; header_end receives where the records start.
+bool parsePrefix(std::string_view bytes, BackupInfo& info, size_t& header_end) {
+    uint32_t fields[2];
+    if (bytes.size() < kPrefixBytes || std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) return false;
+    std::memcpy(fields, bytes.data() + sizeof(kMagic), sizeof(fields));
+    if (fields[0] == 0 || fields[0] > kBackupVersion || fields[1] > kMaxHeaderBytes) return false;
+    if (bytes.size() - kPrefixBytes < size_t(fields[1]) + sizeof(uint32_t)) return false;
+    std::string_view header = bytes.substr(kPrefixBytes, fields[1]);
+    uint32_t crc;
+    std::memcpy(&crc, header.data() + header.size(), sizeof(crc));
+    if (crc != crc32c(header.data(), header.size())) return false;
+    header_end = kPrefixBytes + header.size() + sizeof(crc);
+    return decodeHeader(header, info);
+}
+
+std::filesystem::path directoryOf(const std::string& path) {
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    return directory.empty() ? std::filesystem::path(".") : directory;
+}
+
+std::string catalogPath(const std::string& directory) {
+    return (std::filesystem::path(directory.empty() ? "." : directory) / kBackupCatalogName).string();
+}
+
+// Catalog entry for a backup file: its header, size and whole-file checksum.
+bool describeBackup(const std::filesystem::path& path, BackupEntry& entry) {
+    MappedFile file(path.string());
+    size_t header_end;
+    if (!file.is_open() || !parsePrefix(file.view(), entry.info, header_end)) return false;
+    entry.file = path.filename().string();
+    entry.size = file.size();
+    entry.checksum = crc32c(file.view().data(), file.size());
+    return true;
+}
+
+void sortEntries(std::vector<BackupEntry>& entries) {
+    std::sort(entries.begin(), entries.end(), [](const BackupEntry& a, const BackupEntry& b) {
+        return a.info.created_ms != b.info.created_ms ? a.info.created_ms < b.info.created_ms : a.info.sequence < b.info.sequence;
+    });
+}
+
+// Adds or replaces the entry for a freshly written backup. A catalog that
+// cannot be updated is removed so the next reader rebuilds it.
+void recordInCatalog(const std::string& path) {
+    std::string directory = directoryOf(path).string();
+    std::vector<BackupEntry> entries;
+    BackupEntry entry;
+    std::string error;
+    if (!describeBackup(path, entry) || !loadBackupCatalog(directory, entries, error)) {
+        std::remove(catalogPath(directory).c_str());
+        return;
+    }
+    auto it = std::find_if(entries.begin(), entries.end(), [&](const BackupEntry& e) { return e.file == entry.file; });
+    if (it != entries.end()) *it = std::move(entry);
+    else entries.push_back(std::move(entry));
+    sortEntries(entries);
+    if (!writeBackupCatalog(directory, entries, error)) std::remove(catalogPath(directory).c_str());
+}
+
+bool applyRecords(const std::string& path, const BackupEntry* expected, std::map<std::string, Task>& tasks, std::string& error) {
+    MappedFile file(path);
+    BackupInfo info;
+    size_t header_end = 0;
+    if (!file.is_open() || !parsePrefix(file.view(), info, header_end)) {
+        error = path + " is not a readable backup";
+        return false;
+    }
+    if (expected && (file.size() != expected->size || crc32c(file.view().data(), file.size()) != expected->checksum)) {
+        error = path + " does not match its catalog entry";
+        return false;
+    }
+    std::string records;
+    if (!decompress(file.view().substr(header_end), records, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    std::string_view in = records;
+    while (!in.empty()) {
+        uint8_t tag;
+        std::string_view bytes;
+        if (!takeScalar(in, tag) || !takeBytes(in, bytes)) break;
+        if (tag == kTaskRecord) {
+            Task task;
+            if (!decode_task(bytes, task) || !bytes.empty()) break;
+            std::string id = task.task_id;
+            tasks[id] = std::move(task);
+        } else if (tag == kRemovalRecord) {
+            tasks.erase(std::string(bytes));
+        } else {
+            break;
+        }
+    }
+    if (!in.empty()) {
+        error = path + " has a malformed record";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// --- BackupWriter ---
+
+BackupWriter::BackupWriter(FdSink& sink, const BackupInfo& info) {
+    std::string header = encodeHeader(info);
+    uint32_t fields[2] = {kBackupVersion, static_cast<uint32_t>(header.size())};
+    uint32_t crc = crc32c(header.data(), header.size());
+    sink.write(kMagic, sizeof(kMagic));
+    sink.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+    sink.write(header);
+    sink.write(reinterpret_cast<const char*>(&crc), sizeof(crc));
+    compressed = std::make_unique<CompressedWriter>(sink);
+}
+
+BackupWriter::~BackupWriter() = default;
+
+void BackupWriter::addRecord(uint8_t tag, std::string_view bytes) {
+    char prefix[5];
+    uint32_t n = static_cast<uint32_t>(bytes.size());
+    prefix[0] = static_cast<char>(tag);
+    std::memcpy(prefix + 1, &n, sizeof(n));
+    compressed->write(prefix, sizeof(prefix));
+    compressed->write(bytes);
+}
+
+void BackupWriter::addTask(const Task& task) {
+    record.clear();
+    encode_task(record, task);
+    addRecord(kTaskRecord, record);
+}
+
+void BackupWriter::addRemoval(std::string_view task_id) { addRecord(kRemovalRecord, task_id); }
+
+bool BackupWriter::finish() { return compressed->finish(); }
+
+// --- Files and chains ---
+
+bool writeBackupFile(const std::string& path, const BackupInfo& info, const std::function<void(BackupWriter&)>& fill,
+                     std::string& error) {
+    bool ok = replaceFile(path, true, [&](FdSink& sink) {
+        BackupWriter writer(sink, info);
+        fill(writer);
+        return writer.finish();
+    }, error);
+    if (ok) recordInCatalog(path);
+    return ok;
+}
+
+bool readBackupInfo(const std::string& path, BackupInfo& info) {
+    std::ifstream in(path, std::ios::binary);
+    char prefix[kPrefixBytes];
+    if (!in.read(prefix, sizeof(prefix)) || std::memcmp(prefix, kMagic, sizeof(kMagic)) != 0) return false;
+    uint32_t header_bytes;
+    std::memcpy(&header_bytes, prefix + 12, sizeof(header_bytes));
+    if (header_bytes > kMaxHeaderBytes) return false;
+    std::string bytes(prefix, sizeof(prefix));
+    bytes.resize(kPrefixBytes + header_bytes + sizeof(uint32_t));
+    size_t header_end;
+    return in.read(&bytes[kPrefixBytes], bytes.size() - kPrefixBytes) && parsePrefix(bytes, info, header_end);
+}
+
+bool loadBackupChain(const std::string& path, BackupInfo& info, std::map<std::string, Task>& tasks, std::string& error) {
+    if (!readBackupInfo(path, info)) {
+        error = path + " is not a readable backup";
+        return false;
+    }
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    std::vector<BackupEntry> catalog;
+    if (!readBackupCatalog(directoryOf(path).string(), catalog)) catalog.clear();
+    std::vector<std::string> chain{path};
+    BackupInfo link = info;
+    while (link.kind == BackupKind::Incremental) {
+        std::string parent = (directory / link.parent).string();
+        BackupInfo parent_info;
+        if (chain.size() > kMaxChainLength || !readBackupInfo(parent, parent_info)) {
+            error = chain.back() + ": parent backup " + link.parent + " is missing";
+            return false;
+        }
+        if (parent_info.sequence != link.parent_sequence) {
+            error = chain.back() + ": parent backup " + link.parent + " is at sequence " + std::to_string(parent_info.sequence) +
+                    ", expected " + std::to_string(link.parent_sequence);
+            return false;
+        }
+        chain.push_back(parent);
+        link = parent_info;
+    }
+    tasks.clear();
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        std::string name = std::filesystem::path(*it).filename().string();
+        auto entry = std::find_if(catalog.begin(), catalog.end(), [&](const BackupEntry& e) { return e.file == name; });
+        if (!applyRecords(*it, entry == catalog.end() ? nullptr : &*entry, tasks, error)) return false;
+    }
+    return true;
+}
+
+bool rebaseBackup(const std::string& path, std::string& error) {
+    BackupInfo info;
+    std::map<std::string, Task> tasks;
+    if (!loadBackupChain(path, info, tasks, error)) return false;
+    info.kind = BackupKind::Full;
+    info.parent.clear();
+    info.parent_sequence = 0;
+    return writeBackupFile(path, info, [&](BackupWriter& writer) {
+        for (const auto& entry : tasks) writer.addTask(entry.second);
+    }, error);
+}
+
+// --- Catalog ---
+
+bool readBackupCatalog(const std::string& directory, std::vector<BackupEntry>& entries) {
+    MappedFile file(catalogPath(directory));
+    std::string_view in = file.view();
+    uint32_t fields[2];
+    uint32_t crc;
+    if (!file.is_open() || in.size() < kPrefixBytes + sizeof(crc) || std::memcmp(in.data(), kCatalogMagic, sizeof(kCatalogMagic)) != 0) {
+        return false;
+    }
+    std::memcpy(fields, in.data() + sizeof(kCatalogMagic), sizeof(fields));
+    std::memcpy(&crc, in.data() + in.size() - sizeof(crc), sizeof(crc));
+    if (fields[0] == 0 || fields[0] > kCatalogVersion || crc != crc32c(in.data(), in.size() - sizeof(crc))) return false;
+    in = in.substr(kPrefixBytes, in.size() - kPrefixBytes - sizeof(crc));
+    entries.clear();
+    for (uint32_t i = 0; i < fields[1]; ++i) {
+        BackupEntry entry;
+        if (!takeScalar(in, entry.size) || !takeScalar(in, entry.checksum) || !takeString(in, entry.file) ||
+            !decodeHeader(in, entry.info)) {
+            return false;
+        }
+        entries.push_back(std::move(entry));
+    }
+    return in.empty();
+}
+
+bool writeBackupCatalog(const std::string& directory, const std::vector<BackupEntry>& entries, std::string& error) {
+    std::string bytes(kCatalogMagic, sizeof(kCatalogMagic));
+    putScalar(bytes, kCatalogVersion);
+    putScalar(bytes, static_cast<uint32_t>(entries.size()));
+    for (const auto& entry : entries) {
+        putScalar(bytes, entry.size);
+        putScalar(bytes, entry.checksum);
+        putString(bytes, entry.file);
+        bytes += encodeHeader(entry.info);
+    }
+    putScalar(bytes, crc32c(bytes.data(), bytes.size()));
+    return replaceFile(catalogPath(directory), true, [&](FdSink& sink) {
+        sink.write(bytes);
+        return sink.ok();
+    }, error);
+}
+
+bool loadBackupCatalog(const std::string& directory, std::vector<BackupEntry>& entries, std::string& error) {
+    if (readBackupCatalog(directory, entries)) return true;
+    entries.clear();
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory.empty() ? "." : directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file() || it->path().filename() == kBackupCatalogName || it->path().extension() == ".tmp") continue;
+        BackupEntry entry;
+        if (describeBackup(it->path(), entry)) entries.push_back(std::move(entry));
+    }
+    if (ec) {
+        error = "cannot list " + directory + ": " + ec.message();
+        return false;
+    }
+    sortEntries(entries);
+    return writeBackupCatalog(directory, entries, error);
+}
@@ -0,0 +1,101 @@
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../models/models.h"
+
+class FdSink;
+class CompressedWriter;
+
+// Full and incremental backups of the scheduler's task table. A full backup
+// holds every task; an incremental one holds only the tasks changed (and the
+// ids removed) since its parent, named by file in the same directory. Restore
+// replays the chain from its full base.
+//
+// File: "QLBACKUP", u32 version, u32 header length, the header (kind,
+// sequence, parent sequence, creation time, parent, schedule id and name),
+// u32 crc32c of the header, then a compressed frame (compressed_file.h) of
+// records: u8 tag | u32 length | bytes, where a task is task_codec-encoded
+// and a removal is the task id.
+
+constexpr uint32_t kBackupVersion = 1;
+
+enum class BackupKind : uint32_t {
+    Full = 1,
+    Incremental
+};
+
+struct BackupInfo {
+    BackupKind kind = BackupKind::Full;
+    uint64_t sequence = 0;        // scheduler change sequence the backup is current to
+    uint64_t parent_sequence = 0; // incremental: the parent's sequence
+    int64_t created_ms = 0;       // unix time in milliseconds
+    std::string parent;           // incremental: parent file name
+    std::string schedule_id;
+    std::string schedule_name;
+};
+
+class BackupWriter {
+public:
+    // Writes the header; records are compressed as they are added.
+    BackupWriter(FdSink& sink, const BackupInfo& info);
+    ~BackupWriter();
+    void addTask(const Task& task);
+    void addRemoval(std::string_view task_id);
+    bool finish();
+
+private:
+    void addRecord(uint8_t tag, std::string_view bytes);
+
+    std::unique_ptr<CompressedWriter> compressed;
+    std::string record;
+};
+
+// Catalog of the backups in one directory, so listing, pruning and picking a
+// restore point read one file instead of every backup header. It is rewritten
+// (temp file plus rename) whenever writeBackupFile adds or replaces a backup.
+//
+// File: "QLCATLOG", u32 version, u32 entry count, entries (u64 size | u32
+// crc32c of the file | file name | the backup's header, strings as u32 length
+// | bytes), then a u32 crc32c of everything before it.
+constexpr char kBackupCatalogName[] = "backups.catalog";
+
+struct BackupEntry {
+    std::string file; // name within the directory
+    BackupInfo info;
+    uint64_t size = 0;
+    uint32_t checksum = 0; // crc32c of the whole file
+};
+
+// Entries oldest first (by creation time, then sequence). False if the
+// catalog is missing or damaged.
+bool readBackupCatalog(const std::string& directory, std::vector<BackupEntry>& entries);
+bool writeBackupCatalog(const std::string& directory, const std::vector<BackupEntry>& entries, std::string& error);
+// readBackupCatalog, rebuilding the catalog from the backup headers in the
+// directory if it is missing or damaged. Other files are not backups and are ignored.
+bool loadBackupCatalog(const std::string& directory, std::vector<BackupEntry>& entries, std::string& error);
+
+// Writes path.tmp, fsyncs it and renames it over path, then records it in the
+// directory's catalog; fill adds the records.
+bool writeBackupFile(const std::string& path, const BackupInfo& info, const std::function<void(BackupWriter&)>& fill,
+                     std::string& error);
+
+// Reads only the header, so listing backups does not decompress them.
+bool readBackupInfo(const std::string& path, BackupInfo& info);
+
+// Replays the chain ending at path, oldest first, into tasks (keyed by id).
+// info receives the header of path itself. Fails on a missing or mismatched
+// link, or a file whose size or checksum differs from its catalog entry.
+bool loadBackupChain(const std::string& path, BackupInfo& info, std::map<std::string, Task>& tasks, std::string& error);
+
+// Rewrites an incremental backup in place as the full backup its chain
+// replays to (same sequence and time), so its ancestors can be deleted.
+bool rebaseBackup(const std::string& path, std::string& error);
+
+#endif // BACKUP_H
@@ -0,0 +1,327 @@
+#include "columnar.h"
+#include "../utils/crc32c.h"
+#include "../utils/fd_sink.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+constexpr char kMagic[8] = {'Q', 'L', 'C', 'O', 'L', '\0', '\r', '\n'};
+constexpr char kTrailerMagic[4] = {'Q', 'L', 'C', 'F'};
+constexpr size_t kHeaderBytes = 16;
+constexpr size_t kTrailerBytes = 16;
+
+template <typename T>
+void putScalar(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putString(std::string& out, std::string_view s) {
+    putScalar(out, static_cast<uint32_t>(s.size()));
+    out.append(s.data(), s.size());
+}
+
+// Bounds-checked little-endian reads over a byte range.
+struct Cursor {
+    std::string_view rest;
+
+    template <typename T>
+    bool take(T& value) {
+        if (rest.size() < sizeof(T)) return false;
+        std::memcpy(&value, rest.data(), sizeof(T));
+        rest.remove_prefix(sizeof(T));
+        return true;
+    }
+    bool take(std::string_view& bytes, size_t n) {
+        if (rest.size() < n) return false;
+        bytes = rest.substr(0, n);
+        rest.remove_prefix(n);
+        return true;
+    }
+    bool takeString(std::string_view& s) {
+        uint32_t n;
+        return take(n) && take(s, n);
+    }
+};
+
+// Sorted dictionary, then codes (one per row) or (length, code) runs. The
+// dictionary's first and last entries are the chunk's min and max.
+void encodeStrings(std::string& out, const std::vector<std::string_view>& values, bool run_length, ColumnarStats& stats) {
+    std::vector<std::string_view> dictionary(values);
+    std::sort(dictionary.begin(), dictionary.end());
+    dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+    std::unordered_map<std::string_view, uint32_t> codes;
+    codes.reserve(dictionary.size());
+    putScalar(out, static_cast<uint32_t>(dictionary.size()));
+    uint32_t end = 0;
+    putScalar(out, end);
+    for (size_t i = 0; i < dictionary.size(); ++i) {
+        codes.emplace(dictionary[i], static_cast<uint32_t>(i));
+        end += static_cast<uint32_t>(dictionary[i].size());
+        putScalar(out, end);
+    }
+    for (auto s : dictionary) out.append(s.data(), s.size());
+    stats.min_string = dictionary.front();
+    stats.max_string = dictionary.back();
+
+    if (run_length) {
+        size_t count_at = out.size();
+        putScalar(out, uint32_t(0));
+        uint32_t runs = 0;
+        for (size_t i = 0; i < values.size();) {
+            size_t j = i + 1;
+            while (j < values.size() && values[j] == values[i]) ++j;
+            putScalar(out, static_cast<uint32_t>(j - i));
+            putScalar(out, codes[values[i]]);
+            runs++;
+            i = j;
+        }
+        std::memcpy(&out[count_at], &runs, sizeof(runs));
+        return;
+    }
+    uint8_t width = dictionary.size() <= 0x100 ? 1 : dictionary.size() <= 0x10000 ? 2 : 4;
+    putScalar(out, width);
+    for (auto s : values) {
+        uint32_t code = codes[s];
+        out.append(reinterpret_cast<const char*>(&code), width); // little-endian low bytes
+    }
+}
+
+} // namespace
+
+const char* columnarStatusName(TaskStatus status) {
+    switch (status) {
+        case TaskStatus::Pending: return "Pending";
+        case TaskStatus::InProgress: return "InProgress";
+        case TaskStatus::Completed: return "Completed";
+        case TaskStatus::Failed: return "Failed";
+        case TaskStatus::Paused: return "Paused";
+    }
+    return "Unknown";
+}
+
+// --- ColumnarWriter ---
+
+ColumnarWriter::ColumnarWriter(FdSink& out, size_t rows_per_group) : sink(out), group_rows(std::max<size_t>(1, rows_per_group)) {
+    char header[kHeaderBytes] = {};
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    std::memcpy(header + sizeof(kMagic), &kColumnarVersion, sizeof(kColumnarVersion));
+    sink.write(header, sizeof(header));
+    offset = sizeof(header);
+}
+
+void ColumnarWriter::addRow(const Task& task, TaskStatus status) {
+    strings[0].push_back(task.task_id);
+    strings[1].push_back(task.description);
+    strings[2].push_back(task.owner);
+    strings[3].push_back(task.due_date);
+    strings[4].push_back(columnarStatusName(status));
+    strings[5].push_back(task.priority);
+    strings[6].push_back(task.component);
+    ints[0].push_back(task.max_runtime_sec);
+    ints[1].push_back(task.estimated_effort);
+    ints[2].push_back(task.actual_effort);
+    if (strings[0].size() >= group_rows) writeGroup();
+}
+
+void ColumnarWriter::writeGroup() {
+    size_t rows = strings[0].size();
+    if (rows == 0) return;
+    putScalar(footer, static_cast<uint32_t>(rows));
+    for (size_t c = 0; c < kColumnarColumnCount; ++c) {
+        chunk.clear();
+        ColumnarStats stats;
+        ColumnarEncoding encoding;
+        if (c < kColumnarStringColumns) {
+            bool run_length = c >= static_cast<size_t>(ColumnarColumn::Status);
+            encoding = run_length ? ColumnarEncoding::RunLength : ColumnarEncoding::Dictionary;
+            encodeStrings(chunk, strings[c], run_length, stats);
+            strings[c].clear();
+        } else {
+            auto& column = ints[c - kColumnarStringColumns];
+            encoding = ColumnarEncoding::Int32;
+            auto bounds = std::minmax_element(column.begin(), column.end());
+            stats.min = *bounds.first;
+            stats.max = *bounds.second;
+            chunk.append(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(int32_t));
+            column.clear();
+        }
+        putScalar(footer, offset);
+        putScalar(footer, static_cast<uint32_t>(chunk.size()));
+        putScalar(footer, crc32c(chunk.data(), chunk.size()));
+        putScalar(footer, static_cast<uint8_t>(encoding));
+        if (encoding == ColumnarEncoding::Int32) {
+            putScalar(footer, stats.min);
+            putScalar(footer, stats.max);
+        } else {
+            putString(footer, stats.min_string);
+            putString(footer, stats.max_string);
+        }
+        sink.write(chunk);
+        offset += chunk.size();
+    }
+    row_count += rows;
+    group_count++;
+}
+
+bool ColumnarWriter::finish() {
+    writeGroup();
+    std::string counts;
+    putScalar(counts, row_count);
+    putScalar(counts, group_count);
+    putScalar(counts, static_cast<uint32_t>(kColumnarColumnCount));
+    char trailer[kTrailerBytes];
+    uint32_t crc = crc32c(footer.data(), footer.size(), crc32c(counts.data(), counts.size()));
+    std::memcpy(trailer, &offset, sizeof(offset));
+    std::memcpy(trailer + 8, &crc, sizeof(crc));
+    std::memcpy(trailer + 12, kTrailerMagic, sizeof(kTrailerMagic));
+    sink.write(counts);
+    sink.write(footer);
+    sink.write(trailer, sizeof(trailer));
+    footer.clear();
+    return sink.ok();
+}
+
+// --- ColumnarReader ---
+
+bool ColumnarReader::fail(const std::string& message) {
+    error_message = message;
+    groups.clear();
+    row_count = 0;
+    return false;
+}
+
+bool ColumnarReader::open(const std::string& path) {
+    if (!file.open(path)) return fail("cannot map " + path);
+    std::string_view bytes = file.view();
+    uint32_t version = 0;
+    if (bytes.size() < kHeaderBytes + kTrailerBytes || std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) {
+        return fail("not a columnar export");
+    }
+    std::memcpy(&version, bytes.data() + sizeof(kMagic), sizeof(version));
+    if (version == 0 || version > kColumnarVersion) return fail("unsupported columnar version " + std::to_string(version));
+    const char* trailer = bytes.data() + bytes.size() - kTrailerBytes;
+    uint64_t footer_offset;
+    uint32_t footer_crc;
+    std::memcpy(&footer_offset, trailer, sizeof(footer_offset));
+    std::memcpy(&footer_crc, trailer + 8, sizeof(footer_crc));
+    if (std::memcmp(trailer + 12, kTrailerMagic, sizeof(kTrailerMagic)) != 0) return fail("truncated columnar export");
+    size_t footer_end = bytes.size() - kTrailerBytes;
+    if (footer_offset < kHeaderBytes || footer_offset > footer_end) return fail("bad footer offset");
+    std::string_view footer = bytes.substr(footer_offset, footer_end - footer_offset);
+    if (crc32c(footer.data(), footer.size()) != footer_crc) return fail("footer checksum mismatch");
+
+    Cursor in{footer};
+    uint32_t group_count, column_count;
+    if (!in.take(row_count) || !in.take(group_count) || !in.take(column_count)) return fail("bad footer");
+    if (column_count < kColumnarColumnCount) return fail("missing columns");
+    if (group_count > footer.size() / 4) return fail("bad footer");
+    groups.assign(group_count, Group());
+    uint64_t rows_seen = 0;
+    for (auto& group : groups) {
+        if (!in.take(group.rows) || group.rows == 0) return fail("bad row group");
+        rows_seen += group.rows;
+        for (uint32_t c = 0; c < column_count; ++c) {
+            Chunk chunk;
+            uint8_t encoding;
+            if (!in.take(chunk.offset) || !in.take(chunk.size) || !in.take(chunk.crc) || !in.take(encoding)) return fail("bad footer");
+            chunk.encoding = static_cast<ColumnarEncoding>(encoding);
+            bool ok = chunk.encoding == ColumnarEncoding::Int32
+                          ? in.take(chunk.stats.min) && in.take(chunk.stats.max)
+                          : in.takeString(chunk.stats.min_string) && in.takeString(chunk.stats.max_string);
+            if (!ok) return fail("bad footer");
+            if (chunk.offset < kHeaderBytes || chunk.offset > footer_offset || chunk.size > footer_offset - chunk.offset) {
+                return fail("column chunk out of bounds");
+            }
+            if (c < kColumnarColumnCount) group.chunks[c] = chunk; // newer columns are skipped
+        }
+    }
+    if (rows_seen != row_count) return fail("row count mismatch");
+    error_message.clear();
+    return true;
+}
+
+bool ColumnarReader::chunkBytes(size_t group, ColumnarColumn column, std::string_view& bytes) {
+    if (group >= groups.size()) {
+        error_message = "no row group " + std::to_string(group);
+        return false;
+    }
+    const Chunk& chunk = groups[group].chunks[static_cast<size_t>(column)];
+    bytes = file.view().substr(chunk.offset, chunk.size);
+    if (crc32c(bytes.data(), bytes.size()) != chunk.crc) {
+        error_message = "column " + std::to_string(static_cast<uint32_t>(column)) + " of row group " + std::to_string(group) +
+                        " checksum mismatch";
+        return false;
+    }
+    return true;
+}
+
+bool ColumnarReader::readStrings(size_t group, ColumnarColumn column, std::vector<std::string_view>& values) {
+    values.clear();
+    std::string_view bytes;
+    if (!chunkBytes(group, column, bytes)) return false;
+    ColumnarEncoding encoding = groups[group].chunks[static_cast<size_t>(column)].encoding;
+    uint32_t rows = groups[group].rows;
+    auto corrupt = [&] {
+        values.clear();
+        error_message = "malformed string column in row group " + std::to_string(group);
+        return false;
+    };
+    if (encoding != ColumnarEncoding::Dictionary && encoding != ColumnarEncoding::RunLength) return corrupt();
+
+    Cursor in{bytes};
+    uint32_t count;
+    std::string_view offsets, data;
+    if (!in.take(count) || count == 0 || count > bytes.size() / 4 || !in.take(offsets, (size_t(count) + 1) * 4)) return corrupt();
+    uint32_t data_size;
+    std::memcpy(&data_size, offsets.data() + size_t(count) * 4, sizeof(data_size));
+    if (!in.take(data, data_size)) return corrupt();
+    std::vector<std::string_view> dictionary(count);
+    uint32_t begin;
+    std::memcpy(&begin, offsets.data(), sizeof(begin));
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t end;
+        std::memcpy(&end, offsets.data() + (size_t(i) + 1) * 4, sizeof(end));
+        if (begin > end || end > data_size) return corrupt();
+        dictionary[i] = data.substr(begin, end - begin);
+        begin = end;
+    }
+
+    values.reserve(rows);
+    if (encoding == ColumnarEncoding::RunLength) {
+        uint32_t runs;
+        if (!in.take(runs)) return corrupt();
+        for (uint32_t r = 0; r < runs; ++r) {
+            uint32_t length, code;
+            if (!in.take(length) || !in.take(code) || code >= count || length > rows - values.size()) return corrupt();
+            values.insert(values.end(), length, dictionary[code]);
+        }
+    } else {
+        uint8_t width;
+        std::string_view codes;
+        if (!in.take(width) || (width != 1 && width != 2 && width != 4) || !in.take(codes, size_t(rows) * width)) return corrupt();
+        for (uint32_t i = 0; i < rows; ++i) {
+            uint32_t code = 0;
+            std::memcpy(&code, codes.data() + size_t(i) * width, width);
+            if (code >= count) return corrupt();
+            values.push_back(dictionary[code]);
+        }
+    }
+    if (values.size() != rows) return corrupt();
+    return true;
+}
+
+bool ColumnarReader::readInts(size_t group, ColumnarColumn column, std::vector<int32_t>& values) {
+    values.clear();
+    std::string_view bytes;
+    if (!chunkBytes(group, column, bytes)) return false;
+    uint32_t rows = groups[group].rows;
+    if (groups[group].chunks[static_cast<size_t>(column)].encoding != ColumnarEncoding::Int32 || bytes.size() != size_t(rows) * 4) {
+        error_message = "malformed int32 column in row group " + std::to_string(group);
+        return false;
+    }
+    values.resize(rows);
+    std::memcpy(values.data(), bytes.data(), bytes.size());
+    return true;
+}
@@ -0,0 +1,123 @@
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../models/models.h"
+#include "../utils/mapped_file.h"
+
+class FdSink;
+
+// Column-oriented export of scheduler tasks for analytics. Rows are written
+// in row groups; within a group every column is a separate checksummed chunk:
+//   - text columns: sorted dictionary plus one 1/2/4-byte code per row
+//   - status, priority, component: sorted dictionary plus (length, code) runs
+//   - runtime and effort: little-endian int32 per row
+// A footer at the end of the file lists each chunk's offset, size, CRC32C,
+// encoding and min/max statistics, so a reader decodes only the columns it
+// asks for and can skip row groups whose statistics rule them out.
+//
+// File: 16-byte header (magic, version, reserved), row group chunks, footer,
+// 16-byte trailer (u64 footer offset, u32 footer crc, "QLCF").
+
+constexpr uint32_t kColumnarVersion = 1;
+constexpr size_t kColumnarRowGroupRows = 64 * 1024;
+
+enum class ColumnarColumn : uint32_t {
+    TaskId,
+    Description,
+    Owner,
+    DueDate,
+    Status, // TaskStatus name, e.g. "Completed"
+    Priority,
+    Component,
+    MaxRuntimeSec,
+    EstimatedEffort,
+    ActualEffort
+};
+constexpr size_t kColumnarColumnCount = 10;
+constexpr size_t kColumnarStringColumns = 7; // TaskId..Component; the rest are int32
+
+enum class ColumnarEncoding : uint8_t {
+    Dictionary = 1,
+    RunLength,
+    Int32
+};
+
+// Min/max of one column chunk: min/max for int32 columns, min_string/max_string otherwise.
+struct ColumnarStats {
+    int64_t min = 0;
+    int64_t max = 0;
+    std::string_view min_string;
+    std::string_view max_string;
+};
+
+const char* columnarStatusName(TaskStatus status);
+
+// Streams rows to a sink one row group at a time, so memory is bounded by the
+// group size. Rows refer to the task's strings until their group is written.
+class ColumnarWriter {
+public:
+    explicit ColumnarWriter(FdSink& sink, size_t rows_per_group = kColumnarRowGroupRows);
+    void addRow(const Task& task, TaskStatus status);
+    // Writes the last row group, the footer and the trailer. False on a write error.
+    bool finish();
+
+private:
+    void writeGroup();
+
+    FdSink& sink;
+    size_t group_rows;
+    std::vector<std::string_view> strings[kColumnarStringColumns];
+    std::vector<int32_t> ints[kColumnarColumnCount - kColumnarStringColumns];
+    std::string chunk;
+    std::string footer; // group entries, prefixed with the counts in finish()
+    uint64_t offset = 0;
+    uint64_t row_count = 0;
+    uint32_t group_count = 0;
+};
+
+// Memory-mapped columnar file. open() checks the footer; each chunk's CRC is
+// checked when it is decoded.
+class ColumnarReader {
+public:
+    bool open(const std::string& path);
+    const std::string& error() const { return error_message; }
+
+    uint64_t rowCount() const { return row_count; }
+    size_t rowGroupCount() const { return groups.size(); }
+    size_t rowGroupRows(size_t group) const { return groups[group].rows; }
+    const ColumnarStats& stats(size_t group, ColumnarColumn column) const {
+        return groups[group].chunks[static_cast<size_t>(column)].stats;
+    }
+
+    // Decodes one column of one row group. Strings point into the mapping.
+    bool readStrings(size_t group, ColumnarColumn column, std::vector<std::string_view>& values);
+    bool readInts(size_t group, ColumnarColumn column, std::vector<int32_t>& values);
+
+private:
+    struct Chunk {
+        uint64_t offset = 0;
+        uint32_t size = 0;
+        uint32_t crc = 0;
+        ColumnarEncoding encoding = ColumnarEncoding::Int32;
+        ColumnarStats stats;
+    };
+    struct Group {
+        uint32_t rows = 0;
+        Chunk chunks[kColumnarColumnCount];
+    };
+
+    bool fail(const std::string& message);
+    bool chunkBytes(size_t group, ColumnarColumn column, std::string_view& bytes);
+
+    MappedFile file;
+    std::string error_message;
+    uint64_t row_count = 0;
+    std::vector<Group> groups;
+};
+
+#endif // COLUMNAR_H
@@ -0,0 +1,188 @@
+#include "compressed_file.h"
+#include "../utils/crc32c.h"
+#include "../utils/fd_sink.h"
+#include "../utils/lz_block.h"
+#include "../utils/mapped_file.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+constexpr char kMagic[8] = {'Q', 'L', 'Z', 'B', 'L', 'K', '\r', '\n'};
+constexpr size_t kHeaderBytes = 16;
+constexpr size_t kBlockHeaderBytes = 12;
+constexpr uint32_t kStoredRaw = 1u << 31;
+constexpr size_t kMaxBlockSize = 64 << 20;
+
+unsigned workerCount(unsigned threads, size_t blocks) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, blocks)));
+}
+
+// Runs fn(k) for every block, worker t taking blocks t, t + workers, ...
+// (the caller's thread is worker 0).
+template <typename Fn>
+void forEachBlock(size_t count, unsigned workers, Fn fn) {
+    auto run = [&](unsigned first) {
+        for (size_t k = first; k < count; k += workers) fn(k);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < workers; ++t) pool.emplace_back(run, t);
+    run(0);
+    for (auto& thread : pool) thread.join();
+}
+
+// Block header plus payload; stored uncompressed if compression does not help.
+void encodeBlock(const char* raw, size_t n, std::string& out) {
+    out.resize(kBlockHeaderBytes + lz_compress_bound(n));
+    size_t size = lz_compress_block(raw, n, &out[kBlockHeaderBytes]);
+    uint32_t stored = static_cast<uint32_t>(size);
+    if (size >= n) {
+        std::memcpy(&out[kBlockHeaderBytes], raw, n);
+        size = n;
+        stored = static_cast<uint32_t>(n) | kStoredRaw;
+    }
+    uint32_t header[3] = {stored, static_cast<uint32_t>(n), crc32c(raw, n)};
+    std::memcpy(&out[0], header, sizeof(header));
+    out.resize(kBlockHeaderBytes + size);
+}
+
+} // namespace
+
+// --- CompressedWriter ---
+
+CompressedWriter::CompressedWriter(FdSink& out, unsigned thread_count, size_t size)
+    : sink(out), block_size(std::min(std::max<size_t>(size, 64), kMaxBlockSize)),
+      threads(thread_count ? thread_count : std::max(1u, std::thread::hardware_concurrency())) {
+    char header[kHeaderBytes] = {};
+    uint32_t fields[2] = {kCompressedVersion, static_cast<uint32_t>(block_size)};
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    std::memcpy(header + sizeof(kMagic), fields, sizeof(fields));
+    sink.write(header, sizeof(header));
+    input.reserve(block_size * threads);
+}
+
+void CompressedWriter::write(const char* data, size_t n) {
+    raw_bytes += n;
+    size_t capacity = block_size * threads;
+    while (n > 0) {
+        size_t take = std::min(n, capacity - input.size());
+        input.append(data, take);
+        data += take;
+        n -= take;
+        if (input.size() == capacity) compressBatch();
+    }
+}
+
+void CompressedWriter::compressBatch() {
+    size_t count = (input.size() + block_size - 1) / block_size;
+    blocks.resize(std::max(blocks.size(), count));
+    forEachBlock(count, workerCount(threads, count), [&](size_t k) {
+        size_t begin = k * block_size;
+        encodeBlock(input.data() + begin, std::min(block_size, input.size() - begin), blocks[k]);
+    });
+    for (size_t k = 0; k < count; ++k) sink.write(blocks[k]);
+    input.clear();
+}
+
+bool CompressedWriter::finish() {
+    if (!input.empty()) compressBatch();
+    char trailer[12] = {};
+    std::memcpy(trailer + 4, &raw_bytes, sizeof(raw_bytes));
+    sink.write(trailer, sizeof(trailer));
+    return sink.ok();
+}
+
+// --- Reading ---
+
+bool readCompressedFile(const std::string& path, std::string& out, std::string& error, unsigned threads) {
+    MappedFile file(path);
+    if (!file.is_open()) {
+        error = "cannot map " + path;
+        return false;
+    }
+    if (decompress(file.view(), out, error, threads)) return true;
+    error = path + ": " + error;
+    return false;
+}
+
+bool decompress(std::string_view bytes, std::string& out, std::string& error, unsigned threads) {
+    uint32_t fields[2] = {0, 0};
+    if (bytes.size() < kHeaderBytes || std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) {
+        error = "not compressed data";
+        return false;
+    }
+    std::memcpy(fields, bytes.data() + sizeof(kMagic), sizeof(fields));
+    if (fields[0] == 0 || fields[0] > kCompressedVersion) {
+        error = "unsupported compressed data version " + std::to_string(fields[0]);
+        return false;
+    }
+    size_t max_block = std::min<size_t>(fields[1], kMaxBlockSize);
+
+    // Index the blocks first so they can be decoded straight into place.
+    struct Block {
+        size_t offset;   // payload offset in the file
+        uint32_t stored; // payload size plus the kStoredRaw flag
+        uint32_t raw_size;
+        uint32_t crc;
+        size_t out_offset;
+    };
+    std::vector<Block> index;
+    size_t pos = kHeaderBytes;
+    uint64_t total = 0;
+    for (;;) {
+        uint32_t stored = 0;
+        if (bytes.size() - pos < sizeof(stored)) break;
+        std::memcpy(&stored, bytes.data() + pos, sizeof(stored));
+        if (stored == 0) break;
+        uint32_t header[3];
+        if (bytes.size() - pos < kBlockHeaderBytes) break;
+        std::memcpy(header, bytes.data() + pos, sizeof(header));
+        size_t payload = header[0] & ~kStoredRaw;
+        bool raw = header[0] & kStoredRaw;
+        if (header[1] == 0 || header[1] > max_block || (raw ? payload != header[1] : payload > lz_compress_bound(header[1])) ||
+            payload > bytes.size() - pos - kBlockHeaderBytes) {
+            error = "corrupt block header at byte " + std::to_string(pos);
+            return false;
+        }
+        index.push_back(Block{pos + kBlockHeaderBytes, header[0], header[1], header[2], static_cast<size_t>(total)});
+        total += header[1];
+        pos += kBlockHeaderBytes + payload;
+    }
+    uint64_t expected = 0;
+    if (bytes.size() - pos == 12) std::memcpy(&expected, bytes.data() + pos + 4, sizeof(expected));
+    if (bytes.size() - pos != 12 || expected != total) {
+        error = "compressed data is truncated";
+        return false;
+    }
+
+    out.resize(total);
+    std::atomic<size_t> bad{index.size()};
+    forEachBlock(index.size(), workerCount(threads, index.size()), [&](size_t k) {
+        const Block& b = index[k];
+        char* dst = &out[b.out_offset];
+        size_t payload = b.stored & ~kStoredRaw;
+        bool ok = true;
+        if (b.stored & kStoredRaw) std::memcpy(dst, bytes.data() + b.offset, payload);
+        else ok = lz_decompress_block(bytes.data() + b.offset, payload, dst, b.raw_size);
+        if (!ok || crc32c(dst, b.raw_size) != b.crc) {
+            size_t seen = bad.load();
+            while (k < seen && !bad.compare_exchange_weak(seen, k)) {}
+        }
+    });
+    if (bad.load() < index.size()) {
+        error = "block " + std::to_string(bad.load()) + " is corrupt";
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+bool isCompressedFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kMagic)] = {};
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
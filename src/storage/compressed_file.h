@@ -0,0 +1,57 @@
+#ifndef COMPRESSED_FILE_H
+#define COMPRESSED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class FdSink;
+
+// Framed block compression (utils/lz_block.h) for backups. Input is cut into
+// independent blocks, so both directions run one block per thread.
+//
+// File: 16-byte header (magic, version, block size), then per block
+//   u32 stored size (bit 31: stored uncompressed) | u32 raw size | u32 crc32c of raw | bytes
+// and an end mark (u32 0) followed by the u64 total raw size.
+
+constexpr uint32_t kCompressedVersion = 1;
+constexpr size_t kCompressedBlockSize = 1 << 20;
+
+// Compresses everything written to it into a sink. Input is gathered into
+// one block per thread, compressed in parallel and written in order, so memory
+// is bounded by threads * block_size.
+class CompressedWriter {
+public:
+    explicit CompressedWriter(FdSink& sink, unsigned threads = 0, size_t block_size = kCompressedBlockSize);
+    CompressedWriter(const CompressedWriter&) = delete;
+    CompressedWriter& operator=(const CompressedWriter&) = delete;
+
+    void write(const char* data, size_t n);
+    void write(std::string_view data) { write(data.data(), data.size()); }
+    // Compresses what is buffered and writes the end mark. False on a write error.
+    bool finish();
+    uint64_t rawBytes() const { return raw_bytes; }
+
+private:
+    void compressBatch();
+
+    FdSink& sink;
+    size_t block_size;
+    unsigned threads;
+    std::string input;
+    std::vector<std::string> blocks;
+    uint64_t raw_bytes = 0;
+};
+
+// Decompresses a whole file into out, one block per thread (0: one per
+// hardware thread). Each block's checksum and the total size are verified.
+bool readCompressedFile(const std::string& path, std::string& out, std::string& error, unsigned threads = 0);
+// Same, for a frame that is already in memory (e.g. embedded after another header).
+bool decompress(std::string_view frame, std::string& out, std::string& error, unsigned threads = 0);
+
+// True if path starts with the compressed-file magic.
+bool isCompressedFile(const std::string& path);
+
+#endif // COMPRESSED_FILE_H
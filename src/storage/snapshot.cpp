@@ -0,0 +1,389 @@
+#include "snapshot.h"
+#include "task_codec.h"
+#include "../utils/crc32c.h"
+#include "../utils/fd_sink.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+constexpr char kMagic[8] = {'Q', 'L', 'S', 'N', 'A', 'P', '\r', '\n'};
+constexpr uint32_t kNoRecord = static_cast<uint32_t>(-1);
+
+// Task booleans share the record flags above the public bits.
+constexpr uint32_t kConfirmed = 1u << 8;
+constexpr uint32_t kArchived = 1u << 9;
+constexpr uint32_t kContainsSecrets = 1u << 10;
+constexpr uint32_t kPublicFlags = 0xFF;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    uint64_t file_size;
+    uint32_t body_crc;   // everything after the header
+    uint32_t header_crc; // the header bytes before this field
+};
+static_assert(sizeof(FileHeader) == 32, "snapshot header layout");
+
+struct SectionEntry {
+    uint32_t kind;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+static_assert(sizeof(SectionEntry) == 24, "snapshot section entry layout");
+static_assert(sizeof(SnapshotWriter::TaskRecord) == 120, "snapshot task record layout");
+static_assert(SnapshotWriter::TaskRecord::kStrings == kTaskStringFieldCount, "snapshot stores every Task string");
+
+enum SectionKind : uint32_t {
+    kStringOffsets = 1,
+    kStringData,
+    kTasks,
+    kListPool,
+    kSchedule,
+    kInProgress,
+    kCompleted,
+    kPaused,
+    kRetries,
+    kCancellations,
+    kMeta,
+    kSectionCount = kMeta
+};
+
+constexpr uint64_t kDirectoryBytes = sizeof(SectionEntry) * kSectionCount;
+// schedule id, name, retry limit, circuit failures, circuit state, reserved,
+// WAL LSN (two words). Files without the LSN words read it as 0.
+constexpr size_t kMetaWords = 8;
+constexpr size_t kMinMetaWords = 6;
+
+uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+} // namespace
+
+// --- SnapshotWriter ---
+
+SnapshotWriter::SnapshotWriter() {
+    string_offsets.push_back(0);
+    intern(""); // index 0, so zeroed records read back as empty strings
+}
+
+uint32_t SnapshotWriter::intern(std::string_view s) {
+    auto it = interned.find(s);
+    if (it != interned.end()) return it->second;
+    uint32_t index = static_cast<uint32_t>(strings.size());
+    strings.push_back(s);
+    string_offsets.push_back(string_offsets.back() + s.size());
+    record_by_string.push_back(kNoRecord);
+    interned.emplace(s, index);
+    return index;
+}
+
+uint32_t SnapshotWriter::appendList(const std::vector<std::string>& items) {
+    uint32_t offset = static_cast<uint32_t>(pool.size());
+    pool.push_back(static_cast<uint32_t>(items.size()));
+    for (const auto& item : items) pool.push_back(intern(item));
+    return offset;
+}
+
+uint32_t SnapshotWriter::addTask(const Task& task, uint32_t flags) {
+    TaskRecord r{};
+    for (int i = 0; i < TaskRecord::kStrings; ++i) r.strings[i] = intern(task.*kTaskStringFields[i]);
+    r.dependencies = appendList(task.dependencies);
+    dependency_lists.push_back(r.dependencies);
+    r.overlapping_task_ids = appendList(task.overlapping_task_ids);
+    r.labels = appendList(task.labels);
+    r.watchers = appendList(task.watchers);
+    r.max_runtime_sec = task.max_runtime_sec;
+    r.estimated_effort = task.estimated_effort;
+    r.actual_effort = task.actual_effort;
+    r.sequence_number = task.sequence_number;
+    r.payload_size = task.payload_size;
+    r.flags = (flags & kPublicFlags) | (task.confirmed ? kConfirmed : 0) | (task.archived ? kArchived : 0) |
+              (task.contains_secrets ? kContainsSecrets : 0);
+    uint32_t index = static_cast<uint32_t>(records.size());
+    uint32_t& owner = record_by_string[r.strings[0]];
+    if (owner == kNoRecord || ((flags & kSnapshotLive) && !(records[owner].flags & kSnapshotLive))) owner = index;
+    records.push_back(r);
+    return index;
+}
+
+void SnapshotWriter::addScheduledTask(const Task& task) {
+    uint32_t owner = record_by_string[intern(task.task_id)];
+    if (owner != kNoRecord && (records[owner].flags & kSnapshotLive)) scheduled.push_back(owner);
+    else scheduled.push_back(addTask(task, 0));
+}
+
+void SnapshotWriter::addListEntry(SnapshotList list, std::string_view task_id) {
+    lists[static_cast<int>(list)].push_back(intern(task_id));
+}
+
+void SnapshotWriter::addRetryCount(std::string_view task_id, uint32_t count) {
+    retries.push_back(intern(task_id));
+    retries.push_back(count);
+}
+
+void SnapshotWriter::addCancellation(std::string_view task_id, std::string_view reason) {
+    cancellations.push_back(intern(task_id));
+    cancellations.push_back(intern(reason));
+}
+
+void SnapshotWriter::setMeta(const SnapshotMeta& m) {
+    meta = m;
+    meta_strings[0] = intern(meta.schedule_id);
+    meta_strings[1] = intern(meta.schedule_name);
+}
+
+// Dependencies are collected as ids; once every task is known they become
+// record indices, or tagged string indices for ids with no record.
+void SnapshotWriter::resolveDependencies() {
+    for (uint32_t offset : dependency_lists) {
+        uint32_t count = pool[offset];
+        for (uint32_t k = 1; k <= count; ++k) {
+            uint32_t id = pool[offset + k];
+            uint32_t record = record_by_string[id];
+            pool[offset + k] = record != kNoRecord ? record : (id | kSnapshotExternalDependency);
+        }
+    }
+    dependency_lists.clear();
+}
+
+// Emits the section directory and sections through out(data, size) and
+// returns the byte count. Called twice by write(): once to checksum, once to write.
+template <typename Emit>
+uint64_t SnapshotWriter::emit(Emit&& out) const {
+    static const char zeros[8] = {};
+    const uint64_t sizes[kSectionCount] = {
+        string_offsets.size() * sizeof(uint64_t),
+        string_offsets.back(),
+        records.size() * sizeof(TaskRecord),
+        pool.size() * sizeof(uint32_t),
+        scheduled.size() * sizeof(uint32_t),
+        lists[0].size() * sizeof(uint32_t),
+        lists[1].size() * sizeof(uint32_t),
+        lists[2].size() * sizeof(uint32_t),
+        retries.size() * sizeof(uint32_t),
+        cancellations.size() * sizeof(uint32_t),
+        kMetaWords * sizeof(uint32_t)};
+    uint64_t offset = sizeof(FileHeader) + kDirectoryBytes;
+    for (uint32_t i = 0; i < kSectionCount; ++i) {
+        SectionEntry entry{i + 1, 0, offset, sizes[i]};
+        out(&entry, sizeof(entry));
+        offset += align8(sizes[i]);
+    }
+    auto pad = [&](uint64_t size) {
+        if (align8(size) != size) out(zeros, align8(size) - size);
+    };
+    auto section = [&](const void* data, uint64_t size) {
+        if (size) out(data, size);
+        pad(size);
+    };
+    section(string_offsets.data(), sizes[0]);
+    for (std::string_view s : strings) if (!s.empty()) out(s.data(), s.size());
+    pad(sizes[1]);
+    section(records.data(), sizes[2]);
+    section(pool.data(), sizes[3]);
+    section(scheduled.data(), sizes[4]);
+    for (int i = 0; i < 3; ++i) section(lists[i].data(), sizes[5 + i]);
+    section(retries.data(), sizes[8]);
+    section(cancellations.data(), sizes[9]);
+    const uint32_t meta_words[kMetaWords] = {meta_strings[0], meta_strings[1], static_cast<uint32_t>(meta.retry_limit),
+                                             static_cast<uint32_t>(meta.circuit_failures), meta.circuit_state, 0,
+                                             static_cast<uint32_t>(meta.wal_lsn), static_cast<uint32_t>(meta.wal_lsn >> 32)};
+    section(meta_words, sizes[10]);
+    return offset - sizeof(FileHeader);
+}
+
+bool SnapshotWriter::write(const std::string& path, bool durable) {
+    resolveDependencies();
+    uint32_t body_crc = 0;
+    uint64_t body_size = emit([&](const void* data, size_t n) { body_crc = crc32c(data, n, body_crc); });
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kSnapshotVersion;
+    header.section_count = kSectionCount;
+    header.file_size = sizeof(FileHeader) + body_size;
+    header.body_crc = body_crc;
+    header.header_crc = crc32c(&header, offsetof(FileHeader, header_crc));
+
+    std::string tmp = path + ".tmp";
+    FdSink sink;
+    if (!sink.open(tmp)) {
+        error = sink.lastError();
+        return false;
+    }
+    sink.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    emit([&](const void* data, size_t n) { sink.write(static_cast<const char*>(data), n); });
+    if (!sink.close(durable)) {
+        error = sink.lastError();
+        std::remove(tmp.c_str());
+        return false;
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        error = errno;
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// --- SnapshotReader ---
+
+bool SnapshotReader::fail(const std::string& message) {
+    error_message = message;
+    file.close();
+    return false;
+}
+
+bool SnapshotReader::open(const std::string& path) {
+    if (!file.open(path)) return fail("cannot map " + path);
+    return validate();
+}
+
+// Checks checksums and every index once, so the accessors can trust the mapping.
+bool SnapshotReader::validate() {
+    std::string_view bytes = file.view();
+    if (bytes.size() < sizeof(FileHeader)) return fail("file too small");
+    FileHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) return fail("not a snapshot");
+    if (header.header_crc != crc32c(&header, offsetof(FileHeader, header_crc))) return fail("header checksum mismatch");
+    if (header.version == 0 || header.version > kSnapshotVersion) {
+        return fail("unsupported snapshot version " + std::to_string(header.version));
+    }
+    if (header.file_size != bytes.size()) return fail("truncated snapshot");
+    if (header.body_crc != crc32c(bytes.data() + sizeof(FileHeader), bytes.size() - sizeof(FileHeader))) {
+        return fail("body checksum mismatch");
+    }
+    if (header.section_count > (bytes.size() - sizeof(FileHeader)) / sizeof(SectionEntry)) return fail("bad section directory");
+    file_version = header.version;
+
+    const char* base = bytes.data();
+    const char* found[kSectionCount] = {};
+    uint64_t sizes[kSectionCount] = {};
+    for (uint32_t i = 0; i < header.section_count; ++i) {
+        SectionEntry entry;
+        std::memcpy(&entry, base + sizeof(FileHeader) + i * sizeof(SectionEntry), sizeof(entry));
+        if (entry.kind == 0 || entry.kind > kSectionCount) continue; // newer section
+        if (entry.offset % 8 != 0 || entry.offset > bytes.size() || entry.size > bytes.size() - entry.offset) {
+            return fail("section " + std::to_string(entry.kind) + " out of bounds");
+        }
+        found[entry.kind - 1] = base + entry.offset;
+        sizes[entry.kind - 1] = entry.size;
+    }
+    for (uint32_t i = 0; i < kSectionCount; ++i) {
+        if (!found[i]) return fail("missing section " + std::to_string(i + 1));
+    }
+    auto indices = [&](SectionKind kind) {
+        return SnapshotIndices{reinterpret_cast<const uint32_t*>(found[kind - 1]), sizes[kind - 1] / sizeof(uint32_t)};
+    };
+
+    if (sizes[kStringOffsets - 1] < sizeof(uint64_t) || sizes[kStringOffsets - 1] % sizeof(uint64_t) != 0) return fail("bad string table");
+    string_offsets = reinterpret_cast<const uint64_t*>(found[kStringOffsets - 1]);
+    string_count = sizes[kStringOffsets - 1] / sizeof(uint64_t) - 1;
+    string_data = found[kStringData - 1];
+    if (string_offsets[0] != 0 || string_offsets[string_count] != sizes[kStringData - 1]) return fail("bad string table");
+    for (size_t i = 0; i < string_count; ++i) {
+        if (string_offsets[i] > string_offsets[i + 1]) return fail("bad string table");
+    }
+
+    if (sizes[kTasks - 1] % sizeof(SnapshotWriter::TaskRecord) != 0) return fail("bad task section");
+    records = reinterpret_cast<const SnapshotWriter::TaskRecord*>(found[kTasks - 1]);
+    task_count = sizes[kTasks - 1] / sizeof(SnapshotWriter::TaskRecord);
+    pool = indices(kListPool);
+    schedule = indices(kSchedule);
+    lists[0] = indices(kInProgress);
+    lists[1] = indices(kCompleted);
+    lists[2] = indices(kPaused);
+    retries = indices(kRetries);
+    cancelled = indices(kCancellations);
+    if (sizes[kMeta - 1] < kMinMetaWords * sizeof(uint32_t)) return fail("bad meta section");
+    meta_record = indices(kMeta).first;
+    meta_words = indices(kMeta).size();
+
+    auto validList = [&](uint32_t offset, bool dependencies) {
+        if (offset >= pool.size() || pool[offset] > pool.size() - offset - 1) return false;
+        for (uint32_t k = 1; k <= pool[offset]; ++k) {
+            uint32_t e = pool[offset + k];
+            bool ok = dependencies && !(e & kSnapshotExternalDependency) ? e < task_count
+                                                                          : (e & ~kSnapshotExternalDependency) < string_count;
+            if (!ok) return false;
+        }
+        return true;
+    };
+    for (size_t i = 0; i < task_count; ++i) {
+        const auto& r = records[i];
+        for (uint32_t s : r.strings) if (s >= string_count) return fail("task " + std::to_string(i) + " has a bad string index");
+        if (!validList(r.dependencies, true) || !validList(r.overlapping_task_ids, false) || !validList(r.labels, false) ||
+            !validList(r.watchers, false)) {
+            return fail("task " + std::to_string(i) + " has a bad list");
+        }
+    }
+    for (uint32_t record : schedule) if (record >= task_count) return fail("bad schedule entry");
+    for (const auto& list : lists) for (uint32_t s : list) if (s >= string_count) return fail("bad status list entry");
+    if (retries.size() % 2 != 0 || cancelled.size() % 2 != 0) return fail("bad pair section");
+    for (size_t i = 0; i < retries.size(); i += 2) if (retries[i] >= string_count) return fail("bad retry entry");
+    for (uint32_t s : cancelled) if (s >= string_count) return fail("bad cancellation entry");
+    if (meta_record[0] >= string_count || meta_record[1] >= string_count) return fail("bad meta section");
+    return true;
+}
+
+std::string_view SnapshotReader::string(uint32_t index) const {
+    return std::string_view(string_data + string_offsets[index], string_offsets[index + 1] - string_offsets[index]);
+}
+
+SnapshotIndices SnapshotReader::poolList(uint32_t offset) const { return SnapshotIndices{pool.first + offset + 1, pool[offset]}; }
+
+SnapshotIndices SnapshotReader::dependencyIndices(size_t record) const { return poolList(records[record].dependencies); }
+
+uint32_t SnapshotReader::taskFlags(size_t record) const { return records[record].flags & kPublicFlags; }
+
+Task SnapshotReader::task(size_t record) const {
+    const auto& r = records[record];
+    Task t;
+    for (int i = 0; i < SnapshotWriter::TaskRecord::kStrings; ++i) t.*kTaskStringFields[i] = std::string(string(r.strings[i]));
+    SnapshotIndices deps = poolList(r.dependencies);
+    t.dependencies.reserve(deps.size());
+    for (uint32_t e : deps) {
+        t.dependencies.emplace_back(e & kSnapshotExternalDependency ? string(e & ~kSnapshotExternalDependency)
+                                                                    : string(records[e].strings[0]));
+    }
+    auto strings = [&](uint32_t offset, std::vector<std::string>& out) {
+        SnapshotIndices list = poolList(offset);
+        out.reserve(list.size());
+        for (uint32_t s : list) out.emplace_back(string(s));
+    };
+    strings(r.overlapping_task_ids, t.overlapping_task_ids);
+    strings(r.labels, t.labels);
+    strings(r.watchers, t.watchers);
+    t.max_runtime_sec = r.max_runtime_sec;
+    t.estimated_effort = r.estimated_effort;
+    t.actual_effort = r.actual_effort;
+    t.sequence_number = r.sequence_number;
+    t.payload_size = static_cast<size_t>(r.payload_size);
+    t.confirmed = r.flags & kConfirmed;
+    t.archived = r.flags & kArchived;
+    t.contains_secrets = r.flags & kContainsSecrets;
+    return t;
+}
+
+SnapshotMeta SnapshotReader::meta() const {
+    SnapshotMeta m;
+    m.schedule_id = std::string(string(meta_record[0]));
+    m.schedule_name = std::string(string(meta_record[1]));
+    m.retry_limit = static_cast<int32_t>(meta_record[2]);
+    m.circuit_failures = static_cast<int32_t>(meta_record[3]);
+    m.circuit_state = meta_record[4];
+    if (meta_words >= kMetaWords) m.wal_lsn = meta_record[6] | (static_cast<uint64_t>(meta_record[7]) << 32);
+    return m;
+}
+
+bool isSnapshotFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kMagic)] = {};
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
@@ -0,0 +1,166 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../models/models.h"
+#include "../utils/mapped_file.h"
+
+// Versioned binary snapshot of scheduler state. The file is a fixed header,
+// a section directory and 8-byte aligned sections: a deduplicated string
+// table, fixed-size task records that refer to it by index, a pool of index
+// lists (dependency edges point at task records), the schedule membership
+// and the status/retry state. Everything after the header is covered by a
+// CRC32C stored in the header, which has its own CRC. Readers map the file
+// and use it in place; nothing is parsed.
+//
+// Sections a reader does not know are skipped, so new data can be added
+// without a version bump. Layout changes to existing sections bump
+// kSnapshotVersion; older readers then refuse the file.
+
+constexpr uint32_t kSnapshotVersion = 1;
+
+// Task record flags.
+constexpr uint32_t kSnapshotLive = 1u << 0;    // in the scheduler's task table
+constexpr uint32_t kSnapshotPending = 1u << 1; // in the pending queue
+constexpr uint32_t kSnapshotDraft = 1u << 2;   // a draft, not yet submitted
+
+// Dependency entries are task record indices, or string indices of ids that
+// had no record (orphaned dependencies) with this bit set.
+constexpr uint32_t kSnapshotExternalDependency = 1u << 31;
+
+// Ordered task id lists kept by the scheduler.
+enum class SnapshotList {
+    InProgress,
+    Completed,
+    Paused
+};
+
+struct SnapshotMeta {
+    std::string schedule_id;
+    std::string schedule_name;
+    int32_t retry_limit = 3;
+    int32_t circuit_failures = 0;
+    uint32_t circuit_state = 0;
+    uint64_t wal_lsn = 0; // last write-ahead log record already reflected in the snapshot
+};
+
+// Read-only view of uint32 entries inside a mapped snapshot.
+struct SnapshotIndices {
+    const uint32_t* first = nullptr;
+    size_t count = 0;
+    const uint32_t* begin() const { return first; }
+    const uint32_t* end() const { return first + count; }
+    size_t size() const { return count; }
+    uint32_t operator[](size_t i) const { return first[i]; }
+};
+
+// Collects scheduler state and writes it as one snapshot. Tasks and strings
+// are referenced, not copied, so they must outlive write().
+class SnapshotWriter {
+public:
+    SnapshotWriter();
+
+    // Returns the record index. Live records win when dependencies and
+    // schedule entries are resolved by id.
+    uint32_t addTask(const Task& task, uint32_t flags);
+    // Adds a schedule entry, sharing the live record with the same id if there is one.
+    void addScheduledTask(const Task& task);
+    void addListEntry(SnapshotList list, std::string_view task_id);
+    void addRetryCount(std::string_view task_id, uint32_t count);
+    void addCancellation(std::string_view task_id, std::string_view reason);
+    void setMeta(const SnapshotMeta& meta);
+
+    // Writes path.tmp and renames it over path, so a crash never leaves a
+    // torn snapshot. durable fsyncs before the rename.
+    bool write(const std::string& path, bool durable);
+    int lastError() const { return error; }
+
+    // On-disk task record; strings are string table indices, lists are pool
+    // offsets of [count, entries...] runs.
+    struct TaskRecord {
+        static constexpr int kStrings = 19;
+        uint32_t strings[kStrings];
+        uint32_t dependencies;
+        uint32_t overlapping_task_ids;
+        uint32_t labels;
+        uint32_t watchers;
+        int32_t max_runtime_sec;
+        int32_t estimated_effort;
+        int32_t actual_effort;
+        int32_t sequence_number;
+        uint32_t flags;
+        uint64_t payload_size;
+    };
+
+private:
+    uint32_t intern(std::string_view s);
+    uint32_t appendList(const std::vector<std::string>& items);
+    void resolveDependencies();
+    template <typename Emit> uint64_t emit(Emit&& out) const;
+
+    std::vector<std::string_view> strings;
+    std::vector<uint64_t> string_offsets;
+    std::unordered_map<std::string_view, uint32_t> interned;
+    std::vector<TaskRecord> records;
+    std::vector<uint32_t> record_by_string; // task id string -> record, or kNoRecord
+    std::vector<uint32_t> dependency_lists; // pool offsets still holding string indices
+    std::vector<uint32_t> pool;
+    std::vector<uint32_t> scheduled;
+    std::vector<uint32_t> lists[3];
+    std::vector<uint32_t> retries;       // (id, count) pairs
+    std::vector<uint32_t> cancellations; // (id, reason) pairs
+    uint32_t meta_strings[2] = {0, 0};
+    SnapshotMeta meta;
+    int error = 0;
+};
+
+// Validated, memory-mapped snapshot.
+class SnapshotReader {
+public:
+    bool open(const std::string& path);
+    const std::string& error() const { return error_message; }
+
+    uint32_t version() const { return file_version; }
+    size_t taskCount() const { return task_count; }
+    Task task(size_t record) const;
+    uint32_t taskFlags(size_t record) const;
+    SnapshotIndices dependencyIndices(size_t record) const;
+    std::string_view string(uint32_t index) const;
+
+    SnapshotMeta meta() const;
+    SnapshotIndices scheduled() const { return schedule; }
+    SnapshotIndices list(SnapshotList which) const { return lists[static_cast<int>(which)]; }
+    SnapshotIndices retryCounts() const { return retries; }       // (id, count) pairs
+    SnapshotIndices cancellations() const { return cancelled; }   // (id, reason) pairs
+
+private:
+    bool fail(const std::string& message);
+    bool validate();
+    SnapshotIndices poolList(uint32_t offset) const;
+
+    MappedFile file;
+    std::string error_message;
+    uint32_t file_version = 0;
+    const uint64_t* string_offsets = nullptr;
+    const char* string_data = nullptr;
+    size_t string_count = 0;
+    const SnapshotWriter::TaskRecord* records = nullptr;
+    size_t task_count = 0;
+    SnapshotIndices pool;
+    SnapshotIndices schedule;
+    SnapshotIndices lists[3];
+    SnapshotIndices retries;
+    SnapshotIndices cancelled;
+    const uint32_t* meta_record = nullptr; // see kMetaWords in snapshot.cpp
+    size_t meta_words = 0;
+};
+
+// True if path starts with the snapshot magic (cheap format sniffing).
+bool isSnapshotFile(const std::string& path);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,91 @@
+#include "task_codec.h"
+#include <cstdint>
+#include <cstring>
+
+std::string Task::* const kTaskStringFields[kTaskStringFieldCount] = {
+    &Task::task_id, &Task::description, &Task::priority, &Task::component, &Task::date,
+    &Task::time, &Task::platform, &Task::service, &Task::first_name, &Task::last_name,
+    &Task::contact_info, &Task::anonymous_id, &Task::due_date, &Task::blocked_by_note, &Task::owner,
+    &Task::cancellation_reason, &Task::creation_time, &Task::correlation_id, &Task::allowed_path};
+
+namespace {
+
+enum : uint8_t { kConfirmed = 1, kArchived = 2, kContainsSecrets = 4 };
+
+template <typename T>
+void putScalar(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putString(std::string& out, const std::string& s) {
+    putScalar(out, static_cast<uint32_t>(s.size()));
+    out += s;
+}
+
+void putList(std::string& out, const std::vector<std::string>& list) {
+    putScalar(out, static_cast<uint32_t>(list.size()));
+    for (const auto& s : list) putString(out, s);
+}
+
+template <typename T>
+bool takeScalar(std::string_view& in, T& value) {
+    if (in.size() < sizeof(T)) return false;
+    std::memcpy(&value, in.data(), sizeof(T));
+    in.remove_prefix(sizeof(T));
+    return true;
+}
+
+bool takeString(std::string_view& in, std::string& s) {
+    uint32_t n;
+    if (!takeScalar(in, n) || in.size() < n) return false;
+    s.assign(in.data(), n);
+    in.remove_prefix(n);
+    return true;
+}
+
+bool takeList(std::string_view& in, std::vector<std::string>& list) {
+    uint32_t n;
+    if (!takeScalar(in, n) || in.size() / sizeof(uint32_t) < n) return false;
+    list.resize(n);
+    for (auto& s : list) if (!takeString(in, s)) return false;
+    return true;
+}
+
+} // namespace
+
+void encode_task(std::string& out, const Task& task) {
+    for (auto field : kTaskStringFields) putString(out, task.*field);
+    putList(out, task.dependencies);
+    putList(out, task.overlapping_task_ids);
+    putList(out, task.labels);
+    putList(out, task.watchers);
+    putScalar(out, static_cast<int32_t>(task.max_runtime_sec));
+    putScalar(out, static_cast<int32_t>(task.estimated_effort));
+    putScalar(out, static_cast<int32_t>(task.actual_effort));
+    putScalar(out, static_cast<int32_t>(task.sequence_number));
+    putScalar(out, static_cast<uint64_t>(task.payload_size));
+    putScalar(out, static_cast<uint8_t>((task.confirmed ? kConfirmed : 0) | (task.archived ? kArchived : 0) |
+                                        (task.contains_secrets ? kContainsSecrets : 0)));
+}
+
+bool decode_task(std::string_view& in, Task& task) {
+    for (auto field : kTaskStringFields) if (!takeString(in, task.*field)) return false;
+    if (!takeList(in, task.dependencies) || !takeList(in, task.overlapping_task_ids) || !takeList(in, task.labels) ||
+        !takeList(in, task.watchers)) {
+        return false;
+    }
+    int32_t ints[4];
+    uint64_t payload;
+    uint8_t flags;
+    for (auto& v : ints) if (!takeScalar(in, v)) return false;
+    if (!takeScalar(in, payload) || !takeScalar(in, flags)) return false;
+    task.max_runtime_sec = ints[0];
+    task.estimated_effort = ints[1];
+    task.actual_effort = ints[2];
+    task.sequence_number = ints[3];
+    task.payload_size = static_cast<size_t>(payload);
+    task.confirmed = flags & kConfirmed;
+    task.archived = flags & kArchived;
+    task.contains_secrets = flags & kContainsSecrets;
+    return true;
+}
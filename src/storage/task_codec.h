@@ -0,0 +1,18 @@
+#ifndef TASK_CODEC_H
+#define TASK_CODEC_H
+
+#include <string>
+#include <string_view>
+#include "../models/models.h"
+
+// Order in which the binary formats store Task's string fields.
+constexpr int kTaskStringFieldCount = 19;
+extern std::string Task::* const kTaskStringFields[kTaskStringFieldCount];
+
+// Self-contained binary encoding of one Task (every field, length-prefixed,
+// little-endian), used where records are written one at a time.
+void encode_task(std::string& out, const Task& task);
+// Consumes one encoded task from the front of in; false if it is truncated.
+bool decode_task(std::string_view& in, Task& task);
+
+#endif // TASK_CODEC_H
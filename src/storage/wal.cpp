@@ -0,0 +1,262 @@
+#include "wal.h"
+#include "../utils/crc32c.h"
+#include "../utils/mapped_file.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'Q', 'L', 'W', 'A', 'L', '\0', '\r', '\n'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFileHeaderBytes = 16;
+constexpr size_t kRecordHeaderBytes = 16; // length, crc, lsn
+
+struct RecordHeader {
+    uint32_t length;
+    uint32_t crc;
+    uint64_t lsn;
+};
+static_assert(sizeof(RecordHeader) == kRecordHeaderBytes, "WAL record header layout");
+
+void putField(std::string& out, std::string_view field) {
+    uint32_t n = static_cast<uint32_t>(field.size());
+    out.append(reinterpret_cast<const char*>(&n), sizeof(n));
+    out.append(field.data(), field.size());
+}
+
+bool writeAll(int fd, const char* data, size_t n, int& error) {
+    while (n > 0) {
+        ssize_t w = ::write(fd, data, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            error = errno;
+            return false;
+        }
+        data += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+} // namespace
+
+WriteAheadLog::~WriteAheadLog() { close(); }
+
+bool WriteAheadLog::replay(const std::string& path, uint64_t after_lsn, const std::function<void(const WalRecord&)>& apply,
+                           uint64_t& last_lsn, std::string& error) {
+    last_lsn = after_lsn;
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || st.st_size == 0) return true; // no log yet
+    size_t good_end = 0;
+    size_t file_size = 0;
+    {
+        MappedFile file(path);
+        if (!file.is_open()) {
+            error = "cannot map " + path;
+            return false;
+        }
+        std::string_view bytes = file.view();
+        file_size = bytes.size();
+        uint32_t version = 0;
+        if (bytes.size() >= kFileHeaderBytes) std::memcpy(&version, bytes.data() + sizeof(kMagic), sizeof(version));
+        if (bytes.size() < kFileHeaderBytes || std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0 || version != kVersion) {
+            error = path + " is not a version " + std::to_string(kVersion) + " write-ahead log";
+            return false;
+        }
+        size_t pos = kFileHeaderBytes;
+        uint64_t prev_lsn = 0;
+        while (bytes.size() - pos >= kRecordHeaderBytes) {
+            RecordHeader header;
+            std::memcpy(&header, bytes.data() + pos, sizeof(header));
+            size_t body = pos + kRecordHeaderBytes;
+            if (header.length == 0 || header.length > bytes.size() - body || header.lsn <= prev_lsn) break;
+            uint32_t crc = crc32c(&header.lsn, sizeof(header.lsn));
+            if (crc32c(bytes.data() + body, header.length, crc) != header.crc) break;
+            WalRecord record;
+            record.lsn = header.lsn;
+            record.op = static_cast<WalOp>(bytes[body]);
+            std::string_view rest = bytes.substr(body + 1, header.length - 1);
+            bool ok = true;
+            while (!rest.empty() && ok) {
+                uint32_t n;
+                ok = record.field_count < 2 && rest.size() >= sizeof(n);
+                if (!ok) break;
+                std::memcpy(&n, rest.data(), sizeof(n));
+                rest.remove_prefix(sizeof(n));
+                ok = n <= rest.size();
+                if (!ok) break;
+                record.fields[record.field_count++] = rest.substr(0, n);
+                rest.remove_prefix(n);
+            }
+            if (!ok) break;
+            if (record.lsn > after_lsn) apply(record);
+            if (record.lsn > last_lsn) last_lsn = record.lsn;
+            prev_lsn = record.lsn;
+            pos = body + header.length;
+        }
+        good_end = pos;
+    }
+    // A crash mid-append leaves a partial record; drop it so new appends follow the last good one.
+    if (good_end < file_size && ::truncate(path.c_str(), static_cast<off_t>(good_end)) != 0) {
+        error = "cannot truncate torn tail of " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool WriteAheadLog::open(const std::string& path, uint64_t next_lsn, const WalOptions& options) {
+    close();
+    int descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (descriptor < 0) {
+        error = errno;
+        return false;
+    }
+    struct stat st;
+    if (::fstat(descriptor, &st) != 0) {
+        error = errno;
+        ::close(descriptor);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        char header[kFileHeaderBytes] = {};
+        std::memcpy(header, kMagic, sizeof(kMagic));
+        std::memcpy(header + sizeof(kMagic), &kVersion, sizeof(kVersion));
+        int err = 0;
+        if (!writeAll(descriptor, header, sizeof(header), err) || ::fdatasync(descriptor) != 0) {
+            error = err ? err : errno;
+            ::close(descriptor);
+            return false;
+        }
+        size = sizeof(header);
+    }
+    fd = descriptor;
+    opts = options;
+    next = next_lsn;
+    durable_lsn = next_lsn - 1;
+    file_bytes = size;
+    pending.clear();
+    error = 0;
+    stopping = false;
+    flusher = std::thread(&WriteAheadLog::flusherLoop, this);
+    return true;
+}
+
+void WriteAheadLog::close() {
+    if (fd < 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (flusher.joinable()) flusher.join();
+    ::close(fd);
+    fd = -1;
+}
+
+uint64_t WriteAheadLog::append(WalOp op, std::string_view a, std::string_view b) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error != 0) return 0;
+    uint64_t lsn = next++;
+    size_t start = pending.size();
+    pending.resize(start + kRecordHeaderBytes);
+    pending.push_back(static_cast<char>(op));
+    if (!a.empty() || !b.empty()) putField(pending, a);
+    if (!b.empty()) putField(pending, b);
+    RecordHeader header;
+    header.length = static_cast<uint32_t>(pending.size() - start - kRecordHeaderBytes);
+    header.lsn = lsn;
+    header.crc = crc32c(pending.data() + start + kRecordHeaderBytes, header.length, crc32c(&header.lsn, sizeof(header.lsn)));
+    std::memcpy(&pending[start], &header, sizeof(header));
+    file_bytes += pending.size() - start;
+    if (pending.size() >= opts.commit_bytes) wake.notify_one();
+    return lsn;
+}
+
+// One write and one fdatasync per batch, however many appends it holds.
+void WriteAheadLog::flusherLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait_for(lock, opts.commit_interval,
+                      [&] { return stopping || sync_requested || pending.size() >= opts.commit_bytes; });
+        sync_requested = false;
+        // After a failed write or fdatasync the file may end in a torn record
+        // and the page cache may have dropped dirty pages, so nothing more is
+        // written until truncate() starts the log over.
+        if (error != 0) pending.clear();
+        if (pending.empty()) {
+            if (stopping) break;
+            continue;
+        }
+        writing.swap(pending);
+        uint64_t batch_lsn = next - 1;
+        flushing = true;
+        lock.unlock();
+        int err = 0;
+        bool ok = writeAll(fd, writing.data(), writing.size(), err);
+        if (ok && ::fdatasync(fd) != 0) {
+            ok = false;
+            err = errno;
+        }
+        writing.clear();
+        lock.lock();
+        flushing = false;
+        if (ok) durable_lsn = batch_lsn;
+        else if (error == 0) error = err;
+        durable.notify_all();
+    }
+}
+
+bool WriteAheadLog::sync(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (fd < 0) return false;
+    if (lsn >= next) lsn = next - 1;
+    while (durable_lsn < lsn && error == 0) {
+        sync_requested = true;
+        wake.notify_one();
+        durable.wait(lock);
+    }
+    return error == 0;
+}
+
+bool WriteAheadLog::truncate() {
+    if (fd < 0 || (!sync() && lastError() == 0)) return false;
+    std::unique_lock<std::mutex> lock(mutex);
+    durable.wait(lock, [&] { return !flushing; });
+    bool failed = error != 0;
+    if (failed) pending.clear(); // appends failed while the log was broken
+    if (::ftruncate(fd, static_cast<off_t>(kFileHeaderBytes)) != 0 || ::fdatasync(fd) != 0) {
+        if (error == 0) error = errno;
+        return false;
+    }
+    if (failed) {
+        // The checkpoint that preceded this holds every transition, logged or not.
+        error = 0;
+        durable_lsn = next - 1;
+    }
+    file_bytes = kFileHeaderBytes + pending.size();
+    return true;
+}
+
+uint64_t WriteAheadLog::lastLsn() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return next - 1;
+}
+
+uint64_t WriteAheadLog::durableLsn() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return durable_lsn;
+}
+
+size_t WriteAheadLog::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return file_bytes;
+}
+
+int WriteAheadLog::lastError() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+}
@@ -0,0 +1,109 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Append-only write-ahead log of scheduler state transitions. Appends are
+// encoded into an in-memory batch and return immediately; a background
+// thread writes each batch with one write() and one fdatasync() (group
+// commit), so the per-operation cost is a memcpy rather than a disk flush.
+// Callers that must not lose an operation call sync() with its LSN. The
+// first failed write or fdatasync breaks the log: nothing more is written,
+// append() returns 0 and sync() fails, until truncate() (after a checkpoint)
+// or a reopen starts over.
+//
+// File: 16-byte header (magic, version), then records of
+//   u32 length | u32 crc32c | u64 lsn | u8 op | fields (u32 length + bytes each)
+// where length counts the op byte and fields, and the CRC covers lsn, op and
+// fields. Replay stops at the first torn or corrupt record and truncates it.
+
+enum class WalOp : uint8_t {
+    Submit = 1, // encoded task
+    Dispatch,   // task id
+    Complete,   // task id, agent id
+    Fail,       // task id
+    Pause,      // task id
+    Resume,     // task id
+    Cancel,     // task id, reason
+    Archive,    // task id
+    Restore,    // task id
+    Remove,     // task id
+    AgePriorities
+};
+
+struct WalRecord {
+    uint64_t lsn = 0;
+    WalOp op = WalOp::Submit;
+    std::string_view fields[2];
+    int field_count = 0;
+};
+
+struct WalOptions {
+    std::chrono::milliseconds commit_interval{5}; // longest an append waits for its batch to be flushed
+    size_t commit_bytes = 1 << 20;                // flush early once a batch reaches this size
+    size_t checkpoint_bytes = 64 << 20;           // log size at which the scheduler checkpoints
+};
+
+class WriteAheadLog {
+public:
+    WriteAheadLog() = default;
+    ~WriteAheadLog();
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Replays records with lsn > after_lsn in order, truncating a torn tail.
+    // last_lsn receives the highest LSN in the file (or after_lsn). A missing
+    // file is an empty log.
+    static bool replay(const std::string& path, uint64_t after_lsn, const std::function<void(const WalRecord&)>& apply,
+                       uint64_t& last_lsn, std::string& error);
+
+    // Opens (creating if needed) for appending; the next record gets next_lsn.
+    bool open(const std::string& path, uint64_t next_lsn, const WalOptions& options = WalOptions());
+    void close();
+    bool is_open() const { return fd >= 0; }
+
+    // The record's LSN, or 0 once the log has failed.
+    uint64_t append(WalOp op, std::string_view a = {}, std::string_view b = {});
+    // Blocks until every record up to lsn is on disk; false on I/O error.
+    bool sync(uint64_t lsn);
+    bool sync() { return sync(lastLsn()); }
+    // Syncs, then drops every record (after a checkpoint captured them). On a
+    // failed log it drops them unsynced and, if the truncation is durable,
+    // clears the error.
+    bool truncate();
+
+    uint64_t lastLsn() const;
+    uint64_t durableLsn() const;
+    size_t size() const;
+    int lastError() const;
+
+private:
+    void flusherLoop();
+    bool writeBatch(std::string& batch, uint64_t batch_lsn);
+
+    int fd = -1;
+    WalOptions opts;
+    mutable std::mutex mutex;
+    std::condition_variable wake;    // flusher: work or shutdown
+    std::condition_variable durable; // sync(): batch flushed
+    std::string pending;
+    std::string writing;
+    uint64_t next = 1;
+    uint64_t durable_lsn = 0;
+    size_t file_bytes = 0;
+    bool sync_requested = false;
+    bool flushing = false;
+    bool stopping = false;
+    int error = 0;
+    std::thread flusher;
+};
+
+#endif // WAL_H
@@ -0,0 +1,416 @@
+#include "batch_io.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define QL_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+// Most task files and results fit; longer files are finished with plain reads.
+constexpr size_t kReadChunk = 16 * 1024;
+
+} // namespace
+
+struct BatchIo::Op {
+    enum Kind : uint8_t { Open, Read, Write, Fsync, Close, Rename, Unlink } kind;
+    int fd = -1;
+    const char* path = nullptr;
+    const char* path2 = nullptr; // rename target
+    char* buf = nullptr;
+    size_t len = 0;
+    int flags = 0;     // open flags
+    bool link = false; // the next op runs only if this one succeeds
+
+    bool failed(int result) const { return result < 0 || ((kind == Read || kind == Write) && static_cast<size_t>(result) != len); }
+    // io_uring cancels the rest of a chain after a failed or short read or
+    // write, or a failed open or close, but not reliably after a failed
+    // rename or unlink; the direct path does the same.
+    bool breaksChain(int result) const { return kind != Rename && kind != Unlink && failed(result); }
+};
+
+#ifdef QL_HAVE_IO_URING
+
+struct BatchIo::Ring {
+    int fd = -1;
+    unsigned entries = 0;
+    void* sq_ptr = MAP_FAILED;
+    size_t sq_bytes = 0;
+    void* cq_ptr = MAP_FAILED;
+    size_t cq_bytes = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqe_bytes = 0;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) ::munmap(sqes, sqe_bytes);
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) ::munmap(cq_ptr, cq_bytes);
+        if (sq_ptr != MAP_FAILED) ::munmap(sq_ptr, sq_bytes);
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool setup(unsigned depth) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, depth, &params));
+        if (fd < 0 || !supportsOps()) return false;
+        entries = params.sq_entries;
+        sq_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) sq_bytes = cq_bytes = std::max(sq_bytes, cq_bytes);
+        sq_ptr = ::mmap(nullptr, sq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) return false;
+        cq_ptr = single ? sq_ptr : ::mmap(nullptr, cq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) return false;
+        sqe_bytes = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqe_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) return false;
+        char* sq = static_cast<char*>(sq_ptr);
+        char* cq = static_cast<char*>(cq_ptr);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    bool supportsOps() {
+        const unsigned kOps = 256;
+        std::vector<char> storage(sizeof(io_uring_probe) + kOps * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, kOps) < 0) return false;
+        for (int op : {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC, IORING_OP_CLOSE, IORING_OP_RENAMEAT, IORING_OP_UNLINKAT}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+        }
+        return true;
+    }
+
+    static void prepare(io_uring_sqe* sqe, const Op& op) {
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->fd = op.fd;
+        switch (op.kind) {
+        case Op::Open:
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uintptr_t>(op.path);
+            sqe->len = 0644;
+            sqe->open_flags = static_cast<uint32_t>(op.flags | O_CLOEXEC);
+            break;
+        case Op::Read:
+        case Op::Write:
+            sqe->opcode = op.kind == Op::Read ? IORING_OP_READ : IORING_OP_WRITE;
+            sqe->addr = reinterpret_cast<uintptr_t>(op.buf);
+            sqe->len = static_cast<uint32_t>(op.len);
+            sqe->off = static_cast<uint64_t>(-1); // the file position, as read() and write() use
+            break;
+        case Op::Fsync:
+            sqe->opcode = IORING_OP_FSYNC;
+            break;
+        case Op::Close:
+            sqe->opcode = IORING_OP_CLOSE;
+            break;
+        case Op::Rename:
+            sqe->opcode = IORING_OP_RENAMEAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uintptr_t>(op.path);
+            sqe->len = static_cast<uint32_t>(AT_FDCWD);
+            sqe->addr2 = reinterpret_cast<uintptr_t>(op.path2);
+            break;
+        case Op::Unlink:
+            sqe->opcode = IORING_OP_UNLINKAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<uintptr_t>(op.path);
+            break;
+        }
+        if (op.link) sqe->flags |= IOSQE_IO_LINK;
+    }
+
+    // Submits ops in ring-sized chunks, never splitting a chain, and waits
+    // for each chunk. False if the ring itself failed.
+    bool run(std::vector<Op>& ops, std::vector<int>& results) {
+        for (size_t begin = 0; begin < ops.size();) {
+            size_t end = begin, chunk = begin;
+            while (end < ops.size() && end - begin < entries) {
+                if (!ops[end++].link) chunk = end;
+            }
+            if (chunk == begin) chunk = end;
+            unsigned tail = *sq_tail;
+            for (size_t i = begin; i < chunk; ++i, ++tail) {
+                unsigned slot = tail & *sq_mask;
+                prepare(&sqes[slot], ops[i]);
+                sqes[slot].user_data = i;
+                sq_array[slot] = slot;
+            }
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+            unsigned pending = static_cast<unsigned>(chunk - begin);
+            unsigned to_submit = pending;
+            while (pending > 0) {
+                long entered = ::syscall(__NR_io_uring_enter, fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (entered < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) return false;
+                if (entered > 0) to_submit -= static_cast<unsigned>(entered);
+                unsigned head = *cq_head;
+                for (; head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE); ++head, --pending) {
+                    const io_uring_cqe& cqe = cqes[head & *cq_mask];
+                    results[cqe.user_data] = cqe.res;
+                }
+                __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            }
+            begin = chunk;
+        }
+        return true;
+    }
+};
+
+#else
+
+struct BatchIo::Ring {
+    bool setup(unsigned) { return false; }
+    bool run(std::vector<Op>&, std::vector<int>&) { return false; }
+};
+
+#endif
+
+BatchIo::BatchIo(unsigned depth) : ring(std::make_unique<Ring>()) {
+    if (depth == 0 || !ring->setup(depth)) ring.reset();
+}
+
+BatchIo::~BatchIo() = default;
+
+bool BatchIo::usingIoUring() const { return ring != nullptr; }
+
+void BatchIo::run(std::vector<Op>& ops, std::vector<int>& results) {
+    results.assign(ops.size(), -ECANCELED);
+    if (ops.empty()) return;
+    if (ring) {
+        // Ops the kernel already took are not run again; a broken ring is
+        // dropped and later batches run directly.
+        if (!ring->run(ops, results)) ring.reset();
+        return;
+    }
+    bool cancel = false;
+    for (size_t i = 0; i < ops.size(); ++i) {
+        const Op& op = ops[i];
+        int result = -ECANCELED;
+        if (!cancel) {
+            switch (op.kind) {
+            case Op::Open: result = ::open(op.path, op.flags | O_CLOEXEC, 0644); break;
+            case Op::Read: result = static_cast<int>(::read(op.fd, op.buf, op.len)); break;
+            case Op::Write: result = static_cast<int>(::write(op.fd, op.buf, op.len)); break;
+            case Op::Fsync: result = ::fsync(op.fd); break;
+            case Op::Close: result = ::close(op.fd); break;
+            case Op::Rename: result = ::rename(op.path, op.path2); break;
+            case Op::Unlink: result = ::unlink(op.path); break;
+            }
+            if (result < 0) result = -errno;
+        }
+        results[i] = result;
+        cancel = op.link && op.breaksChain(result);
+    }
+}
+
+void BatchIo::rename(const std::vector<std::pair<std::string, std::string>>& moves, std::vector<int>& errors) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Op> ops;
+    ops.reserve(moves.size());
+    for (const auto& move : moves) {
+        ops.push_back(Op{Op::Rename});
+        ops.back().path = move.first.c_str();
+        ops.back().path2 = move.second.c_str();
+    }
+    std::vector<int> results;
+    run(ops, results);
+    errors.assign(moves.size(), 0);
+    for (size_t i = 0; i < moves.size(); ++i) errors[i] = results[i] < 0 ? -results[i] : 0;
+}
+
+void BatchIo::read(const std::vector<std::string>& paths, std::vector<std::string>& contents, std::vector<int>& errors) {
+    std::lock_guard<std::mutex> lock(mutex);
+    errors.assign(paths.size(), 0);
+    contents.assign(paths.size(), std::string());
+    // Open all, read all, close all: a short read would cancel a linked close.
+    std::vector<Op> ops;
+    std::vector<int> opened, results;
+    for (const auto& path : paths) {
+        ops.push_back(Op{Op::Open});
+        ops.back().path = path.c_str();
+        ops.back().flags = O_RDONLY;
+    }
+    run(ops, opened);
+    ops.clear();
+    std::vector<size_t> items;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (opened[i] < 0) {
+            errors[i] = -opened[i];
+            continue;
+        }
+        contents[i].resize(kReadChunk);
+        ops.push_back(Op{Op::Read});
+        ops.back().fd = opened[i];
+        ops.back().buf = &contents[i][0];
+        ops.back().len = kReadChunk;
+        items.push_back(i);
+    }
+    run(ops, results);
+    std::vector<Op> closes;
+    for (size_t k = 0; k < items.size(); ++k) {
+        size_t i = items[k];
+        if (results[k] < 0) {
+            errors[i] = -results[k];
+            contents[i].clear();
+        } else {
+            contents[i].resize(static_cast<size_t>(results[k]));
+            // Longer than one chunk: read the rest directly.
+            char buffer[kReadChunk];
+            ssize_t n;
+            while (results[k] == static_cast<int>(kReadChunk) && (n = ::pread(opened[i], buffer, sizeof(buffer), static_cast<off_t>(contents[i].size()))) != 0) {
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) {
+                    errors[i] = errno;
+                    break;
+                }
+                contents[i].append(buffer, static_cast<size_t>(n));
+            }
+        }
+        closes.push_back(Op{Op::Close});
+        closes.back().fd = opened[i];
+    }
+    run(closes, results);
+}
+
+void BatchIo::write(const std::vector<Write>& writes, std::vector<int>& errors) {
+    std::lock_guard<std::mutex> lock(mutex);
+    errors.assign(writes.size(), 0);
+    std::vector<Op> ops;
+    std::vector<int> opened, results;
+    for (const auto& write : writes) {
+        ops.push_back(Op{Op::Open});
+        ops.back().path = write.path.c_str();
+        ops.back().flags = O_WRONLY | O_CREAT | O_TRUNC;
+    }
+    run(ops, opened);
+    // One chain per file: write -> fsync -> close -> rename -> unlinks.
+    ops.clear();
+    std::vector<std::pair<size_t, size_t>> chains; // item, first op
+    for (size_t i = 0; i < writes.size(); ++i) {
+        if (opened[i] < 0) {
+            errors[i] = -opened[i];
+            continue;
+        }
+        chains.emplace_back(i, ops.size());
+        const Write& write = writes[i];
+        ops.push_back(Op{Op::Write});
+        ops.back().fd = opened[i];
+        ops.back().buf = const_cast<char*>(write.content.data());
+        ops.back().len = write.content.size();
+        if (write.sync) {
+            ops.push_back(Op{Op::Fsync});
+            ops.back().fd = opened[i];
+        }
+        ops.push_back(Op{Op::Close});
+        ops.back().fd = opened[i];
+        if (!write.rename_to.empty()) {
+            ops.push_back(Op{Op::Rename});
+            ops.back().path = write.path.c_str();
+            ops.back().path2 = write.rename_to.c_str();
+        }
+        for (const auto& path : write.unlink) {
+            ops.push_back(Op{Op::Unlink});
+            ops.back().path = path.c_str();
+        }
+        for (size_t k = chains.back().second; k + 1 < ops.size(); ++k) ops[k].link = true;
+    }
+    run(ops, results);
+    for (size_t c = 0; c < chains.size(); ++c) {
+        size_t i = chains[c].first;
+        size_t first = chains[c].second;
+        size_t last = c + 1 < chains.size() ? chains[c + 1].second : ops.size();
+        for (size_t k = first; k < last; ++k) {
+            if (ops[k].kind == Op::Close && results[k] == -ECANCELED) ::close(opened[i]); // the write or fsync failed
+        }
+        for (size_t k = first; k < last && errors[i] == 0; ++k) {
+            if (ops[k].kind != Op::Unlink && ops[k].failed(results[k])) errors[i] = results[k] < 0 ? -results[k] : EIO;
+        }
+    }
+}
+
+void BatchIo::unlink(const std::vector<std::string>& paths, std::vector<int>& errors) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Op> ops;
+    ops.reserve(paths.size());
+    for (const auto& path : paths) {
+        ops.push_back(Op{Op::Unlink});
+        ops.back().path = path.c_str();
+    }
+    std::vector<int> results;
+    run(ops, results);
+    errors.assign(paths.size(), 0);
+    for (size_t i = 0; i < paths.size(); ++i) errors[i] = results[i] < 0 ? -results[i] : 0;
+}
+
+void BatchIo::syncDirectories(const std::vector<std::string>& dirs, std::vector<int>& errors) {
+    std::lock_guard<std::mutex> lock(mutex);
+    errors.assign(dirs.size(), 0);
+    std::vector<Op> ops;
+    std::vector<int> opened, results;
+    for (const auto& dir : dirs) {
+        ops.push_back(Op{Op::Open});
+        ops.back().path = dir.c_str();
+        ops.back().flags = O_RDONLY | O_DIRECTORY;
+    }
+    run(ops, opened);
+    ops.clear();
+    std::vector<size_t> items;
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        if (opened[i] < 0) {
+            errors[i] = -opened[i];
+            continue;
+        }
+        items.push_back(i);
+        ops.push_back(Op{Op::Fsync});
+        ops.back().fd = opened[i];
+        ops.back().link = true;
+        ops.push_back(Op{Op::Close});
+        ops.back().fd = opened[i];
+    }
+    run(ops, results);
+    for (size_t k = 0; k < items.size(); ++k) {
+        size_t i = items[k];
+        if (results[2 * k] < 0) errors[i] = -results[2 * k];
+        if (results[2 * k + 1] == -ECANCELED) ::close(opened[i]);
+    }
+}
+
+void BatchIo::syncFilesystems(const std::vector<std::string>& dirs, std::vector<int>& errors) {
+    std::lock_guard<std::mutex> lock(mutex);
+    errors.assign(dirs.size(), 0);
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        int fd = ::open(dirs[i].c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) {
+            errors[i] = errno;
+            continue;
+        }
+#ifdef __linux__
+        if (::syncfs(fd) != 0) errors[i] = errno;
+#else
+        errors[i] = ENOSYS; // sync() makes no completion guarantee
+#endif
+        ::close(fd);
+    }
+}
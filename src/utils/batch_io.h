@@ -0,0 +1,64 @@
+#ifndef BATCH_IO_H
+#define BATCH_IO_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Runs the same small file operation on many files with a few syscalls. On
+// Linux with io_uring (5.11 or later, for renameat and unlinkat) each step of
+// a batch is one submission for all files, and the steps that follow a write
+// are linked: a failed write, fsync or close cancels the rest of its chain,
+// while a failed rename or unlink does not. Elsewhere, or if the ring cannot
+// be set up (old kernel, seccomp), the same operations run one syscall at a
+// time with the same results. Errors are 0 or the first errno of each item.
+// Batches are serialized, so threads may share one object.
+class BatchIo {
+public:
+    // depth: ring entries; 0 always uses plain syscalls.
+    explicit BatchIo(unsigned depth = 256);
+    ~BatchIo();
+    BatchIo(const BatchIo&) = delete;
+    BatchIo& operator=(const BatchIo&) = delete;
+
+    bool usingIoUring() const;
+
+    // Renames each first to second; ENOENT if another process moved it first.
+    void rename(const std::vector<std::pair<std::string, std::string>>& moves, std::vector<int>& errors);
+    // Reads each whole file.
+    void read(const std::vector<std::string>& paths, std::vector<std::string>& contents, std::vector<int>& errors);
+
+    struct Write {
+        std::string path;
+        std::string content;
+        std::string rename_to;           // if set, path is renamed here once written
+        std::vector<std::string> unlink; // then removed in order; best effort, not reported
+        bool sync = false;               // fsync before closing
+    };
+    // Creates or truncates each path and chains write, fsync, close, rename
+    // and unlinks.
+    void write(const std::vector<Write>& writes, std::vector<int>& errors);
+    void unlink(const std::vector<std::string>& paths, std::vector<int>& errors);
+    // fsyncs each directory, making the renames and creations in it durable.
+    void syncDirectories(const std::vector<std::string>& dirs, std::vector<int>& errors);
+    // syncfs on the filesystem holding each directory: one flush of every
+    // file and directory written there, including other processes' writes,
+    // instead of an fsync per file. Linux only (ENOSYS elsewhere), and only
+    // from 5.8 does it report writeback errors. Plain syscalls; io_uring
+    // has no syncfs.
+    void syncFilesystems(const std::vector<std::string>& dirs, std::vector<int>& errors);
+
+private:
+    struct Op;
+    struct Ring;
+
+    // Results are >= 0 or -errno; a step after a failed linked one gets -ECANCELED.
+    void run(std::vector<Op>& ops, std::vector<int>& results);
+
+    std::mutex mutex;
+    std::unique_ptr<Ring> ring;
+};
+
+#endif // BATCH_IO_H
@@ -0,0 +1,165 @@
+#include "cache.h"
+#include <functional>
+
+namespace {
+size_t perShardCapacity(size_t capacity, size_t shard_count) {
+    size_t per_shard = capacity / shard_count;
+    return per_shard == 0 ? 1 : per_shard;
+}
+}
+
+CalculationCache::CalculationCache(size_t capacity, std::chrono::seconds default_ttl, size_t shard_count)
+    : ttl_sec(default_ttl.count()), max_dependencies(4 * capacity) {
+    if (shard_count == 0) shard_count = 1;
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards.push_back(std::make_unique<Shard>());
+        shards.back()->capacity = perShardCapacity(capacity, shard_count);
+    }
+}
+
+CalculationCache::Shard& CalculationCache::shardFor(const std::string& key) {
+    return *shards[std::hash<std::string>{}(key) % shards.size()];
+}
+
+std::vector<std::pair<std::string, uint64_t>> CalculationCache::stampDependencies(const std::vector<std::string>& depends_on) const {
+    std::vector<std::pair<std::string, uint64_t>> stamped;
+    if (depends_on.empty()) return stamped;
+    stamped.reserve(depends_on.size());
+    std::lock_guard<std::mutex> lock(dependency_mutex);
+    for (const auto& dependency : depends_on) {
+        auto it = dependency_versions.find(dependency);
+        stamped.emplace_back(dependency, it == dependency_versions.end() ? dependency_floor : it->second);
+    }
+    return stamped;
+}
+
+bool CalculationCache::dependenciesCurrent(const Entry& entry) const {
+    if (entry.depends_on.empty()) return true;
+    std::lock_guard<std::mutex> lock(dependency_mutex);
+    for (const auto& [dependency, stamped] : entry.depends_on) {
+        auto it = dependency_versions.find(dependency);
+        if ((it == dependency_versions.end() ? dependency_floor : it->second) != stamped) return false;
+    }
+    return true;
+}
+
+bool CalculationCache::get(const std::string& key, std::string& value) {
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        misses++;
+        return false;
+    }
+    const Entry& entry = *it->second;
+    if (entry.version != version() || !dependenciesCurrent(entry)) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        invalidations++;
+        misses++;
+        return false;
+    }
+    if (std::chrono::steady_clock::now() >= entry.expires_at) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        expirations++;
+        misses++;
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    value = entry.value;
+    hits++;
+    return true;
+}
+
+void CalculationCache::put(const std::string& key, const std::string& value, const std::vector<std::string>& depends_on) {
+    put(key, value, std::chrono::seconds(ttl_sec.load(std::memory_order_relaxed)), depends_on);
+}
+
+void CalculationCache::put(const std::string& key, const std::string& value, std::chrono::seconds entry_ttl,
+                           const std::vector<std::string>& depends_on) {
+    Shard& shard = shardFor(key);
+    auto expires_at = std::chrono::steady_clock::now() + entry_ttl;
+    auto stamped = stampDependencies(depends_on);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        it->second->value = value;
+        it->second->expires_at = expires_at;
+        it->second->version = version();
+        it->second->depends_on = std::move(stamped);
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+    while (shard.lru.size() >= shard.capacity) {
+        shard.index.erase(shard.lru.back().key);
+        shard.lru.pop_back();
+        evictions++;
+    }
+    shard.lru.push_front(Entry{key, value, expires_at, version(), std::move(stamped)});
+    shard.index[key] = shard.lru.begin();
+}
+
+void CalculationCache::erase(const std::string& key) {
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+}
+
+void CalculationCache::invalidate(const std::string& dependency) {
+    std::lock_guard<std::mutex> lock(dependency_mutex);
+    if (dependency_versions.size() >= max_dependencies) {
+        dependency_versions.clear();
+        dependency_floor = ++dependency_clock;
+    }
+    dependency_versions[dependency] = ++dependency_clock;
+}
+
+void CalculationCache::invalidateAll() {
+    current_version.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void CalculationCache::clear() {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->lru.clear();
+        shard->index.clear();
+    }
+}
+
+void CalculationCache::reconfigure(size_t capacity, std::chrono::seconds default_ttl) {
+    clear();
+    ttl_sec.store(default_ttl.count(), std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(dependency_mutex);
+        max_dependencies = 4 * capacity;
+    }
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->capacity = perShardCapacity(capacity, shards.size());
+    }
+}
+
+size_t CalculationCache::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->lru.size();
+    }
+    return total;
+}
+
+CacheStats CalculationCache::stats() const {
+    CacheStats s;
+    s.hits = hits.load();
+    s.misses = misses.load();
+    s.evictions = evictions.load();
+    s.expirations = expirations.load();
+    s.invalidations = invalidations.load();
+    s.size = size();
+    return s;
+}
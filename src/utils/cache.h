@@ -0,0 +1,85 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Snapshot of cache counters
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t expirations = 0;
+    uint64_t invalidations = 0;
+    size_t size = 0;
+};
+
+// Sharded, bounded LRU cache with per-entry TTL and version-stamped invalidation.
+// An entry records the versions of the dependency keys it was computed from;
+// invalidate(dependency) stales only the entries naming that key, while
+// invalidateAll() stales everything. Stale entries are treated as misses and
+// dropped lazily.
+class CalculationCache {
+public:
+    explicit CalculationCache(size_t capacity = 1024, std::chrono::seconds default_ttl = std::chrono::seconds(300), size_t shard_count = 8);
+
+    bool get(const std::string& key, std::string& value);
+    void put(const std::string& key, const std::string& value, const std::vector<std::string>& depends_on = {});
+    void put(const std::string& key, const std::string& value, std::chrono::seconds ttl,
+             const std::vector<std::string>& depends_on = {});
+    void erase(const std::string& key);
+    void invalidate(const std::string& dependency);
+    void invalidateAll();
+    void clear();
+    void reconfigure(size_t capacity, std::chrono::seconds default_ttl);
+
+    uint64_t version() const { return current_version.load(std::memory_order_acquire); }
+    size_t size() const;
+    CacheStats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::string value;
+        std::chrono::steady_clock::time_point expires_at;
+        uint64_t version;
+        std::vector<std::pair<std::string, uint64_t>> depends_on;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru; // most recently used at the front
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t capacity = 0;
+    };
+
+    Shard& shardFor(const std::string& key);
+    std::vector<std::pair<std::string, uint64_t>> stampDependencies(const std::vector<std::string>& depends_on) const;
+    bool dependenciesCurrent(const Entry& entry) const;
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<std::chrono::seconds::rep> ttl_sec;
+    std::atomic<uint64_t> current_version{0};
+    // Versions of invalidated dependency keys; the others read as dependency_floor.
+    // Past max_dependencies keys the map is dropped and the floor raised, which
+    // stales every entry with dependencies at once but keeps the map bounded.
+    mutable std::mutex dependency_mutex;
+    std::unordered_map<std::string, uint64_t> dependency_versions;
+    uint64_t dependency_clock = 0;
+    uint64_t dependency_floor = 0;
+    size_t max_dependencies = 0;
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> evictions{0};
+    std::atomic<uint64_t> expirations{0};
+    std::atomic<uint64_t> invalidations{0};
+};
+
+#endif // CACHE_H
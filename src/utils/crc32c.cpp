@@ -0,0 +1,79 @@
+#include "crc32c.h"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define QUANTALISTA_CRC32_HW 1
+#endif
+
+namespace {
+
+constexpr uint32_t kPolynomial = 0x82F63B78; // reflected Castagnoli
+
+using SliceTables = std::array<std::array<uint32_t, 256>, 8>;
+
+constexpr SliceTables makeTables() {
+    SliceTables t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (kPolynomial & (0u - (c & 1)));
+        t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+    }
+    return t;
+}
+
+constexpr SliceTables kTables = makeTables();
+
+uint32_t crcSoftware(const unsigned char* p, size_t n, uint32_t c) {
+    while (n >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        word ^= c;
+        c = kTables[7][word & 0xFF] ^ kTables[6][(word >> 8) & 0xFF] ^ kTables[5][(word >> 16) & 0xFF] ^
+            kTables[4][(word >> 24) & 0xFF] ^ kTables[3][(word >> 32) & 0xFF] ^ kTables[2][(word >> 40) & 0xFF] ^
+            kTables[1][(word >> 48) & 0xFF] ^ kTables[0][word >> 56];
+        p += 8;
+        n -= 8;
+    }
+    while (n--) c = (c >> 8) ^ kTables[0][(c ^ *p++) & 0xFF];
+    return c;
+}
+
+#ifdef QUANTALISTA_CRC32_HW
+__attribute__((target("sse4.2"))) uint32_t crcHardware(const unsigned char* p, size_t n, uint32_t c) {
+    uint64_t c64 = c;
+    while (n >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        c64 = _mm_crc32_u64(c64, word);
+        p += 8;
+        n -= 8;
+    }
+    c = static_cast<uint32_t>(c64);
+    while (n--) c = _mm_crc32_u8(c, *p++);
+    return c;
+}
+#endif
+
+} // namespace
+
+bool crc32cHardware() {
+#ifdef QUANTALISTA_CRC32_HW
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+uint32_t crc32c(const void* data, size_t n, uint32_t crc) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+#ifdef QUANTALISTA_CRC32_HW
+    if (crc32cHardware()) return ~crcHardware(p, n, ~crc);
+#endif
+    return ~crcSoftware(p, n, ~crc);
+}
@@ -0,0 +1,14 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli), the checksum used by the on-disk formats. Uses the
+// SSE4.2 crc32 instruction when the CPU has it (picked at runtime) and a
+// slicing-by-8 table otherwise. Chain calls by passing the previous result:
+// crc32c(b, nb, crc32c(a, na)) == crc32c(a followed by b).
+uint32_t crc32c(const void* data, size_t n, uint32_t crc = 0);
+bool crc32cHardware();
+
+#endif // CRC32C_H
@@ -0,0 +1,69 @@
+#include "dir_watcher.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+DirectoryWatcher::DirectoryWatcher(const std::string& directory, std::chrono::milliseconds interval) : poll_interval(interval) {
+    if (::pipe(stop_pipe) == 0) {
+        for (int fd : stop_pipe) ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        ::fcntl(stop_pipe[1], F_SETFL, O_NONBLOCK);
+    }
+#ifdef __linux__
+    inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd >= 0 && ::inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR) < 0) {
+        ::close(inotify_fd);
+        inotify_fd = -1;
+    }
+    if (inotify_fd >= 0) events.resize(64 * 1024);
+#else
+    (void)directory;
+#endif
+}
+
+DirectoryWatcher::~DirectoryWatcher() {
+    if (inotify_fd >= 0) ::close(inotify_fd);
+    for (int fd : stop_pipe) if (fd >= 0) ::close(fd);
+}
+
+void DirectoryWatcher::stop() {
+    char byte = 1;
+    if (stop_pipe[1] >= 0) (void)!::write(stop_pipe[1], &byte, 1);
+}
+
+DirectoryWatcher::Wake DirectoryWatcher::wait(std::vector<std::string>& names, std::chrono::milliseconds timeout) {
+    pollfd fds[2] = {{stop_pipe[0], POLLIN, 0}, {inotify_fd, POLLIN, 0}};
+    bool polling = inotify_fd < 0;
+    if (polling && (timeout.count() < 0 || poll_interval < timeout)) timeout = poll_interval;
+    int wait_ms = static_cast<int>(timeout.count());
+    for (;;) {
+        int ready = ::poll(fds, inotify_fd >= 0 ? 2 : 1, wait_ms);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0) return Wake::Rescan;
+        if (fds[0].revents) return Wake::Stopped;
+        if (ready == 0) return polling ? Wake::Rescan : Wake::Timeout;
+        break;
+    }
+#ifdef __linux__
+    // Drain everything queued, so a burst of files costs one wakeup.
+    bool overflowed = false;
+    for (;;) {
+        ssize_t n = ::read(inotify_fd, events.data(), events.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        for (ssize_t pos = 0; pos < n;) {
+            inotify_event event;
+            std::memcpy(&event, events.data() + pos, sizeof(event));
+            if (event.mask & IN_Q_OVERFLOW) overflowed = true;
+            else if (event.len > 0 && !(event.mask & IN_ISDIR)) names.emplace_back(events.data() + pos + sizeof(event));
+            pos += sizeof(event) + event.len;
+        }
+    }
+    if (overflowed) return Wake::Rescan;
+#endif
+    return Wake::Files;
+}
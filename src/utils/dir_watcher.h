@@ -0,0 +1,42 @@
+#ifndef DIR_WATCHER_H
+#define DIR_WATCHER_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Reports files that appear in one directory. On Linux this is inotify
+// (IN_CLOSE_WRITE and IN_MOVED_TO, so a file is reported once its writer
+// closes it or it is renamed in) and an idle directory costs no CPU.
+// Elsewhere, or if inotify cannot be set up, every wait times out after at
+// most poll_interval and asks the caller to rescan.
+class DirectoryWatcher {
+public:
+    enum class Wake {
+        Files,   // names were appended
+        Rescan,  // events may have been missed; list the directory
+        Timeout, // nothing happened within the timeout
+        Stopped  // stop() was called
+    };
+
+    explicit DirectoryWatcher(const std::string& directory, std::chrono::milliseconds poll_interval = std::chrono::seconds(1));
+    ~DirectoryWatcher();
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    bool usingInotify() const { return inotify_fd >= 0; }
+    // Blocks until one of the Wake cases. Names are relative to the directory.
+    // A negative timeout waits indefinitely.
+    Wake wait(std::vector<std::string>& names, std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+    // Wakes a blocked wait, now and for every later call. Safe from any
+    // thread and from a signal handler.
+    void stop();
+
+private:
+    int inotify_fd = -1;
+    int stop_pipe[2] = {-1, -1};
+    std::chrono::milliseconds poll_interval;
+    std::vector<char> events;
+};
+
+#endif // DIR_WATCHER_H
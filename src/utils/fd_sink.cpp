@@ -0,0 +1,92 @@
+#include "fd_sink.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+FdSink::FdSink(int descriptor, bool owns_fd, size_t buffer_size) : fd(descriptor), owned(owns_fd), buffer(buffer_size, '\0') {}
+
+FdSink::~FdSink() { close(); }
+
+bool FdSink::open(const std::string& path, size_t buffer_size) {
+    close();
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = errno;
+        return false;
+    }
+    owned = true;
+    buffer.assign(buffer_size, '\0');
+    used = 0;
+    written = 0;
+    error = 0;
+    return true;
+}
+
+bool FdSink::writeAll(const char* data, size_t n) {
+    while (n > 0) {
+        ssize_t w = ::write(fd, data, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            error = errno;
+            return false;
+        }
+        data += w;
+        n -= static_cast<size_t>(w);
+        written += static_cast<size_t>(w);
+    }
+    return true;
+}
+
+void FdSink::write(const char* data, size_t n) {
+    if (fd < 0 || error != 0) return;
+    if (used + n <= buffer.size()) {
+        std::memcpy(&buffer[used], data, n);
+        used += n;
+        return;
+    }
+    if (!flush()) return;
+    if (n >= buffer.size()) {
+        writeAll(data, n);
+    } else {
+        std::memcpy(&buffer[0], data, n);
+        used = n;
+    }
+}
+
+bool FdSink::flush() {
+    if (fd < 0 || error != 0) return error == 0;
+    bool ok_now = writeAll(buffer.data(), used);
+    used = 0;
+    return ok_now;
+}
+
+bool FdSink::close(bool fsync_on_close) {
+    if (fd < 0) return error == 0;
+    flush();
+    if (fsync_on_close && error == 0 && ::fsync(fd) != 0) error = errno;
+    if (owned && ::close(fd) != 0 && error == 0) error = errno;
+    fd = -1;
+    owned = false;
+    return error == 0;
+}
+
+bool replaceFile(const std::string& path, bool durable, const std::function<bool(FdSink&)>& fill, std::string& error) {
+    std::string tmp = path + ".tmp";
+    FdSink sink;
+    bool ok = sink.open(tmp) && fill(sink);
+    if (!sink.close(durable) || !ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        error = "cannot write " + path + ": " + std::strerror(sink.lastError() ? sink.lastError() : errno);
+        std::remove(tmp.c_str());
+        return false;
+    }
+    if (!durable) return true;
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    bool synced = fd >= 0 && ::fsync(fd) == 0;
+    if (!synced) error = "cannot sync the directory of " + path + ": " + std::strerror(errno);
+    if (fd >= 0) ::close(fd);
+    return synced;
+}
@@ -0,0 +1,54 @@
+#ifndef FD_SINK_H
+#define FD_SINK_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Buffered writer over a raw file descriptor. Small writes are collected into
+// a fixed buffer; writes at least as large as the buffer go straight to the fd.
+// The first failed write latches an error (errno) and later writes are ignored.
+class FdSink {
+public:
+    static constexpr size_t kDefaultBufferSize = 64 * 1024;
+
+    FdSink() = default;
+    // Writes to an already open descriptor (e.g. STDOUT_FILENO); closed only if owned.
+    explicit FdSink(int fd, bool owns_fd = false, size_t buffer_size = kDefaultBufferSize);
+    ~FdSink();
+    FdSink(const FdSink&) = delete;
+    FdSink& operator=(const FdSink&) = delete;
+
+    // Creates or truncates path.
+    bool open(const std::string& path, size_t buffer_size = kDefaultBufferSize);
+    void write(const char* data, size_t n);
+    void write(std::string_view data) { write(data.data(), data.size()); }
+    bool flush();
+    // Flushes, optionally fsyncs, and closes an owned descriptor. Returns false
+    // if any write, the fsync or the close failed.
+    bool close(bool fsync_on_close = false);
+
+    bool is_open() const { return fd >= 0; }
+    bool ok() const { return error == 0; }
+    int lastError() const { return error; }
+    size_t bytesWritten() const { return written; }
+
+private:
+    bool writeAll(const char* data, size_t n);
+
+    int fd = -1;
+    bool owned = false;
+    std::string buffer;
+    size_t used = 0;
+    size_t written = 0;
+    int error = 0;
+};
+
+// Writes path.tmp through fill and renames it over path, so path holds either
+// the old contents or all of the new. durable: fsync the file before the
+// rename and the directory after it. On failure the tmp file is removed and
+// error says why.
+bool replaceFile(const std::string& path, bool durable, const std::function<bool(FdSink&)>& fill, std::string& error);
+
+#endif // FD_SINK_H
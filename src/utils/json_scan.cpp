@@ -0,0 +1,263 @@
+#include "json_scan.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QUANTALISTA_X86 1
+#endif
+
+namespace {
+
+struct BlockMasks {
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t op = 0; // { } [ ] : ,
+};
+
+inline __attribute__((always_inline)) void classifyScalar(const char* p, BlockMasks& m) {
+    uint64_t quote = 0, backslash = 0, op = 0;
+    for (int i = 0; i < 64; ++i) {
+        char c = p[i];
+        uint64_t bit = 1ULL << i;
+        if (c == '"') quote |= bit;
+        else if (c == '\\') backslash |= bit;
+        else if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') op |= bit;
+    }
+    m.quote = quote;
+    m.backslash = backslash;
+    m.op = op;
+}
+
+#ifdef QUANTALISTA_X86
+// '[' | 0x20 == '{' and ']' | 0x20 == '}', so four compares cover all six operators.
+inline __attribute__((always_inline, target("sse4.2"))) void classifySse42(const char* p, BlockMasks& m) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    uint64_t q = 0, b = 0, o = 0;
+    for (int k = 0; k < 4; ++k) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+        __m128i folded = _mm_or_si128(v, lower);
+        __m128i ops = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+        int shift = 16 * k;
+        q |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << shift;
+        b |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << shift;
+        o |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(ops))) << shift;
+    }
+    m.quote = q;
+    m.backslash = b;
+    m.op = o;
+}
+
+inline __attribute__((always_inline, target("avx2"))) void classifyAvx2(const char* p, BlockMasks& m) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    const __m256i open = _mm256_set1_epi8('{');
+    const __m256i close = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    uint64_t q = 0, b = 0, o = 0;
+    for (int k = 0; k < 2; ++k) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * k));
+        __m256i folded = _mm256_or_si256(v, lower);
+        __m256i ops = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)));
+        int shift = 32 * k;
+        q |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)))) << shift;
+        b |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)))) << shift;
+        o |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(ops))) << shift;
+    }
+    m.quote = q;
+    m.backslash = b;
+    m.op = o;
+}
+#endif
+
+// Characters preceded by an odd-length run of backslashes, i.e. escaped ones.
+// Runs may span blocks; prev_odd carries whether the last block ended inside one.
+inline __attribute__((always_inline)) uint64_t escapedCharacters(uint64_t backslash, uint64_t& prev_odd) {
+    const uint64_t even_bits = 0x5555555555555555ULL;
+    const uint64_t odd_bits = ~even_bits;
+    uint64_t start_edges = backslash & ~(backslash << 1);
+    uint64_t even_start_mask = even_bits ^ prev_odd;
+    uint64_t even_starts = start_edges & even_start_mask;
+    uint64_t odd_starts = start_edges & ~even_start_mask;
+    uint64_t even_carries = backslash + even_starts;
+    uint64_t odd_carries;
+    bool ends_odd = __builtin_add_overflow(backslash, odd_starts, &odd_carries);
+    odd_carries |= prev_odd;
+    prev_odd = ends_odd ? 1 : 0;
+    uint64_t even_carry_ends = even_carries & ~backslash;
+    uint64_t odd_carry_ends = odd_carries & ~backslash;
+    return (even_carry_ends & odd_bits) | (odd_carry_ends & even_bits);
+}
+
+// Bit i set when an odd number of bits 0..i are set.
+inline __attribute__((always_inline)) uint64_t prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Turns one block's character masks into structural offsets appended at out
+// (relative to the window); returns how many were written. Always inlined into
+// the per-kernel loops below, so popcnt/tzcnt compile to native instructions
+// wherever the wrapper's target allows it.
+inline __attribute__((always_inline)) size_t indexBlock(const BlockMasks& m, uint32_t offset, ScanCarry& carry, uint32_t* out) {
+    uint64_t quotes = m.quote & ~escapedCharacters(m.backslash, carry.prev_odd_backslash);
+    uint64_t in_string = prefixXor(quotes) ^ carry.prev_in_string;
+    carry.prev_in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+    // Backslashes inside strings are indexed too, so a reader can tell a clean
+    // string (next entry is its closing quote) from one that needs unescaping.
+    uint64_t structurals = (m.op & ~in_string) | quotes | (m.backslash & in_string);
+    // Flatten eight bits per step without a data-dependent branch per bit; slots
+    // past the popcount are scratch (the window keeps spare entries for them).
+    size_t bits = static_cast<size_t>(__builtin_popcountll(structurals));
+    auto emit8 = [&](uint32_t* dst) {
+        for (int j = 0; j < 8; ++j) {
+            dst[j] = offset + static_cast<uint32_t>(__builtin_ctzll(structurals | (1ULL << 63)));
+            structurals &= structurals - 1;
+        }
+    };
+    emit8(out);
+    if (bits > 8) {
+        emit8(out + 8);
+        for (size_t i = 16; i < bits; i += 8) emit8(out + i);
+    }
+    return bits;
+}
+
+// Index nblocks full 64-byte blocks starting at data (window offset `offset`).
+size_t scanBlocksScalar(const char* data, size_t nblocks, uint32_t offset, ScanCarry& carry, uint32_t* out) {
+    size_t count = 0;
+    for (size_t b = 0; b < nblocks; ++b, data += 64, offset += 64) {
+        BlockMasks m;
+        classifyScalar(data, m);
+        count += indexBlock(m, offset, carry, out + count);
+    }
+    return count;
+}
+
+#ifdef QUANTALISTA_X86
+__attribute__((target("sse4.2,popcnt"))) size_t scanBlocksSse42(const char* data, size_t nblocks, uint32_t offset,
+                                                                 ScanCarry& carry, uint32_t* out) {
+    size_t count = 0;
+    for (size_t b = 0; b < nblocks; ++b, data += 64, offset += 64) {
+        BlockMasks m;
+        classifySse42(data, m);
+        count += indexBlock(m, offset, carry, out + count);
+    }
+    return count;
+}
+
+__attribute__((target("avx2,bmi,popcnt"))) size_t scanBlocksAvx2(const char* data, size_t nblocks, uint32_t offset,
+                                                                  ScanCarry& carry, uint32_t* out) {
+    size_t count = 0;
+    for (size_t b = 0; b < nblocks; ++b, data += 64, offset += 64) {
+        BlockMasks m;
+        classifyAvx2(data, m);
+        count += indexBlock(m, offset, carry, out + count);
+    }
+    return count;
+}
+#endif
+
+std::atomic<int> selected_kernel{-1};
+
+} // namespace
+
+const char* scanKernelName(ScanKernel kernel) {
+    switch (kernel) {
+        case ScanKernel::SCALAR: return "scalar";
+        case ScanKernel::SSE42: return "sse4.2";
+        case ScanKernel::AVX2: return "avx2";
+    }
+    return "scalar";
+}
+
+bool scanKernelSupported(ScanKernel kernel) {
+#ifdef QUANTALISTA_X86
+    if (kernel == ScanKernel::AVX2) return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("popcnt");
+    if (kernel == ScanKernel::SSE42) return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+#endif
+    return kernel == ScanKernel::SCALAR;
+}
+
+ScanKernel bestScanKernel() {
+    static const ScanKernel best = scanKernelSupported(ScanKernel::AVX2)    ? ScanKernel::AVX2
+                                   : scanKernelSupported(ScanKernel::SSE42) ? ScanKernel::SSE42
+                                                                            : ScanKernel::SCALAR;
+    return best;
+}
+
+ScanKernel activeScanKernel() {
+    int k = selected_kernel.load(std::memory_order_relaxed);
+    return k < 0 ? bestScanKernel() : static_cast<ScanKernel>(k);
+}
+
+void setScanKernel(ScanKernel kernel) {
+    if (!scanKernelSupported(kernel)) kernel = bestScanKernel();
+    selected_kernel.store(static_cast<int>(kernel), std::memory_order_relaxed);
+}
+
+// --- StructuralScanner ---
+
+StructuralScanner::StructuralScanner(std::string_view input, ScanKernel k) : in(input), window(kWindowBlocks * 64 + 64) {
+    if (!scanKernelSupported(k)) k = ScanKernel::SCALAR;
+    switch (k) {
+#ifdef QUANTALISTA_X86
+        case ScanKernel::AVX2: scan_blocks = scanBlocksAvx2; break;
+        case ScanKernel::SSE42: scan_blocks = scanBlocksSse42; break;
+#endif
+        default: scan_blocks = scanBlocksScalar; break;
+    }
+}
+
+bool StructuralScanner::scanWindow() {
+    if (scanned >= in.size()) return false;
+    window_base = scanned;
+    cursor = 0;
+    size_t full_blocks = std::min(kWindowBlocks, (in.size() - scanned) / 64);
+    count = scan_blocks(in.data() + scanned, full_blocks, 0, carry, window.data());
+    scanned += full_blocks * 64;
+    if (full_blocks < kWindowBlocks && scanned < in.size()) {
+        // Pad the tail with spaces, which are never structural.
+        char tail[64];
+        std::memset(tail, ' ', sizeof(tail));
+        std::memcpy(tail, in.data() + scanned, in.size() - scanned);
+        count += scan_blocks(tail, 1, static_cast<uint32_t>(full_blocks * 64), carry, window.data() + count);
+        scanned = in.size();
+    }
+    return true;
+}
+
+size_t StructuralScanner::nextSlow(size_t from) {
+    while (scanWindow()) {
+        for (; cursor < count; ++cursor) {
+            if (window_base + window[cursor] >= from) return window_base + window[cursor];
+        }
+    }
+    return npos;
+}
+
+void find_structurals(std::string_view input, std::vector<size_t>& positions, ScanKernel kernel) {
+    positions.clear();
+    StructuralScanner scanner(input, kernel);
+    while (scanner.scanWindow()) {
+        size_t old = positions.size();
+        positions.resize(old + scanner.count);
+        for (size_t i = 0; i < scanner.count; ++i) positions[old + i] = scanner.window_base + scanner.window[i];
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Stage 1 of bulk JSON parsing: locate structural characters ({ } [ ] : , and
+// the quotes delimiting strings) in 64-byte blocks, skipping anything inside
+// strings and escaped quotes. Backslashes inside strings are reported as well,
+// so stage 2 knows which strings need unescaping without rescanning them. Classification uses AVX2 or SSE4.2 when the CPU
+// has them (picked at runtime) and a portable scalar kernel otherwise; the
+// escape and in-string logic is branch-free bit arithmetic shared by all kernels.
+
+enum class ScanKernel {
+    SCALAR,
+    SSE42,
+    AVX2
+};
+
+const char* scanKernelName(ScanKernel kernel);
+bool scanKernelSupported(ScanKernel kernel);
+ScanKernel bestScanKernel();
+// Kernel used by new scanners; defaults to bestScanKernel(). Unsupported requests fall back.
+ScanKernel activeScanKernel();
+void setScanKernel(ScanKernel kernel);
+
+// Escape and string state carried from one 64-byte block to the next.
+struct ScanCarry {
+    uint64_t prev_odd_backslash = 0; // previous block ended inside an odd backslash run
+    uint64_t prev_in_string = 0;     // all ones while a string spans blocks
+};
+
+// Incremental structural index over an input, produced one window at a time so
+// memory stays bounded on large documents.
+class StructuralScanner {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    explicit StructuralScanner(std::string_view input, ScanKernel kernel = activeScanKernel());
+
+    // First structural position >= from, or npos. Calls must use non-decreasing from.
+    size_t next(size_t from) {
+        while (cursor < count) {
+            size_t p = window_base + window[cursor];
+            if (p >= from) return p;
+            ++cursor;
+        }
+        return nextSlow(from);
+    }
+
+private:
+    friend void find_structurals(std::string_view input, std::vector<size_t>& positions, ScanKernel kernel);
+    static constexpr size_t kWindowBlocks = 256; // 16 KiB of input per refill
+
+    size_t nextSlow(size_t from);
+    bool scanWindow();
+
+    std::string_view in;
+    size_t (*scan_blocks)(const char*, size_t, uint32_t, ScanCarry&, uint32_t*) = nullptr;
+    size_t scanned = 0; // bytes classified so far
+    ScanCarry carry;
+    std::vector<uint32_t> window; // offsets from window_base for the current refill, plus write slack
+    size_t window_base = 0;
+    size_t count = 0;
+    size_t cursor = 0;
+};
+
+// Whole-document structural index (benchmarks and tests).
+void find_structurals(std::string_view input, std::vector<size_t>& positions, ScanKernel kernel = activeScanKernel());
+
+#endif // JSON_SCAN_H
@@ -1,6 +1,13 @@
 #include "json_utils.h"
+#include "tracing.h"
+#include "fd_sink.h"
+#include "json_scan.h"
 #include <sstream>
 #include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 
 std::string extract_string(const std::string& json_string, const std::string& key) {
@@ -47,151 +54,641 @@ std::vector<std::string> extract_string_vector(const std::string& json_string, c
     return result;
 }
 
-Task from_json(const std::string& json_string) {
-    Task task;
-    task.task_id = extract_string(json_string, "task_id");
-    task.description = extract_string(json_string, "description");
-    task.priority = extract_string(json_string, "priority");
-    task.dependencies = extract_string_vector(json_string, "dependencies");
-    task.component = extract_string(json_string, "component");
-    task.max_runtime_sec = extract_int(json_string, "max_runtime_sec");
-
-    task.date = extract_string(json_string, "date");
-    task.time = extract_string(json_string, "time");
-    task.platform = extract_string(json_string, "platform");
-    task.service = extract_string(json_string, "service");
-    task.confirmed = (json_string.find("\"confirmed\": true") != std::string::npos);
-    task.overlapping_task_ids = extract_string_vector(json_string, "overlapping_task_ids");
-    task.first_name = extract_string(json_string, "first_name");
-    task.last_name = extract_string(json_string, "last_name");
-    task.contact_info = extract_string(json_string, "contact_info");
-    task.anonymous_id = extract_string(json_string, "anonymous_id");
-    task.labels = extract_string_vector(json_string, "labels");
-    task.due_date = extract_string(json_string, "due_date");
-    task.estimated_effort = extract_int(json_string, "estimated_effort");
-    task.actual_effort = extract_int(json_string, "actual_effort");
-    task.blocked_by_note = extract_string(json_string, "blocked_by_note");
-    task.owner = extract_string(json_string, "owner");
-    task.watchers = extract_string_vector(json_string, "watchers");
-    task.archived = (json_string.find("\"archived\": true") != std::string::npos);
-    task.sequence_number = extract_int(json_string, "sequence_number");
-    task.cancellation_reason = extract_string(json_string, "cancellation_reason");
-    task.creation_time = extract_string(json_string, "creation_time");
+namespace {
 
-    return task;
+struct TaskField {
+    enum Kind { STRING, INT, BOOL, STRING_LIST } kind;
+    std::string_view name;
+    std::string Task::*str = nullptr;
+    int Task::*num = nullptr;
+    bool Task::*flag = nullptr;
+    std::vector<std::string> Task::*list = nullptr;
+};
+
+TaskField stringField(std::string_view name, std::string Task::*m) { return {TaskField::STRING, name, m, nullptr, nullptr, nullptr}; }
+TaskField intField(std::string_view name, int Task::*m) { return {TaskField::INT, name, nullptr, m, nullptr, nullptr}; }
+TaskField boolField(std::string_view name, bool Task::*m) { return {TaskField::BOOL, name, nullptr, nullptr, m, nullptr}; }
+TaskField listField(std::string_view name, std::vector<std::string> Task::*m) { return {TaskField::STRING_LIST, name, nullptr, nullptr, nullptr, m}; }
+
+// Listed in to_json order so documents we wrote resolve each key on the first probe.
+const std::vector<TaskField>& taskFields() {
+    static const std::vector<TaskField> fields = {
+        stringField("task_id", &Task::task_id),
+        stringField("description", &Task::description),
+        stringField("priority", &Task::priority),
+        listField("dependencies", &Task::dependencies),
+        stringField("component", &Task::component),
+        intField("max_runtime_sec", &Task::max_runtime_sec),
+        stringField("date", &Task::date),
+        stringField("time", &Task::time),
+        stringField("platform", &Task::platform),
+        stringField("service", &Task::service),
+        boolField("confirmed", &Task::confirmed),
+        listField("overlapping_task_ids", &Task::overlapping_task_ids),
+        stringField("first_name", &Task::first_name),
+        stringField("last_name", &Task::last_name),
+        stringField("contact_info", &Task::contact_info),
+        stringField("anonymous_id", &Task::anonymous_id),
+        listField("labels", &Task::labels),
+        stringField("due_date", &Task::due_date),
+        intField("estimated_effort", &Task::estimated_effort),
+        intField("actual_effort", &Task::actual_effort),
+        stringField("blocked_by_note", &Task::blocked_by_note),
+        stringField("owner", &Task::owner),
+        listField("watchers", &Task::watchers),
+        boolField("archived", &Task::archived),
+        intField("sequence_number", &Task::sequence_number),
+        stringField("cancellation_reason", &Task::cancellation_reason),
+        stringField("creation_time", &Task::creation_time),
+    };
+    return fields;
 }
 
-std::string to_json(const Task& task) {
-    std::string json_string = "{";
-    json_string += "\"task_id\": \"" + task.task_id + "\",";
-    json_string += "\"description\": \"" + task.description + "\",";
-    json_string += "\"priority\": \"" + task.priority + "\",";
-    json_string += "\"dependencies\": [";
-    for (size_t i = 0; i < task.dependencies.size(); ++i) {
-        json_string += "\"" + task.dependencies[i] + "\"";
-        if (i < task.dependencies.size() - 1) {
-            json_string += ",";
+void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Recursive-descent reader that walks the input once without copying it.
+// With a StructuralScanner attached (bulk documents), string ends come from the
+// stage 1 index instead of a byte-by-byte search.
+class JsonReader {
+public:
+    JsonReader(std::string_view input, JsonParseError& err, StructuralScanner* structurals = nullptr)
+        : in(input), error(err), scanner(structurals) {}
+
+    size_t position() const { return pos; }
+
+    void skipWhitespace() {
+        while (pos < in.size() && (in[pos] == ' ' || in[pos] == '\n' || in[pos] == '\t' || in[pos] == '\r')) ++pos;
+    }
+
+    bool fail(const std::string& message) {
+        error.position = pos;
+        error.message = message;
+        return false;
+    }
+
+    bool consume(char c) {
+        skipWhitespace();
+        if (pos < in.size() && in[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool expect(char c) {
+        if (consume(c)) return true;
+        return fail(std::string("expected '") + c + "'");
+    }
+
+    bool peek(char c) {
+        skipWhitespace();
+        return pos < in.size() && in[pos] == c;
+    }
+
+    // Reads a string token. Clean strings are a single view into the input;
+    // escaped strings are decoded into scratch.
+    bool readString(std::string_view& out, std::string& scratch) {
+        if (!expect('"')) return false;
+        size_t start = pos;
+        if (scanner) {
+            // The next index entry is the closing quote, or a backslash if the string has escapes.
+            size_t end = scanner->next(start);
+            if (end != StructuralScanner::npos && in[end] == '"') {
+                out = in.substr(start, end - start);
+                pos = end + 1;
+                return true;
+            }
+        }
+        while (pos < in.size() && in[pos] != '"' && in[pos] != '\\') ++pos;
+        if (pos >= in.size()) return fail("unterminated string");
+        if (in[pos] == '"') {
+            out = in.substr(start, pos - start);
+            ++pos;
+            return true;
+        }
+        scratch.assign(in.data() + start, pos - start);
+        while (pos < in.size()) {
+            char c = in[pos++];
+            if (c == '"') {
+                out = scratch;
+                return true;
+            }
+            if (c != '\\') {
+                scratch += c;
+                continue;
+            }
+            if (pos >= in.size()) break;
+            char e = in[pos++];
+            switch (e) {
+                case '"': scratch += '"'; break;
+                case '\\': scratch += '\\'; break;
+                case '/': scratch += '/'; break;
+                case 'b': scratch += '\b'; break;
+                case 'f': scratch += '\f'; break;
+                case 'n': scratch += '\n'; break;
+                case 'r': scratch += '\r'; break;
+                case 't': scratch += '\t'; break;
+                case 'u': {
+                    uint32_t cp = 0;
+                    if (!readHex4(cp)) return false;
+                    if (cp >= 0xD800 && cp <= 0xDBFF && pos + 1 < in.size() && in[pos] == '\\' && in[pos + 1] == 'u') {
+                        pos += 2;
+                        uint32_t low = 0;
+                        if (!readHex4(low)) return false;
+                        if (low < 0xDC00 || low > 0xDFFF) {
+                            pos -= 6;
+                            return fail("invalid surrogate pair");
+                        }
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+                        cp = 0xFFFD; // an unpaired surrogate has no UTF-8 encoding
+                    }
+                    appendUtf8(scratch, cp);
+                    break;
+                }
+                default:
+                    --pos;
+                    return fail("invalid escape sequence");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool readString(std::string& out) {
+        std::string_view view;
+        if (!readString(view, scratch)) return false;
+        out.assign(view.data(), view.size());
+        return true;
+    }
+
+    bool readInt(int& out) {
+        skipWhitespace();
+        size_t start = pos;
+        bool negative = pos < in.size() && in[pos] == '-';
+        if (negative) ++pos;
+        const long long limit = negative ? -static_cast<long long>(INT_MIN) : INT_MAX;
+        long long value = 0;
+        bool any = false;
+        while (pos < in.size() && in[pos] >= '0' && in[pos] <= '9') {
+            value = value * 10 + (in[pos] - '0');
+            if (value > limit) {
+                pos = start;
+                return fail("integer out of range");
+            }
+            ++pos;
+            any = true;
+        }
+        if (!any) {
+            pos = start;
+            return fail("expected integer");
         }
+        // tolerate a fractional/exponent part by truncating it
+        while (pos < in.size() && (in[pos] == '.' || in[pos] == 'e' || in[pos] == 'E' || in[pos] == '+' || in[pos] == '-' || (in[pos] >= '0' && in[pos] <= '9'))) ++pos;
+        out = static_cast<int>(negative ? -value : value);
+        return true;
     }
-    json_string += "],";
-    json_string += "\"component\": \"" + task.component + "\",";
-    json_string += "\"max_runtime_sec\": " + std::to_string(task.max_runtime_sec) + ",";
-
-    json_string += "\"date\": \"" + task.date + "\",";
-    json_string += "\"time\": \"" + task.time + "\",";
-    json_string += "\"platform\": \"" + task.platform + "\",";
-    json_string += "\"service\": \"" + task.service + "\",";
-    json_string += "\"confirmed\": " + std::string(task.confirmed ? "true" : "false") + ",";
-    json_string += "\"overlapping_task_ids\": [";
-    for (size_t i = 0; i < task.overlapping_task_ids.size(); ++i) {
-        json_string += "\"" + task.overlapping_task_ids[i] + "\"";
-        if (i < task.overlapping_task_ids.size() - 1) {
-            json_string += ",";
+
+    bool readBool(bool& out) {
+        skipWhitespace();
+        if (in.substr(pos, 4) == "true") {
+            pos += 4;
+            out = true;
+            return true;
+        }
+        if (in.substr(pos, 5) == "false") {
+            pos += 5;
+            out = false;
+            return true;
         }
+        return fail("expected boolean");
+    }
+
+    bool readStringList(std::vector<std::string>& out) {
+        out.clear();
+        if (!expect('[')) return false;
+        if (consume(']')) return true;
+        do {
+            out.emplace_back();
+            if (!readString(out.back())) return false;
+        } while (consume(','));
+        return expect(']');
     }
-    json_string += "],";
-    json_string += "\"first_name\": \"" + task.first_name + "\",";
-    json_string += "\"last_name\": \"" + task.last_name + "\",";
-    json_string += "\"contact_info\": \"" + task.contact_info + "\",";
-    json_string += "\"anonymous_id\": \"" + task.anonymous_id + "\",";
-    json_string += "\"labels\": [";
-    for (size_t i = 0; i < task.labels.size(); ++i) {
-        json_string += "\"" + task.labels[i] + "\"";
-        if (i < task.labels.size() - 1) {
-            json_string += ",";
+
+    bool skipValue() {
+        skipWhitespace();
+        if (pos >= in.size()) return fail("unexpected end of input");
+        char c = in[pos];
+        if (c == '"') {
+            std::string_view ignored;
+            return readString(ignored, scratch);
+        }
+        if (c == '{' || c == '[') {
+            char close = c == '{' ? '}' : ']';
+            ++pos;
+            if (consume(close)) return true;
+            do {
+                if (c == '{') {
+                    std::string_view key;
+                    if (!readString(key, scratch) || !expect(':')) return false;
+                }
+                if (!skipValue()) return false;
+            } while (consume(','));
+            return expect(close);
         }
+        size_t start = pos;
+        while (pos < in.size() && in[pos] != ',' && in[pos] != '}' && in[pos] != ']' && in[pos] != ' ' && in[pos] != '\n' && in[pos] != '\r' && in[pos] != '\t') ++pos;
+        if (pos == start) return fail("expected value");
+        return true;
+    }
+
+    bool readTask(Task& task) {
+        const auto& fields = taskFields();
+        if (!expect('{')) return false;
+        if (consume('}')) return true;
+        size_t hint = 0;
+        std::string key_scratch;
+        do {
+            std::string_view key;
+            if (!readString(key, key_scratch)) return false;
+            if (!expect(':')) return false;
+            const TaskField* field = nullptr;
+            for (size_t probe = 0; probe < fields.size(); ++probe) {
+                size_t idx = (hint + probe) % fields.size();
+                if (fields[idx].name == key) {
+                    field = &fields[idx];
+                    hint = idx + 1;
+                    break;
+                }
+            }
+            if (!field) {
+                if (!skipValue()) return false;
+                continue;
+            }
+            bool ok = false;
+            switch (field->kind) {
+                case TaskField::STRING: ok = readString(task.*(field->str)); break;
+                case TaskField::INT: ok = readInt(task.*(field->num)); break;
+                case TaskField::BOOL: ok = readBool(task.*(field->flag)); break;
+                case TaskField::STRING_LIST: ok = readStringList(task.*(field->list)); break;
+            }
+            if (!ok) return false;
+        } while (consume(','));
+        return expect('}');
+    }
+
+    bool readSchedule(Schedule& schedule) {
+        if (!expect('{')) return false;
+        if (consume('}')) return true;
+        std::string key_scratch;
+        do {
+            std::string_view key;
+            if (!readString(key, key_scratch)) return false;
+            if (!expect(':')) return false;
+            bool ok;
+            if (key == "schedule_id") {
+                ok = readString(schedule.schedule_id);
+            } else if (key == "name") {
+                ok = readString(schedule.name);
+            } else if (key == "tasks") {
+                ok = expect('[');
+                if (ok && !consume(']')) {
+                    do {
+                        schedule.tasks.emplace_back();
+                        ok = readTask(schedule.tasks.back());
+                    } while (ok && consume(','));
+                    ok = ok && expect(']');
+                }
+            } else {
+                ok = skipValue();
+            }
+            if (!ok) return false;
+        } while (consume(','));
+        return expect('}');
     }
-    json_string += "],";
-    json_string += "\"due_date\": \"" + task.due_date + "\",";
-    json_string += "\"estimated_effort\": " + std::to_string(task.estimated_effort) + ",";
-    json_string += "\"actual_effort\": " + std::to_string(task.actual_effort) + ",";
-    json_string += "\"blocked_by_note\": \"" + task.blocked_by_note + "\",";
-    json_string += "\"owner\": \"" + task.owner + "\",";
-    json_string += "\"watchers\": [";
-    for (size_t i = 0; i < task.watchers.size(); ++i) {
-        json_string += "\"" + task.watchers[i] + "\"";
-        if (i < task.watchers.size() - 1) {
-            json_string += ",";
+
+private:
+    bool readHex4(uint32_t& out) {
+        if (pos + 4 > in.size()) return fail("truncated \\u escape");
+        out = 0;
+        for (int i = 0; i < 4; ++i) {
+            char h = in[pos++];
+            out <<= 4;
+            if (h >= '0' && h <= '9') out |= h - '0';
+            else if (h >= 'a' && h <= 'f') out |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F') out |= h - 'A' + 10;
+            else {
+                --pos;
+                return fail("invalid hex digit in \\u escape");
+            }
         }
+        return true;
     }
-    json_string += "],";
-    json_string += "\"archived\": " + std::string(task.archived ? "true" : "false") + ",";
-    json_string += "\"sequence_number\": " + std::to_string(task.sequence_number) + ",";
-    json_string += "\"cancellation_reason\": \"" + task.cancellation_reason + "\",";
-    json_string += "\"creation_time\": \"" + task.creation_time + "\"";
 
-    json_string += "}";
-    return json_string;
+    std::string_view in;
+    size_t pos = 0;
+    JsonParseError& error;
+    StructuralScanner* scanner;
+    std::string scratch;
+};
+
 }
 
-std::string to_json(const Schedule& schedule) {
-    std::string json_string = "{";
-    json_string += "\"name\": \"" + schedule.name + "\",";
-    json_string += "\"schedule_id\": \"" + schedule.schedule_id + "\",";
-    json_string += "\"tasks\": [";
-
-    std::vector<Task> sorted_tasks = schedule.tasks;
-    std::sort(sorted_tasks.begin(), sorted_tasks.end(), [](const Task& a, const Task& b) {
-        return a.task_id < b.task_id;
-    });
+bool parse_task(std::string_view json, Task& task, JsonParseError& error) {
+    JsonReader reader(json, error);
+    return reader.readTask(task);
+}
 
-    for (size_t i = 0; i < sorted_tasks.size(); ++i) {
-        json_string += to_json(sorted_tasks[i]);
-        if (i < sorted_tasks.size() - 1) {
-            json_string += ",";
+bool parse_schedule(std::string_view json, Schedule& schedule, JsonParseError& error) {
+    // Small documents, and any document without a SIMD kernel to index it,
+    // are cheaper to read directly.
+    constexpr size_t kIndexThreshold = 64 * 1024;
+    if (json.size() < kIndexThreshold || activeScanKernel() == ScanKernel::SCALAR) {
+        JsonReader reader(json, error);
+        return reader.readSchedule(schedule);
+    }
+    StructuralScanner scanner(json);
+    JsonReader reader(json, error, &scanner);
+    return reader.readSchedule(schedule);
+}
+
+Task from_json(const std::string& json_string) {
+    TraceSpan span("from_json");
+    Task task;
+    JsonParseError error;
+    parse_task(json_string, task, error);
+    span.tag(traceId(task));
+    return task;
+}
+
+// --- JsonWriter ---
+
+namespace {
+// 0: copy as is; otherwise the character after the backslash ('u' for \u00XX).
+struct EscapeTable {
+    char code[256] = {};
+    constexpr EscapeTable() {
+        for (int c = 0; c < 0x20; ++c) code[c] = 'u';
+        code[static_cast<int>('"')] = '"';
+        code[static_cast<int>('\\')] = '\\';
+        code[static_cast<int>('\b')] = 'b';
+        code[static_cast<int>('\f')] = 'f';
+        code[static_cast<int>('\n')] = 'n';
+        code[static_cast<int>('\r')] = 'r';
+        code[static_cast<int>('\t')] = 't';
+    }
+};
+constexpr EscapeTable kEscape;
+
+// True when any of the eight bytes in w is a control character, '"' or '\\'.
+inline bool needsEscape8(uint64_t w) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t high = 0x8080808080808080ULL;
+    auto has_zero = [&](uint64_t v) { return (v - ones) & ~v & high; };
+    return ((w - ones * 0x20) & ~w & high) || has_zero(w ^ (ones * '"')) || has_zero(w ^ (ones * '\\'));
+}
+
+// Writes the escaped form of s at dst (which has room for 6 * s.size() + 8); returns the new end.
+// Clean input is copied eight bytes at a time.
+char* escapeInto(char* dst, std::string_view s) {
+    static const char hex[] = "0123456789abcdef";
+    const char* src = s.data();
+    const char* end = src + s.size();
+    while (src < end) {
+        while (end - src >= 8) {
+            uint64_t w;
+            std::memcpy(&w, src, 8);
+            if (needsEscape8(w)) break;
+            std::memcpy(dst, &w, 8);
+            src += 8;
+            dst += 8;
+        }
+        if (src == end) break;
+        unsigned char c = static_cast<unsigned char>(*src++);
+        char code = kEscape.code[c];
+        if (code == 0) {
+            *dst++ = static_cast<char>(c);
+            continue;
         }
+        *dst++ = '\\';
+        *dst++ = code;
+        if (code == 'u') {
+            *dst++ = '0';
+            *dst++ = '0';
+            *dst++ = hex[c >> 4];
+            *dst++ = hex[c & 0xF];
+        }
+    }
+    return dst;
+}
+}
+
+void append_json_escaped(std::string& out, std::string_view s) {
+    size_t base = out.size();
+    out.resize(base + s.size() * 6 + 8);
+    char* end = escapeInto(&out[base], s);
+    out.resize(static_cast<size_t>(end - out.data()));
+}
+
+void JsonWriter::key(std::string_view name) {
+    separate();
+    char* dst = reserve(name.size() + 4);
+    writeKey(dst, name.data(), name.size());
+    length += name.size() + 4;
+    after_key = true;
+}
+
+void JsonWriter::value(std::string_view s) {
+    separate();
+    char* start = reserve(s.size() * 6 + 10);
+    char* dst = start;
+    *dst++ = '"';
+    dst = escapeInto(dst, s);
+    *dst++ = '"';
+    length += static_cast<size_t>(dst - start);
+}
+
+void JsonWriter::value(long long v) {
+    separate();
+    char* dst = reserve(24);
+    length += static_cast<size_t>(std::to_chars(dst, dst + 24, v).ptr - dst);
+}
+
+void JsonWriter::value(bool v) {
+    separate();
+    char* dst = reserve(5);
+    std::memcpy(dst, v ? "true" : "false", v ? 4 : 5);
+    length += v ? 4 : 5;
+}
+
+void JsonWriter::value(const std::vector<std::string>& list) {
+    beginArray();
+    for (const auto& item : list) value(std::string_view(item));
+    endArray();
+}
+
+namespace {
+// Cursor-level helpers for write_json(Task): the caller has reserved an upper
+// bound, so no capacity checks happen between fields.
+template <size_t N>
+inline char* putLiteral(char* p, const char (&text)[N]) {
+    std::memcpy(p, text, N - 1);
+    return p + N - 1;
+}
+
+inline char* putString(char* p, const std::string& s) {
+    *p++ = '"';
+    p = escapeInto(p, s);
+    *p++ = '"';
+    return p;
+}
+
+inline char* putList(char* p, const std::vector<std::string>& list) {
+    *p++ = '[';
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (i) *p++ = ',';
+        p = putString(p, list[i]);
     }
-    json_string += "]";
-    json_string += "}";
+    *p++ = ']';
+    return p;
+}
+
+inline char* putInt(char* p, int v) { return std::to_chars(p, p + 12, v).ptr; }
+
+inline char* putBool(char* p, bool v) { return v ? putLiteral(p, "true") : putLiteral(p, "false"); }
+
+inline size_t stringBound(const std::string& s) { return s.size() * 6 + 10; }
+
+inline size_t listBound(const std::vector<std::string>& list) {
+    size_t n = 2;
+    for (const auto& item : list) n += stringBound(item) + 1;
+    return n;
+}
+
+size_t taskJsonBound(const Task& t) {
+    size_t n = 768; // keys, punctuation and numbers
+    for (const std::string* s : {&t.task_id, &t.description, &t.priority, &t.component, &t.date, &t.time, &t.platform,
+                                 &t.service, &t.first_name, &t.last_name, &t.contact_info, &t.anonymous_id, &t.due_date,
+                                 &t.blocked_by_note, &t.owner, &t.cancellation_reason, &t.creation_time}) {
+        n += stringBound(*s);
+    }
+    return n + listBound(t.dependencies) + listBound(t.overlapping_task_ids) + listBound(t.labels) + listBound(t.watchers);
+}
+}
+
+void write_json(JsonWriter& w, const Task& task) {
+    char* p = w.beginRaw(taskJsonBound(task));
+    p = putString(putLiteral(p, "{\"task_id\": "), task.task_id);
+    p = putString(putLiteral(p, ",\"description\": "), task.description);
+    p = putString(putLiteral(p, ",\"priority\": "), task.priority);
+    p = putList(putLiteral(p, ",\"dependencies\": "), task.dependencies);
+    p = putString(putLiteral(p, ",\"component\": "), task.component);
+    p = putInt(putLiteral(p, ",\"max_runtime_sec\": "), task.max_runtime_sec);
+    p = putString(putLiteral(p, ",\"date\": "), task.date);
+    p = putString(putLiteral(p, ",\"time\": "), task.time);
+    p = putString(putLiteral(p, ",\"platform\": "), task.platform);
+    p = putString(putLiteral(p, ",\"service\": "), task.service);
+    p = putBool(putLiteral(p, ",\"confirmed\": "), task.confirmed);
+    p = putList(putLiteral(p, ",\"overlapping_task_ids\": "), task.overlapping_task_ids);
+    p = putString(putLiteral(p, ",\"first_name\": "), task.first_name);
+    p = putString(putLiteral(p, ",\"last_name\": "), task.last_name);
+    p = putString(putLiteral(p, ",\"contact_info\": "), task.contact_info);
+    p = putString(putLiteral(p, ",\"anonymous_id\": "), task.anonymous_id);
+    p = putList(putLiteral(p, ",\"labels\": "), task.labels);
+    p = putString(putLiteral(p, ",\"due_date\": "), task.due_date);
+    p = putInt(putLiteral(p, ",\"estimated_effort\": "), task.estimated_effort);
+    p = putInt(putLiteral(p, ",\"actual_effort\": "), task.actual_effort);
+    p = putString(putLiteral(p, ",\"blocked_by_note\": "), task.blocked_by_note);
+    p = putString(putLiteral(p, ",\"owner\": "), task.owner);
+    p = putList(putLiteral(p, ",\"watchers\": "), task.watchers);
+    p = putBool(putLiteral(p, ",\"archived\": "), task.archived);
+    p = putInt(putLiteral(p, ",\"sequence_number\": "), task.sequence_number);
+    p = putString(putLiteral(p, ",\"cancellation_reason\": "), task.cancellation_reason);
+    p = putString(putLiteral(p, ",\"creation_time\": "), task.creation_time);
+    *p++ = '}';
+    w.endRaw(p);
+}
+
+std::string to_json(const Task& task) {
+    // Serialize into a per-thread scratch buffer (already sized, so never
+    // re-zeroed) and return one exact-size copy.
+    thread_local std::string scratch;
+    JsonWriter writer(scratch);
+    writer.reset();
+    write_json(writer, task);
+    return std::string(scratch.data(), writer.size());
+}
+
+namespace {
+// Task indices ordered by task_id, so the tasks themselves are never copied.
+std::vector<size_t> taskIdOrder(const std::vector<Task>& tasks) {
+    std::vector<size_t> order(tasks.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return tasks[a].task_id < tasks[b].task_id; });
+    return order;
+}
+
+// Writes the schedule, calling drain() after each task so streaming callers
+// can hand off full chunks.
+template <typename Drain>
+void writeSchedule(JsonWriter& w, const Schedule& schedule, Drain drain) {
+    w.beginObject();
+    w.field("name", schedule.name);
+    w.field("schedule_id", schedule.schedule_id);
+    w.key("tasks");
+    w.beginArray();
+    for (size_t idx : taskIdOrder(schedule.tasks)) {
+        write_json(w, schedule.tasks[idx]);
+        drain();
+    }
+    w.endArray();
+    w.endObject();
+}
+}
+
+std::string to_json(const Schedule& schedule) {
+    std::string json_string;
+    JsonWriter w(json_string);
+    writeSchedule(w, schedule, [] {});
+    w.finish();
     return json_string;
 }
 
+bool write_json(const Schedule& schedule, FdSink& sink, size_t chunk_bytes) {
+    write_json(schedule, [&](std::string_view piece) { sink.write(piece); }, chunk_bytes);
+    return sink.ok();
+}
+
+void write_json(const Schedule& schedule, const std::function<void(std::string_view)>& drain, size_t chunk_bytes) {
+    std::string chunk;
+    JsonWriter w(chunk);
+    writeSchedule(w, schedule, [&] {
+        if (w.size() < chunk_bytes) return;
+        drain(std::string_view(chunk.data(), w.size()));
+        w.reset();
+    });
+    drain(std::string_view(chunk.data(), w.size()));
+}
+
 Schedule schedule_from_json(const std::string& json_string) {
     Schedule schedule;
-    schedule.schedule_id = extract_string(json_string, "schedule_id");
-    schedule.name = extract_string(json_string, "name");
-
-    std::string tasks_key = "\"tasks\": [";
-    size_t start = json_string.find(tasks_key);
-    if (start != std::string::npos) {
-        start += tasks_key.length();
-        int brace_count = 0;
-        size_t task_start = std::string::npos;
-        for (size_t i = start; i < json_string.length(); ++i) {
-            if (json_string[i] == '{') {
-                if (brace_count == 0) task_start = i;
-                brace_count++;
-            } else if (json_string[i] == '}') {
-                brace_count--;
-                if (brace_count == 0 && task_start != std::string::npos) {
-                    schedule.tasks.push_back(from_json(json_string.substr(task_start, i - task_start + 1)));
-                    task_start = std::string::npos;
-                }
-            } else if (json_string[i] == ']' && brace_count == 0) {
-                break;
-            }
-        }
-    }
+    JsonParseError error;
+    parse_schedule(json_string, schedule, error);
     return schedule;
 }
 
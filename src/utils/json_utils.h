@@ -1,10 +1,20 @@
 #ifndef JSON_UTILS_H
 #define JSON_UTILS_H
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "../models/models.h"
 
+// Position (byte offset into the input) and reason for a JSON parse failure
+struct JsonParseError {
+    size_t position = 0;
+    std::string message;
+};
+
 std::string extract_string(const std::string& json_string, const std::string& key);
 int extract_int(const std::string& json_string, const std::string& key);
 std::vector<std::string> extract_string_vector(const std::string& json_string, const std::string& key);
@@ -14,6 +24,91 @@ std::string to_json(const Task& task);
 std::string to_json(const Schedule& schedule);
 Schedule schedule_from_json(const std::string& json_string);
 
+// Single-pass parsers over a string_view. On failure the fields parsed so far
+// are kept and the error carries the offending byte offset.
+bool parse_task(std::string_view json, Task& task, JsonParseError& error);
+bool parse_schedule(std::string_view json, Schedule& schedule, JsonParseError& error);
+
+// Appends JSON into a caller-owned buffer. Space is reserved in bulk and
+// written through a raw cursor; strings are escaped with a table lookup (clean
+// runs are copied with memcpy) and integers are formatted with std::to_chars.
+// Commas between members and array elements are inserted automatically.
+// The buffer may hold slack past the cursor until finish() trims it.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& buffer) : out(buffer), length(buffer.size()) {}
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    void beginObject() { separate(); put('{'); first = true; }
+    void endObject() { put('}'); first = false; }
+    void beginArray() { separate(); put('['); first = true; }
+    void endArray() { put(']'); first = false; }
+    void key(std::string_view name);
+    // Literal keys: the copy length is a compile-time constant. Keys are never escaped.
+    template <size_t N>
+    void key(const char (&name)[N]) {
+        separate();
+        char* dst = reserve(N + 3);
+        writeKey(dst, name, N - 1);
+        length += N + 3;
+        after_key = true;
+    }
+    void value(std::string_view s);
+    void value(const char* s) { value(std::string_view(s)); }
+    void value(long long v);
+    void value(int v) { value(static_cast<long long>(v)); }
+    void value(bool v);
+    void value(const std::vector<std::string>& list);
+
+    template <size_t N, typename T>
+    void field(const char (&name)[N], const T& v) { key(name); value(v); }
+
+    // Raw access for hot serializers: reserve max_bytes for one complete value,
+    // write through the returned cursor, then hand back the end pointer.
+    char* beginRaw(size_t max_bytes) { separate(); return reserve(max_bytes); }
+    void endRaw(char* end) { length = static_cast<size_t>(end - out.data()); }
+
+    size_t size() const { return length; }
+    void finish() { out.resize(length); }
+    // Drops everything written so far (e.g. after a sink has consumed it).
+    void reset() { length = 0; }
+
+private:
+    char* reserve(size_t n) {
+        if (length + n > out.size()) out.resize(std::max(out.size() * 2, length + n + 256));
+        return &out[length];
+    }
+    void put(char c) { *reserve(1) = c; length++; }
+    static void writeKey(char* dst, const char* name, size_t n) {
+        dst[0] = '"';
+        std::memcpy(dst + 1, name, n);
+        dst[n + 1] = '"';
+        dst[n + 2] = ':';
+        dst[n + 3] = ' ';
+    }
+    void separate() {
+        if (!first && !after_key) put(',');
+        first = false;
+        after_key = false;
+    }
+
+    std::string& out;
+    size_t length;
+    bool first = true;
+    bool after_key = false;
+};
+
+class FdSink;
+
+void append_json_escaped(std::string& out, std::string_view s);
+void write_json(JsonWriter& writer, const Task& task);
+// Streams a schedule (tasks ordered by task_id) to the sink in chunk_bytes
+// pieces, so the whole document is never held in memory. False on a write error.
+bool write_json(const Schedule& schedule, FdSink& sink, size_t chunk_bytes = 64 * 1024);
+// Same stream handed to drain in chunk_bytes pieces (e.g. into a compressor).
+void write_json(const Schedule& schedule, const std::function<void(std::string_view)>& drain, size_t chunk_bytes = 64 * 1024);
+
 bool isValidPath(const std::string& path);
 
 #endif // JSON_UTILS_H
@@ -0,0 +1,117 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram() : buckets(kBucketCount, 0) {}
+
+size_t LatencyHistogram::bucketIndex(uint64_t micros) {
+    if (micros < static_cast<uint64_t>(kSubBucketCount)) return static_cast<size_t>(micros);
+    int magnitude = 63 - __builtin_clzll(micros);
+    if (magnitude > kMaxMagnitude) return kBucketCount - 1;
+    int shift = magnitude - kSubBucketBits + 1;
+    size_t sub = static_cast<size_t>(micros >> shift) - kSubBucketHalf;
+    return kSubBucketCount + static_cast<size_t>(magnitude - kSubBucketBits) * kSubBucketHalf + sub;
+}
+
+uint64_t LatencyHistogram::bucketMidpoint(size_t index) {
+    if (index < static_cast<size_t>(kSubBucketCount)) return index;
+    size_t offset = index - kSubBucketCount;
+    int magnitude = static_cast<int>(offset / kSubBucketHalf) + kSubBucketBits;
+    uint64_t sub = offset % kSubBucketHalf + kSubBucketHalf;
+    int shift = magnitude - kSubBucketBits + 1;
+    uint64_t low = sub << shift;
+    uint64_t width = uint64_t(1) << shift;
+    return low + width / 2;
+}
+
+void LatencyHistogram::record(double seconds) {
+    if (seconds < 0) seconds = 0;
+    uint64_t micros = static_cast<uint64_t>(std::llround(seconds * 1e6));
+    buckets[bucketIndex(micros)]++;
+    total_count++;
+    total_sum += seconds;
+    min_micros = std::min(min_micros, micros);
+    max_micros = std::max(max_micros, micros);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < buckets.size(); ++i) buckets[i] += other.buckets[i];
+    total_count += other.total_count;
+    total_sum += other.total_sum;
+    min_micros = std::min(min_micros, other.min_micros);
+    max_micros = std::max(max_micros, other.max_micros);
+}
+
+void LatencyHistogram::reset() {
+    std::fill(buckets.begin(), buckets.end(), 0);
+    total_count = 0;
+    total_sum = 0.0;
+    min_micros = UINT64_MAX;
+    max_micros = 0;
+}
+
+double LatencyHistogram::mean() const {
+    if (total_count == 0) return 0.0;
+    return total_sum / total_count;
+}
+
+double LatencyHistogram::min() const { return total_count == 0 ? 0.0 : min_micros / 1e6; }
+
+double LatencyHistogram::max() const { return max_micros / 1e6; }
+
+double LatencyHistogram::percentile(double q) const {
+    if (total_count == 0) return 0.0;
+    q = std::clamp(q, 0.0, 100.0);
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q / 100.0 * total_count));
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint64_t value = std::clamp(bucketMidpoint(i), min_micros, max_micros);
+            return value / 1e6;
+        }
+    }
+    return max();
+}
+
+// --- RollingWindow ---
+
+RollingWindow::RollingWindow(std::chrono::seconds window)
+    : slot_width(std::max<std::chrono::steady_clock::duration>(window / kSlotCount, std::chrono::milliseconds(1))) {}
+
+int64_t RollingWindow::epochOf(std::chrono::steady_clock::time_point now) const {
+    return now.time_since_epoch() / slot_width;
+}
+
+void RollingWindow::record(double value) { record(value, std::chrono::steady_clock::now()); }
+
+void RollingWindow::record(double value, std::chrono::steady_clock::time_point now) {
+    int64_t epoch = epochOf(now);
+    Slot& slot = slots[static_cast<size_t>(epoch) % kSlotCount];
+    if (slot.epoch != epoch) slot = Slot{epoch, 0.0, 0};
+    slot.sum += value;
+    slot.count++;
+}
+
+double RollingWindow::average() const { return average(std::chrono::steady_clock::now()); }
+
+double RollingWindow::average(std::chrono::steady_clock::time_point now) const {
+    int64_t oldest = epochOf(now) - static_cast<int64_t>(kSlotCount) + 1;
+    double sum = 0.0;
+    uint64_t n = 0;
+    for (const auto& slot : slots) {
+        if (slot.epoch >= oldest) {
+            sum += slot.sum;
+            n += slot.count;
+        }
+    }
+    return n == 0 ? 0.0 : sum / n;
+}
+
+uint64_t RollingWindow::count(std::chrono::steady_clock::time_point now) const {
+    int64_t oldest = epochOf(now) - static_cast<int64_t>(kSlotCount) + 1;
+    uint64_t n = 0;
+    for (const auto& slot : slots) if (slot.epoch >= oldest) n += slot.count;
+    return n;
+}
@@ -0,0 +1,69 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Log-linear (HDR-style) latency histogram with ~1.6% relative error.
+// Values are recorded in seconds and bucketed as microseconds; updates are O(1),
+// memory is fixed, and histograms can be merged across components/agents.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(double seconds);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t count() const { return total_count; }
+    double mean() const;
+    double min() const;
+    double max() const;
+    double percentile(double q) const; // q in [0, 100]
+
+private:
+    static constexpr int kSubBucketBits = 6;
+    static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+    static constexpr int kSubBucketHalf = kSubBucketCount / 2;
+    static constexpr int kMaxMagnitude = 40; // ~12.7 days in microseconds
+    static constexpr int kBucketCount = kSubBucketCount + (kMaxMagnitude - kSubBucketBits + 1) * kSubBucketHalf;
+
+    static size_t bucketIndex(uint64_t micros);
+    static uint64_t bucketMidpoint(size_t index);
+
+    std::vector<uint64_t> buckets;
+    uint64_t total_count = 0;
+    double total_sum = 0.0;
+    uint64_t min_micros = UINT64_MAX;
+    uint64_t max_micros = 0;
+};
+
+// Time-windowed running average over a ring of fixed-width slots.
+// Memory is constant regardless of how many samples are recorded.
+class RollingWindow {
+public:
+    explicit RollingWindow(std::chrono::seconds window = std::chrono::seconds(300));
+
+    void record(double value);
+    void record(double value, std::chrono::steady_clock::time_point now);
+    double average() const;
+    double average(std::chrono::steady_clock::time_point now) const;
+    uint64_t count(std::chrono::steady_clock::time_point now) const;
+
+private:
+    static constexpr size_t kSlotCount = 60;
+    struct Slot {
+        int64_t epoch = -1;
+        double sum = 0.0;
+        uint64_t count = 0;
+    };
+
+    int64_t epochOf(std::chrono::steady_clock::time_point now) const;
+
+    std::array<Slot, kSlotCount> slots;
+    std::chrono::steady_clock::duration slot_width;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,210 @@
+#include "logger.h"
+#include "json_utils.h"
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
+LogLevel parseLogLevel(const std::string& level) {
+    if (level == "DEBUG") return LogLevel::DEBUG;
+    if (level == "WARNING" || level == "WARN") return LogLevel::WARNING;
+    if (level == "ERROR") return LogLevel::ERROR;
+    return LogLevel::INFO;
+}
+
+const char* logLevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARNING: return "WARNING";
+        case LogLevel::ERROR: return "ERROR";
+    }
+    return "INFO";
+}
+
+std::string escapeJsonString(const std::string& s) {
+    std::string out;
+    out.reserve(s.size() + 8);
+    append_json_escaped(out, s);
+    return out;
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() : ring(new Slot[kRingSize]) {
+    for (size_t i = 0; i < kRingSize; ++i) ring[i].sequence.store(i, std::memory_order_relaxed);
+    writer = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger() {
+    running = false;
+    wakeWriter();
+    if (writer.joinable()) writer.join();
+}
+
+void Logger::configure(const LoggerConfig& config) {
+    flush();
+    std::lock_guard<std::mutex> lock(sink_mutex);
+    sink_config = config;
+    setLevel(config.min_level);
+    if (file.is_open()) file.close();
+    file_bytes = 0;
+    if (!config.file_path.empty()) {
+        file.open(config.file_path, std::ios::app);
+        std::error_code ec;
+        auto size = std::filesystem::file_size(config.file_path, ec);
+        if (!ec) file_bytes = static_cast<size_t>(size);
+    }
+}
+
+// Bounded MPMC ring (Vyukov): each slot's sequence tells producers and the
+// consumer whose turn it is, so no lock is taken on the logging path.
+bool Logger::tryPush(Record&& record) {
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = ring[pos & (kRingSize - 1)];
+        size_t seq = slot.sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.record = std::move(record);
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool Logger::tryPop(Record& record) {
+    Slot& slot = ring[dequeue_pos & (kRingSize - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) return false;
+    record = std::move(slot.record);
+    slot.sequence.store(dequeue_pos + kRingSize, std::memory_order_release);
+    dequeue_pos++;
+    return true;
+}
+
+void Logger::log(LogLevel level, const std::string& message) {
+    if (!shouldLog(level)) return;
+    Record record{level, std::chrono::system_clock::now(), message};
+    enqueued.fetch_add(1, std::memory_order_relaxed);
+    if (!tryPush(std::move(record))) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        written.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // Pairs with the fence in writerLoop: either the writer sees this record
+    // before it sleeps, or this sees it asleep. Only then is a lock taken.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writer_sleeping.load(std::memory_order_relaxed)) wakeWriter();
+}
+
+void Logger::wakeWriter() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        writer_sleeping.store(false, std::memory_order_relaxed);
+    }
+    wake.notify_one();
+}
+
+bool Logger::ringEmpty() const {
+    return ring[dequeue_pos & (kRingSize - 1)].sequence.load(std::memory_order_acquire) != dequeue_pos + 1;
+}
+
+void Logger::flush() {
+    uint64_t target = enqueued.load();
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    drained.wait(lock, [&] { return written.load() >= target; });
+}
+
+void Logger::formatRecord(const Record& record, std::string& out) {
+    std::time_t seconds = std::chrono::system_clock::to_time_t(record.timestamp);
+    if (seconds != cached_second) {
+        std::tm tm_buf{};
+        localtime_r(&seconds, &tm_buf);
+        char buf[32];
+        std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_buf);
+        cached_second = seconds;
+        cached_timestamp = buf;
+    }
+    out += "{\"timestamp\": \"";
+    out += cached_timestamp;
+    out += "\", \"level\": \"";
+    out += logLevelName(record.level);
+    out += "\", \"message\": \"";
+    append_json_escaped(out, record.message);
+    out += "\"}\n";
+}
+
+void Logger::rotateIfNeeded() {
+    if (!file.is_open() || file_bytes < sink_config.max_file_bytes) return;
+    file.close();
+    const std::string& base = sink_config.file_path;
+    std::error_code ec;
+    std::filesystem::remove(base + "." + std::to_string(sink_config.max_rotated_files), ec);
+    for (int i = sink_config.max_rotated_files - 1; i >= 1; --i) {
+        std::filesystem::rename(base + "." + std::to_string(i), base + "." + std::to_string(i + 1), ec);
+    }
+    if (sink_config.max_rotated_files > 0) std::filesystem::rename(base, base + ".1", ec);
+    else std::filesystem::remove(base, ec);
+    file.open(base, std::ios::trunc);
+    file_bytes = 0;
+}
+
+void Logger::writeBatch(const std::string& batch) {
+    std::lock_guard<std::mutex> lock(sink_mutex);
+    if (file.is_open()) {
+        file.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+        file.flush();
+        file_bytes += batch.size();
+        rotateIfNeeded();
+    } else {
+        std::ostream& console = sink_config.console_stderr ? std::cerr : std::cout;
+        console.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+        console.flush();
+    }
+}
+
+void Logger::writerLoop() {
+    std::string batch;
+    Record record;
+    for (;;) {
+        batch.clear();
+        uint64_t count = 0;
+        while (count < 1024 && tryPop(record)) {
+            formatRecord(record, batch);
+            count++;
+        }
+        uint64_t dropped_now = dropped.load(std::memory_order_relaxed);
+        if (dropped_now != reported_dropped) {
+            Record notice{LogLevel::WARNING, std::chrono::system_clock::now(),
+                          "Logger dropped " + std::to_string(dropped_now - reported_dropped) + " records (ring full)."};
+            formatRecord(notice, batch);
+            reported_dropped = dropped_now;
+        }
+        if (!batch.empty()) writeBatch(batch);
+        if (count > 0) {
+            written.fetch_add(count, std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(wake_mutex);
+            }
+            drained.notify_all();
+            continue;
+        }
+        if (!running && written.load() >= enqueued.load()) break;
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        writer_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ringEmpty() || !running) {
+            writer_sleeping.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        wake.wait(lock, [this] { return !writer_sleeping.load(std::memory_order_relaxed); });
+    }
+}
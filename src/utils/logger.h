@@ -0,0 +1,100 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class LogLevel {
+    DEBUG,
+    INFO,
+    WARNING,
+    ERROR
+};
+
+LogLevel parseLogLevel(const std::string& level);
+const char* logLevelName(LogLevel level);
+std::string escapeJsonString(const std::string& s);
+
+struct LoggerConfig {
+    LogLevel min_level = LogLevel::INFO;
+    std::string file_path;                      // empty: write to the console
+    bool console_stderr = false;                // console records go to stderr (stdout carries data)
+    size_t max_file_bytes = 64 * 1024 * 1024;   // rotate when the active file exceeds this
+    int max_rotated_files = 5;                  // keeps path.1 .. path.N
+};
+
+// Asynchronous structured (JSON lines) logger.
+// Producers push into a bounded lock-free ring; a background thread formats
+// and writes records in batches, so callers never block on terminal or disk I/O.
+// When the ring is full records are dropped and the drop count is reported.
+// An idle writer sleeps until a producer finds it asleep after a push, so
+// only the push that ends an idle spell takes a lock.
+class Logger {
+public:
+    static Logger& instance();
+    ~Logger();
+
+    void configure(const LoggerConfig& config);
+    void setLevel(LogLevel level) { min_level.store(level, std::memory_order_relaxed); }
+    bool shouldLog(LogLevel level) const { return level >= min_level.load(std::memory_order_relaxed); }
+
+    void log(LogLevel level, const std::string& message);
+    void flush(); // blocks until everything logged so far has been written
+    uint64_t droppedCount() const { return dropped.load(); }
+
+private:
+    struct Record {
+        LogLevel level = LogLevel::INFO;
+        std::chrono::system_clock::time_point timestamp;
+        std::string message;
+    };
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        Record record;
+    };
+
+    static constexpr size_t kRingSize = 8192; // power of two
+
+    Logger();
+    bool tryPush(Record&& record);
+    bool tryPop(Record& record);
+    bool ringEmpty() const; // writer thread only
+    void wakeWriter();
+    void writerLoop();
+    void formatRecord(const Record& record, std::string& out);
+    void writeBatch(const std::string& batch);
+    void rotateIfNeeded();
+
+    std::unique_ptr<Slot[]> ring;
+    std::atomic<size_t> enqueue_pos{0};
+    size_t dequeue_pos = 0; // writer thread only
+    std::atomic<LogLevel> min_level{LogLevel::INFO};
+    std::atomic<uint64_t> enqueued{0};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+    uint64_t reported_dropped = 0;
+
+    std::mutex sink_mutex; // guards the sink between configure() and the writer
+    LoggerConfig sink_config;
+    std::ofstream file;
+    size_t file_bytes = 0;
+
+    std::time_t cached_second = -1;
+    std::string cached_timestamp;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;    // the writer sleeps here while the ring is empty
+    std::condition_variable drained; // flush() waits here for written to catch up
+    std::atomic<bool> writer_sleeping{false};
+    std::atomic<bool> running{true};
+    std::thread writer;
+};
+
+#endif // LOGGER_H
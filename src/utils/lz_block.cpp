@@ -0,0 +1,134 @@
+#include "lz_block.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+constexpr int kHashLog = 14;
+constexpr size_t kMinMatch = 4;
+constexpr size_t kLastLiterals = 5;  // a block always ends with literals
+constexpr size_t kMatchSearchEnd = 12; // no match starts in the last 12 bytes
+constexpr size_t kMaxOffset = 65535;
+constexpr int kSkipTrigger = 6;      // misses before the search step grows
+
+uint32_t read32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t hash4(uint32_t v) { return (v * 2654435761u) >> (32 - kHashLog); }
+
+char* putLength(char* op, size_t length) {
+    for (; length >= 255; length -= 255) *op++ = static_cast<char>(255);
+    *op++ = static_cast<char>(length);
+    return op;
+}
+
+char* putLiterals(char* op, const char* literals, size_t n, uint8_t match_nibble) {
+    char* token = op++;
+    if (n >= 15) {
+        *token = static_cast<char>((15 << 4) | match_nibble);
+        op = putLength(op, n - 15);
+    } else {
+        *token = static_cast<char>((n << 4) | match_nibble);
+    }
+    std::memcpy(op, literals, n);
+    return op + n;
+}
+
+// Reads a 15+ length extension; false on running off the input.
+bool takeLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+    uint8_t b;
+    do {
+        if (ip >= end) return false;
+        b = *ip++;
+        length += b;
+    } while (b == 255);
+    return true;
+}
+
+} // namespace
+
+size_t lz_compress_block(const char* src, size_t n, char* dst) {
+    char* op = dst;
+    const char* anchor = src;
+    if (n > kMatchSearchEnd) {
+        // Positions are stored relative to src; zero-initialised entries point at
+        // src itself and are rejected by the compare like any other stale entry.
+        auto table = std::make_unique<uint32_t[]>(size_t(1) << kHashLog);
+        const char* ip = src + 1;
+        const char* const match_limit = src + n - kLastLiterals;
+        const char* const search_end = src + n - kMatchSearchEnd;
+        for (;;) {
+            const char* ref;
+            size_t misses = size_t(1) << kSkipTrigger;
+            for (;;) {
+                if (ip > search_end) goto last_literals;
+                uint32_t seq = read32(ip);
+                uint32_t& slot = table[hash4(seq)];
+                ref = src + slot;
+                slot = static_cast<uint32_t>(ip - src);
+                if (ref < ip && static_cast<size_t>(ip - ref) <= kMaxOffset && read32(ref) == seq) break;
+                ip += misses++ >> kSkipTrigger;
+            }
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+            const char* match_end = ip + kMinMatch;
+            const char* ref_end = ref + kMinMatch;
+            while (match_end < match_limit && *match_end == *ref_end) {
+                ++match_end;
+                ++ref_end;
+            }
+            size_t match_length = static_cast<size_t>(match_end - ip) - kMinMatch;
+            op = putLiterals(op, anchor, static_cast<size_t>(ip - anchor), match_length >= 15 ? 15 : static_cast<uint8_t>(match_length));
+            uint16_t offset = static_cast<uint16_t>(ip - ref);
+            std::memcpy(op, &offset, sizeof(offset));
+            op += sizeof(offset);
+            if (match_length >= 15) op = putLength(op, match_length - 15);
+            ip = anchor = match_end;
+            if (ip > search_end) break;
+            table[hash4(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - src);
+        }
+    }
+last_literals:
+    op = putLiterals(op, anchor, static_cast<size_t>(src + n - anchor), 0);
+    return static_cast<size_t>(op - dst);
+}
+
+bool lz_decompress_block(const char* src, size_t n, char* dst, size_t raw_size) {
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* const end = ip + n;
+    char* op = dst;
+    char* const out_end = dst + raw_size;
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !takeLength(ip, end, literals)) return false;
+        if (literals > static_cast<size_t>(end - ip) || literals > static_cast<size_t>(out_end - op)) return false;
+        std::memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == end) break; // the final sequence has no match
+        if (end - ip < 2) return false;
+        size_t offset = ip[0] | (size_t(ip[1]) << 8);
+        ip += 2;
+        size_t length = token & 15;
+        if (length == 15 && !takeLength(ip, end, length)) return false;
+        length += kMinMatch;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst) || length > static_cast<size_t>(out_end - op)) return false;
+        // An overlapping match repeats the last offset bytes; each copy doubles
+        // the distance back to ref, so runs take log(length) memcpys.
+        const char* ref = op - offset;
+        for (char* stop = op + length; op < stop;) {
+            size_t step = std::min(static_cast<size_t>(stop - op), static_cast<size_t>(op - ref));
+            std::memcpy(op, ref, step);
+            op += step;
+        }
+    }
+    return op == out_end;
+}
@@ -0,0 +1,24 @@
+#ifndef LZ_BLOCK_H
+#define LZ_BLOCK_H
+
+#include <cstddef>
+
+// LZ77 block codec in the LZ4 block format: each sequence is a token (literal
+// length, match length), the literals, a 16-bit match offset and length
+// extension bytes. Matches are found with a single-probe hash of 4-byte
+// sequences over a 64 KiB window, so compression is one forward pass and
+// decompression is copies only. Blocks are independent; framing, checksums
+// and threading live in storage/compressed_file.h.
+
+// Worst-case compressed size of n input bytes.
+constexpr size_t lz_compress_bound(size_t n) { return n + n / 255 + 16; }
+
+// Compresses n bytes into dst (at least lz_compress_bound(n) bytes) and
+// returns the compressed size.
+size_t lz_compress_block(const char* src, size_t n, char* dst);
+
+// Decompresses a whole block into exactly raw_size bytes at dst. False if the
+// block is malformed or does not decode to raw_size bytes.
+bool lz_decompress_block(const char* src, size_t n, char* dst, size_t raw_size);
+
+#endif // LZ_BLOCK_H
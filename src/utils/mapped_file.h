@@ -0,0 +1,32 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file. The view stays valid for the
+// lifetime of the object, so parsers can slice it without copying.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return opened; }
+    std::string_view view() const { return std::string_view(static_cast<const char*>(data), length); }
+    size_t size() const { return length; }
+
+private:
+    void* data = nullptr;
+    size_t length = 0;
+    bool opened = false;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,278 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+size_t metricShardIndex() {
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+namespace {
+void atomicAdd(std::atomic<double>& target, double delta) {
+    double current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+    }
+}
+
+std::string seriesName(const std::string& name, const std::string& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) return name;
+    std::string joined = labels;
+    if (!labels.empty() && !extra.empty()) joined += ",";
+    joined += extra;
+    return name + "{" + joined + "}";
+}
+
+std::string formatValue(double v) {
+    std::ostringstream oss;
+    oss << v;
+    return oss.str();
+}
+}
+
+// --- Counter / Gauge / Histogram ---
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& cell : shards) total += cell.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+void Gauge::add(double delta) { atomicAdd(current, delta); }
+
+Histogram::Histogram(std::vector<double> bounds) : upper_bounds(std::move(bounds)) {
+    std::sort(upper_bounds.begin(), upper_bounds.end());
+    for (auto& shard : shards) {
+        shard.buckets.reset(new std::atomic<uint64_t>[upper_bounds.size() + 1]);
+        for (size_t i = 0; i <= upper_bounds.size(); ++i) shard.buckets[i].store(0);
+    }
+}
+
+void Histogram::observe(double v) {
+    Shard& shard = shards[metricShardIndex()];
+    size_t bucket = std::lower_bound(upper_bounds.begin(), upper_bounds.end(), v) - upper_bounds.begin();
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    atomicAdd(shard.sum, v);
+}
+
+std::vector<uint64_t> Histogram::cumulativeCounts() const {
+    std::vector<uint64_t> counts(upper_bounds.size() + 1, 0);
+    for (const auto& shard : shards) {
+        for (size_t i = 0; i < counts.size(); ++i) counts[i] += shard.buckets[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 1; i < counts.size(); ++i) counts[i] += counts[i - 1];
+    return counts;
+}
+
+uint64_t Histogram::count() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) total += shard.count.load(std::memory_order_relaxed);
+    return total;
+}
+
+double Histogram::sum() const {
+    double total = 0;
+    for (const auto& shard : shards) total += shard.sum.load(std::memory_order_relaxed);
+    return total;
+}
+
+std::vector<double> defaultLatencyBuckets() {
+    return {0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60};
+}
+
+// --- MetricsRegistry ---
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name, Kind kind, const std::string& help) {
+    auto it = families.find(name);
+    if (it == families.end()) {
+        it = families.emplace(name, Family{}).first;
+        it->second.kind = kind;
+        it->second.help = help;
+    }
+    return it->second;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = family(name, Kind::COUNTER, help).counters[labels];
+    if (!slot) slot = std::make_unique<Counter>();
+    return *slot;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = family(name, Kind::GAUGE, help).gauges[labels];
+    if (!slot) slot = std::make_unique<Gauge>();
+    return *slot;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const std::string& labels,
+                                      std::vector<double> upper_bounds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = family(name, Kind::HISTOGRAM, help).histograms[labels];
+    if (!slot) slot = std::make_unique<Histogram>(std::move(upper_bounds));
+    return *slot;
+}
+
+std::string MetricsRegistry::renderPrometheus() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ostringstream out;
+    for (const auto& [name, fam] : families) {
+        out << "# HELP " << name << " " << fam.help << "\n";
+        switch (fam.kind) {
+            case Kind::COUNTER:
+                out << "# TYPE " << name << " counter\n";
+                for (const auto& [labels, c] : fam.counters) out << seriesName(name, labels) << " " << c->value() << "\n";
+                break;
+            case Kind::GAUGE:
+                out << "# TYPE " << name << " gauge\n";
+                for (const auto& [labels, g] : fam.gauges) out << seriesName(name, labels) << " " << formatValue(g->value()) << "\n";
+                break;
+            case Kind::HISTOGRAM:
+                out << "# TYPE " << name << " histogram\n";
+                for (const auto& [labels, h] : fam.histograms) {
+                    std::vector<uint64_t> counts = h->cumulativeCounts();
+                    for (size_t i = 0; i < h->bounds().size(); ++i) {
+                        out << seriesName(name + "_bucket", labels, "le=\"" + formatValue(h->bounds()[i]) + "\"") << " " << counts[i] << "\n";
+                    }
+                    out << seriesName(name + "_bucket", labels, "le=\"+Inf\"") << " " << counts.back() << "\n";
+                    out << seriesName(name + "_sum", labels) << " " << formatValue(h->sum()) << "\n";
+                    out << seriesName(name + "_count", labels) << " " << h->count() << "\n";
+                }
+                break;
+        }
+    }
+    return out.str();
+}
+
+bool MetricsRegistry::writePrometheusFile(const std::string& path) const {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        if (!file.is_open()) return false;
+        file << renderPrometheus();
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// --- MetricsExporter ---
+
+MetricsExporter::MetricsExporter(MetricsRegistry& reg) : registry(reg) {}
+
+MetricsExporter::~MetricsExporter() { stop(); }
+
+void MetricsExporter::startFileExport(const std::string& path, std::chrono::milliseconds interval) {
+    running = true;
+    file_thread = std::thread([this, path, interval]() {
+        while (running) {
+            registry.writePrometheusFile(path);
+            auto deadline = std::chrono::steady_clock::now() + interval;
+            while (running && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+        registry.writePrometheusFile(path);
+    });
+}
+
+bool MetricsExporter::startHttpEndpoint(int port) {
+    listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) return false;
+    int reuse = 1;
+    ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd, 16) < 0) {
+        ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    running = true;
+    http_thread = std::thread(&MetricsExporter::serveHttp, this);
+    return true;
+}
+
+// One client at a time, so each gets kRequestTimeout to send its request
+// line and as long to take the response; a silent client cannot hold up
+// later scrapes or stop().
+void MetricsExporter::serveHttp() {
+    const auto kRequestTimeout = std::chrono::seconds(2);
+    while (running) {
+        int client = ::accept(listen_fd, nullptr, nullptr);
+        if (client < 0) {
+            if (!running) break;
+            if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100)); // out of descriptors or memory: wait for some
+                continue;
+            }
+            break;
+        }
+        timeval send_timeout{static_cast<time_t>(kRequestTimeout.count()), 0};
+        ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+        std::string first_line;
+        auto deadline = std::chrono::steady_clock::now() + kRequestTimeout;
+        while (running && first_line.find("\r\n") == std::string::npos && first_line.size() < 1024) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) break;
+            pollfd ready{client, POLLIN, 0};
+            // Short slices, so stop() is noticed while a client dawdles.
+            int polled = ::poll(&ready, 1, static_cast<int>(std::min<long long>(left.count(), 100)));
+            if (polled < 0 && errno != EINTR) break;
+            if (polled <= 0) continue;
+            char request[1024];
+            ssize_t n = ::recv(client, request, sizeof(request), 0);
+            if (n <= 0) break;
+            first_line.append(request, static_cast<size_t>(n));
+        }
+        if (first_line.empty()) { // timed out, hung up or stopping
+            ::close(client);
+            continue;
+        }
+        std::string body;
+        std::string status = "200 OK";
+        if (first_line.rfind("GET /metrics", 0) == 0) {
+            body = registry.renderPrometheus();
+        } else {
+            status = "404 Not Found";
+        }
+        std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                               std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t w = ::send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (w <= 0) break;
+            sent += static_cast<size_t>(w);
+        }
+        ::close(client);
+    }
+}
+
+void MetricsExporter::stop() {
+    running = false;
+    // Shut down wakes accept(); the descriptor is closed only once the
+    // thread using it is gone.
+    if (listen_fd >= 0) ::shutdown(listen_fd, SHUT_RDWR);
+    if (http_thread.joinable()) http_thread.join();
+    if (listen_fd >= 0) {
+        ::close(listen_fd);
+        listen_fd = -1;
+    }
+    if (file_thread.joinable()) file_thread.join();
+}
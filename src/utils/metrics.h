@@ -0,0 +1,118 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Process-wide metrics with Prometheus text exposition.
+// Counters and histograms are sharded per thread so hot-path updates are
+// uncontended relaxed atomics; reads sum the shards.
+
+constexpr size_t kMetricShards = 16;
+
+size_t metricShardIndex();
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) { shards[metricShardIndex()].value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Cell, kMetricShards> shards;
+};
+
+// Gauges are last-write-wins, so they are a single atomic rather than sharded.
+class Gauge {
+public:
+    void set(double v) { current.store(v, std::memory_order_relaxed); }
+    void add(double delta);
+    double value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> current{0.0};
+};
+
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> upper_bounds);
+    void observe(double v);
+    std::vector<uint64_t> cumulativeCounts() const; // one per bound, plus +Inf
+    const std::vector<double>& bounds() const { return upper_bounds; }
+    uint64_t count() const;
+    double sum() const;
+
+private:
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+        std::atomic<uint64_t> count{0};
+        std::atomic<double> sum{0.0};
+    };
+    std::vector<double> upper_bounds;
+    std::array<Shard, kMetricShards> shards;
+};
+
+// Default latency buckets in seconds, 1ms to 60s.
+std::vector<double> defaultLatencyBuckets();
+
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // Returned references stay valid for the life of the process.
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "",
+                         std::vector<double> upper_bounds = defaultLatencyBuckets());
+
+    std::string renderPrometheus() const;
+    bool writePrometheusFile(const std::string& path) const;
+
+private:
+    enum class Kind { COUNTER, GAUGE, HISTOGRAM };
+    struct Family {
+        Kind kind;
+        std::string help;
+        std::map<std::string, std::unique_ptr<Counter>> counters;
+        std::map<std::string, std::unique_ptr<Gauge>> gauges;
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+    };
+
+    Family& family(const std::string& name, Kind kind, const std::string& help);
+
+    mutable std::mutex mutex; // guards registration and export, never updates
+    std::map<std::string, Family> families;
+};
+
+// Background exporter: periodically rewrites a metrics file and/or serves
+// GET /metrics on a loopback port.
+class MetricsExporter {
+public:
+    explicit MetricsExporter(MetricsRegistry& registry = MetricsRegistry::instance());
+    ~MetricsExporter();
+
+    void startFileExport(const std::string& path, std::chrono::milliseconds interval);
+    bool startHttpEndpoint(int port);
+    void stop();
+
+private:
+    void serveHttp();
+
+    MetricsRegistry& registry;
+    std::atomic<bool> running{false};
+    std::thread file_thread;
+    std::thread http_thread;
+    int listen_fd = -1;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,82 @@
+#include "ndjson.h"
+#include "json_utils.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <thread>
+
+namespace {
+
+constexpr size_t kMinChunkBytes = 1 << 20; // below this a thread costs more than it saves
+
+struct Chunk {
+    std::string_view text;
+    NdjsonBatch batch;   // line numbers relative to the chunk
+    size_t raw_lines = 0; // every line, blank or not
+};
+
+void parseChunk(Chunk& chunk) {
+    std::string_view text = chunk.text;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const char* nl = static_cast<const char*>(std::memchr(text.data() + pos, '\n', text.size() - pos));
+        size_t end = nl ? static_cast<size_t>(nl - text.data()) : text.size();
+        std::string_view line = text.substr(pos, end - pos);
+        size_t line_no = ++chunk.raw_lines;
+        pos = end + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.find_first_not_of(" \t") == std::string_view::npos) continue;
+        chunk.batch.lines++;
+        Task task;
+        JsonParseError error;
+        if (parse_task(line, task, error)) {
+            chunk.batch.tasks.push_back(std::move(task));
+            chunk.batch.task_lines.push_back(line_no);
+        } else {
+            chunk.batch.errors.push_back(NdjsonLineError{line_no, error.position + 1, error.message});
+        }
+    }
+}
+
+} // namespace
+
+void parse_ndjson_tasks(std::string_view input, NdjsonBatch& batch, unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunk_count = std::max<size_t>(1, std::min<size_t>(threads, input.size() / kMinChunkBytes));
+
+    // Cut near equal offsets, then move each cut past the next newline so no line is split.
+    std::vector<Chunk> chunks;
+    size_t begin = 0;
+    for (size_t k = 1; k <= chunk_count && begin < input.size(); ++k) {
+        size_t end = input.size();
+        if (k < chunk_count) {
+            size_t target = std::max(begin, input.size() / chunk_count * k);
+            const char* nl = static_cast<const char*>(std::memchr(input.data() + target, '\n', input.size() - target));
+            end = nl ? static_cast<size_t>(nl - input.data()) + 1 : input.size();
+        }
+        chunks.push_back(Chunk{input.substr(begin, end - begin), {}, 0});
+        begin = end;
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t k = 1; k < chunks.size(); ++k) workers.emplace_back(parseChunk, std::ref(chunks[k]));
+    if (!chunks.empty()) parseChunk(chunks[0]);
+    for (auto& worker : workers) worker.join();
+
+    size_t total = batch.tasks.size();
+    for (const auto& chunk : chunks) total += chunk.batch.tasks.size();
+    batch.tasks.reserve(total);
+    batch.task_lines.reserve(total);
+    size_t line_base = 0;
+    for (auto& chunk : chunks) {
+        NdjsonBatch& part = chunk.batch;
+        batch.tasks.insert(batch.tasks.end(), std::make_move_iterator(part.tasks.begin()), std::make_move_iterator(part.tasks.end()));
+        for (size_t line : part.task_lines) batch.task_lines.push_back(line_base + line);
+        for (auto& error : part.errors) {
+            error.line += line_base;
+            batch.errors.push_back(std::move(error));
+        }
+        batch.lines += part.lines;
+        line_base += chunk.raw_lines;
+    }
+}
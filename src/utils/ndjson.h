@@ -0,0 +1,30 @@
+#ifndef NDJSON_H
+#define NDJSON_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../models/models.h"
+
+// A line that did not parse as a task. line is 1-based.
+struct NdjsonLineError {
+    size_t line = 0;
+    size_t column = 0; // 1-based byte column of the parse failure
+    std::string message;
+};
+
+// Tasks parsed from newline-delimited JSON, in input order.
+struct NdjsonBatch {
+    std::vector<Task> tasks;
+    std::vector<size_t> task_lines; // 1-based line of each task
+    std::vector<NdjsonLineError> errors;
+    size_t lines = 0; // non-blank lines seen
+};
+
+// Splits input into chunks on line boundaries and parses them on up to
+// threads threads (0: one per hardware thread; small inputs use one). Blank
+// lines are skipped; malformed lines are reported and left out of the batch.
+void parse_ndjson_tasks(std::string_view input, NdjsonBatch& batch, unsigned threads = 0);
+
+#endif // NDJSON_H
@@ -0,0 +1,122 @@
+#include "tracing.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+void appendEscaped(std::ostringstream& out, const char* s) {
+    for (; *s; ++s) {
+        char c = *s;
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+        else out << c;
+    }
+}
+}
+
+std::atomic<bool> Tracer::active{false};
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer() : origin(std::chrono::steady_clock::now()) {}
+
+void Tracer::enable(size_t events_per_thread) {
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        ring_capacity = events_per_thread == 0 ? 1 : events_per_thread;
+    }
+    active.store(true, std::memory_order_release);
+}
+
+void Tracer::disable() { active.store(false, std::memory_order_release); }
+
+void Tracer::clear() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (auto& buffer : buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->next = 0;
+        buffer->wrapped = false;
+    }
+}
+
+int64_t Tracer::nowMicros() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+Tracer::ThreadBuffer& Tracer::localBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> local;
+    if (!local) {
+        local = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        local->ring.resize(ring_capacity);
+        local->thread_id = static_cast<int>(buffers.size()) + 1;
+        buffers.push_back(local);
+    }
+    return *local;
+}
+
+void Tracer::record(const char* name, int64_t start_us, int64_t duration_us, const std::string& correlation_id) {
+    ThreadBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    TraceEvent& event = buffer.ring[buffer.next];
+    event.name = name;
+    event.start_us = start_us;
+    event.duration_us = duration_us;
+    size_t n = std::min(correlation_id.size(), sizeof(event.correlation_id) - 1);
+    std::memcpy(event.correlation_id, correlation_id.data(), n);
+    event.correlation_id[n] = '\0';
+    if (++buffer.next == buffer.ring.size()) {
+        buffer.next = 0;
+        buffer.wrapped = true;
+    }
+}
+
+std::string Tracer::renderChromeTrace() const {
+    std::ostringstream out;
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    int pid = static_cast<int>(::getpid());
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const auto& buffer : buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        size_t count = buffer->wrapped ? buffer->ring.size() : buffer->next;
+        size_t begin = buffer->wrapped ? buffer->next : 0;
+        for (size_t i = 0; i < count; ++i) {
+            const TraceEvent& e = buffer->ring[(begin + i) % buffer->ring.size()];
+            if (!first) out << ",";
+            first = false;
+            out << "{\"name\":\"";
+            appendEscaped(out, e.name);
+            out << "\",\"cat\":\"task\",\"ph\":\"X\",\"ts\":" << e.start_us << ",\"dur\":" << e.duration_us
+                << ",\"pid\":" << pid << ",\"tid\":" << buffer->thread_id << ",\"args\":{\"correlation_id\":\"";
+            appendEscaped(out, e.correlation_id);
+            out << "\"}}";
+        }
+    }
+    out << "],\"displayTimeUnit\":\"ms\"}";
+    return out.str();
+}
+
+bool Tracer::dumpChromeTrace(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) return false;
+    file << renderChromeTrace();
+    return static_cast<bool>(file);
+}
+
+// --- TraceSpan ---
+
+void TraceSpan::begin(const std::string& id) {
+    start_us = Tracer::instance().nowMicros();
+    correlation_id = id;
+}
+
+void TraceSpan::end() {
+    Tracer& tracer = Tracer::instance();
+    tracer.record(name, start_us, tracer.nowMicros() - start_us, correlation_id);
+}
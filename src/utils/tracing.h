@@ -0,0 +1,89 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Opt-in span tracing for the task lifecycle.
+// Spans are recorded into fixed-size per-thread ring buffers and dumped as
+// Chrome trace-event JSON (loadable in chrome://tracing and Perfetto).
+// While tracing is disabled a span costs one relaxed atomic load.
+
+struct TraceEvent {
+    const char* name = nullptr; // must point at a string literal
+    int64_t start_us = 0;
+    int64_t duration_us = 0;
+    char correlation_id[48] = {0};
+};
+
+class Tracer {
+public:
+    static Tracer& instance();
+
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+    void enable(size_t events_per_thread = 16384);
+    void disable();
+    void clear();
+
+    void record(const char* name, int64_t start_us, int64_t duration_us, const std::string& correlation_id);
+    int64_t nowMicros() const;
+
+    std::string renderChromeTrace() const;
+    bool dumpChromeTrace(const std::string& path) const;
+
+private:
+    struct ThreadBuffer {
+        std::mutex mutex; // only contended while a dump is in progress
+        std::vector<TraceEvent> ring;
+        size_t next = 0;
+        bool wrapped = false;
+        int thread_id = 0;
+    };
+
+    Tracer();
+    ThreadBuffer& localBuffer();
+
+    static std::atomic<bool> active;
+    size_t ring_capacity = 16384;
+    std::chrono::steady_clock::time_point origin;
+    mutable std::mutex registry_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+};
+
+// RAII span. Tag with the task's correlation_id (or task_id when none is set).
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* span_name, const std::string& id = "") : name(span_name) {
+        if (Tracer::enabled()) begin(id);
+    }
+    ~TraceSpan() {
+        if (start_us >= 0) end();
+    }
+    // Attach a correlation id once it is known (e.g. after a dispatch decision).
+    void tag(const std::string& id) {
+        if (start_us >= 0) correlation_id = id;
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    void begin(const std::string& id);
+    void end();
+
+    const char* name;
+    int64_t start_us = -1;
+    std::string correlation_id;
+};
+
+// Correlation tag for a task: correlation_id if present, otherwise task_id.
+template <typename T>
+const std::string& traceId(const T& task) {
+    return task.correlation_id.empty() ? task.task_id : task.correlation_id;
+}
+
+#endif // TRACING_H
@@ -0,0 +1,45 @@
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(unsigned count) {
+    if (count == 0) count = 1;
+    threads.reserve(count);
+    for (unsigned i = 0; i < count; ++i) threads.emplace_back(&WorkerPool::work, this);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    job_ready.notify_all();
+    for (auto& thread : threads) thread.join();
+}
+
+void WorkerPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    job_ready.notify_one();
+}
+
+void WorkerPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return jobs.empty() && running == 0; });
+}
+
+void WorkerPool::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        job_ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (jobs.empty()) return; // stopping, and everything queued has run
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        running++;
+        lock.unlock();
+        job();
+        lock.lock();
+        running--;
+        if (jobs.empty() && running == 0) idle.notify_all();
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads running submitted jobs in FIFO order.
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned threads);
+    // Finishes every queued job, then joins the threads.
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void submit(std::function<void()> job);
+    // Blocks until the queue is empty and no job is running.
+    void wait();
+    unsigned size() const { return static_cast<unsigned>(threads.size()); }
+
+private:
+    void work();
+
+    std::mutex mutex;
+    std::condition_variable job_ready;
+    std::condition_variable idle;
+    std::deque<std::function<void()>> jobs;
+    unsigned running = 0;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,132 @@
+#include "../test_framework.h"
+#include <chrono>
+#include <functional>
+#include "bench_common.h"
+#include "utils/json_scan.h"
+#include "utils/ndjson.h"
+#include "utils/fd_sink.h"
+#include "storage/compressed_file.h"
+#include <cstdio>
+#include <thread>
+
+// Throughput benchmark: single-pass parser vs. the legacy per-key extractor,
+// chunked NDJSON parsing by thread count, block compression of a backup,
+// and JsonWriter vs. the legacy string-concatenation serializer.
+
+namespace {
+
+double mb_per_sec(size_t bytes, std::chrono::steady_clock::duration elapsed) {
+    double secs = std::chrono::duration<double>(elapsed).count();
+    return secs <= 0 ? 0.0 : (bytes / (1024.0 * 1024.0)) / secs;
+}
+
+template <typename Fn>
+std::chrono::steady_clock::duration time_it(int iterations, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) fn();
+    return std::chrono::steady_clock::now() - start;
+}
+
+} // namespace
+
+int main() {
+    UnitTest::section("JSON Parse Throughput");
+
+    std::vector<Task> tasks;
+    std::vector<std::string> task_docs;
+    size_t task_bytes = 0;
+    Schedule schedule("bench", "Benchmark Schedule");
+    for (int i = 0; i < 20000; ++i) {
+        Task t = sample_task(i);
+        tasks.push_back(t);
+        task_docs.push_back(to_json(t));
+        task_bytes += task_docs.back().size();
+        schedule.addTask(t);
+    }
+    std::string schedule_doc = to_json(schedule);
+
+    size_t sink = 0;
+    auto legacy_tasks = time_it(3, [&]() { for (const auto& d : task_docs) sink += legacy_from_json(d).task_id.size(); });
+    auto new_tasks = time_it(3, [&]() { for (const auto& d : task_docs) sink += from_json(d).task_id.size(); });
+    auto legacy_schedule = time_it(3, [&]() { sink += legacy_schedule_from_json(schedule_doc).tasks.size(); });
+    auto new_schedule = time_it(3, [&]() { sink += schedule_from_json(schedule_doc).tasks.size(); });
+
+    std::cout << "  Task documents:     " << task_docs.size() << " (" << task_bytes / 1024 << " KiB)\n"
+              << "  Schedule document:  " << schedule_doc.size() / 1024 << " KiB\n\n"
+              << std::fixed << std::setprecision(1)
+              << "  from_json          legacy " << mb_per_sec(task_bytes * 3, legacy_tasks) << " MB/s   single-pass "
+              << mb_per_sec(task_bytes * 3, new_tasks) << " MB/s\n"
+              << "  schedule_from_json legacy " << mb_per_sec(schedule_doc.size() * 3, legacy_schedule) << " MB/s   single-pass "
+              << mb_per_sec(schedule_doc.size() * 3, new_schedule) << " MB/s\n"
+              << "  (checksum " << sink << ")\n";
+
+    UnitTest::section("Structural Scan (stage 1)");
+    std::vector<size_t> positions;
+    find_structurals(schedule_doc, positions); // size the index once, untimed
+    std::cout << "  Best kernel on this CPU: " << scanKernelName(bestScanKernel()) << "\n";
+    for (ScanKernel kernel : {ScanKernel::SCALAR, ScanKernel::SSE42, ScanKernel::AVX2}) {
+        if (!scanKernelSupported(kernel)) continue;
+        auto scan = time_it(3, [&]() { find_structurals(schedule_doc, positions, kernel); sink += positions.size(); });
+        setScanKernel(kernel);
+        auto parse = time_it(3, [&]() { sink += schedule_from_json(schedule_doc).tasks.size(); });
+        std::cout << "  " << std::setw(7) << std::left << scanKernelName(kernel) << std::right << " scan "
+                  << std::setprecision(2) << mb_per_sec(schedule_doc.size() * 3, scan) / 1024.0 << " GB/s   schedule_from_json "
+                  << std::setprecision(1) << mb_per_sec(schedule_doc.size() * 3, parse) << " MB/s\n";
+    }
+    setScanKernel(bestScanKernel());
+
+    UnitTest::section("NDJSON Import Parse");
+    std::string ndjson;
+    for (const auto& d : task_docs) ndjson += d + "\n";
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads : {1u, hw}) {
+        auto parse = time_it(3, [&]() {
+            NdjsonBatch batch;
+            parse_ndjson_tasks(ndjson, batch, threads);
+            sink += batch.tasks.size();
+        });
+        std::cout << "  parse_ndjson_tasks " << threads << " thread(s) " << mb_per_sec(ndjson.size() * 3, parse) << " MB/s\n";
+        if (hw == 1) break;
+    }
+
+    UnitTest::section("Backup Block Compression");
+    const char* backup = "bench_backup.qlz";
+    for (unsigned threads : {1u, hw}) {
+        auto compress = time_it(3, [&]() {
+            FdSink out;
+            out.open(backup);
+            CompressedWriter writer(out, threads);
+            writer.write(schedule_doc);
+            writer.finish();
+            out.close();
+        });
+        std::string restored, error;
+        auto decompress = time_it(3, [&]() { sink += readCompressedFile(backup, restored, error, threads); });
+        std::cout << "  " << threads << " thread(s): compress " << mb_per_sec(schedule_doc.size() * 3, compress)
+                  << " MB/s   decompress " << mb_per_sec(schedule_doc.size() * 3, decompress) << " MB/s   ratio "
+                  << static_cast<double>(schedule_doc.size()) / std::filesystem::file_size(backup)
+                  << (restored == schedule_doc ? "" : "   ROUND TRIP FAILED") << "\n";
+        if (hw == 1) break;
+    }
+    std::remove(backup);
+
+    UnitTest::section("JSON Serialize Throughput");
+    auto legacy_write = time_it(3, [&]() { for (const auto& t : tasks) sink += legacy_to_json(t).size(); });
+    auto new_write = time_it(3, [&]() { for (const auto& t : tasks) sink += to_json(t).size(); });
+    std::string reused;
+    JsonWriter writer(reused);
+    for (const auto& t : tasks) write_json(writer, t); // size the buffer once, untimed
+    auto buffered_write = time_it(3, [&]() {
+        writer.reset();
+        for (const auto& t : tasks) write_json(writer, t);
+        sink += writer.size();
+    });
+    double legacy_rate = mb_per_sec(task_bytes * 3, legacy_write);
+    double new_rate = mb_per_sec(task_bytes * 3, new_write);
+    double buffered_rate = mb_per_sec(task_bytes * 3, buffered_write);
+    std::cout << "  to_json            legacy " << legacy_rate << " MB/s   JsonWriter " << new_rate << " MB/s ("
+              << new_rate / legacy_rate << "x)\n"
+              << "  write_json         one reused buffer " << buffered_rate << " MB/s (" << buffered_rate / legacy_rate << "x)\n"
+              << "  (checksum " << sink << ")\n";
+    return 0;
+}
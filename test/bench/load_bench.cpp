@@ -0,0 +1,281 @@
+#include "../test_framework.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "bench_common.h"
+#include "core/core.h"
+#include "queue/queue_log.h"
+#include "queue/spool.h"
+#include "utils/batch_io.h"
+#include "utils/fd_sink.h"
+#include "utils/logger.h"
+
+// Peak-RSS benchmark for Scheduler::loadSchedule, loadSnapshot and schedule saving.
+// Each loader/saver runs in a forked child so ru_maxrss reflects it alone.
+
+namespace {
+
+const char* kSchedulePath = "load_bench_schedule.json";
+
+// The pre-mmap load path: slurp into a string, extract per key, copy into the scheduler.
+void legacy_load(const std::string& path) {
+    Publisher pub;
+    Scheduler scheduler(pub);
+    std::ifstream file(path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string content = buffer.str();
+    Schedule schedule = legacy_schedule_from_json(content);
+    scheduler.setSchedule(schedule);
+}
+
+void mmap_load(const std::string& path) {
+    Publisher pub;
+    Scheduler scheduler(pub);
+    scheduler.loadSchedule(path);
+}
+
+const char* kSnapshotPath = "load_bench_state.snap";
+
+void write_snapshot(const std::string& path) {
+    Publisher pub;
+    Scheduler scheduler(pub);
+    scheduler.loadSchedule(kSchedulePath);
+    scheduler.saveSnapshot(path);
+}
+
+void snapshot_load(const std::string& path) {
+    Publisher pub;
+    Scheduler scheduler(pub);
+    scheduler.loadSnapshot(path);
+}
+
+const char* kSavePath = "load_bench_save.json";
+const int kTasks = 100000;
+
+Schedule build_schedule() {
+    Schedule schedule("bench", "Load Benchmark Schedule");
+    schedule.tasks.reserve(kTasks);
+    for (int i = 0; i < kTasks; ++i) schedule.addTask(sample_task(i));
+    return schedule;
+}
+
+// The pre-streaming save path: copy and sort the tasks, build one string, write it.
+void legacy_save(const std::string& path) {
+    Schedule schedule = build_schedule();
+    std::ofstream file(path);
+    file << legacy_schedule_to_json(schedule);
+}
+
+// What saveSchedule does now: stream through an index permutation into an fd sink.
+void streaming_save(const std::string& path) {
+    Schedule schedule = build_schedule();
+    FdSink sink;
+    sink.open(path);
+    write_json(schedule, sink);
+    sink.close();
+}
+
+struct ChildResult {
+    long max_rss_kib = 0;
+    double seconds = 0;
+};
+
+ChildResult run_in_child(void (*loader)(const std::string&), const char* path) {
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        Logger::instance().setLevel(LogLevel::ERROR);
+        loader(path);
+        _exit(0);
+    }
+    int status = 0;
+    rusage usage{};
+    wait4(pid, &status, 0, &usage);
+    ChildResult result;
+    result.max_rss_kib = usage.ru_maxrss;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// Enqueues per second: one spool file per task (temp file plus rename, as
+// `add` does) against queue log appends, singly and in batches of 1000.
+void queue_enqueue_throughput() {
+    UnitTest::section("Queue Enqueue Throughput");
+    const int kEnqueues = 20000;
+    const std::string payload = to_json(Task("bench", "Queued task", "medium", {}, "bench", 60));
+    auto rate = [&](const std::function<void()>& enqueue_all) {
+        auto start = std::chrono::steady_clock::now();
+        enqueue_all();
+        return kEnqueues / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    std::filesystem::remove_all("load_bench_queue");
+    std::filesystem::create_directories("load_bench_queue/pending");
+    double files = rate([&] {
+        for (int i = 0; i < kEnqueues; ++i) spoolWriteFile("load_bench_queue/pending", "t" + std::to_string(i) + ".json", payload);
+    });
+    double single, batched;
+    {
+        QueueLog log("load_bench_queue/log");
+        single = rate([&] {
+            for (int i = 0; i < kEnqueues; ++i) log.append(QueueRecord{QueueRecordType::Enqueue, "t" + std::to_string(i), payload});
+        });
+        batched = rate([&] {
+            std::vector<QueueRecord> batch;
+            for (int i = 0; i < kEnqueues; ++i) {
+                batch.push_back(QueueRecord{QueueRecordType::Enqueue, "t" + std::to_string(i), payload});
+                if (batch.size() == 1000) {
+                    log.append(batch);
+                    batch.clear();
+                }
+            }
+        });
+    }
+    std::filesystem::remove_all("load_bench_queue");
+    std::cout << std::fixed << std::setprecision(0)
+              << "  spool files       " << files << " enqueues/s\n"
+              << "  log, one by one   " << single << " enqueues/s\n"
+              << "  log, 1000/batch   " << batched << " enqueues/s\n";
+}
+
+// Tasks per second through the file queue's I/O alone: claim, lease, read,
+// write the result and release, per file as before and in batches of 256.
+void task_file_io_throughput() {
+    UnitTest::section("Task File I/O Per Task");
+    const int kTasks = 5000;
+    const std::string task = to_json(Task("bench", "Queued task", "medium", {}, "bench", 60));
+    const std::string owner = spoolOwner();
+    auto setup = [&] {
+        std::filesystem::remove_all("load_bench_files");
+        for (const char* dir : {"pending", "in_progress", "completed"}) std::filesystem::create_directories(std::string("load_bench_files/") + dir);
+        for (int i = 0; i < kTasks; ++i) std::ofstream("load_bench_files/pending/t" + std::to_string(i) + ".json") << task;
+    };
+    auto rate = [&](const std::function<void()>& run_all) {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        run_all();
+        return kTasks / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    double single = rate([&] {
+        for (int i = 0; i < kTasks; ++i) {
+            std::string name = "t" + std::to_string(i) + ".json";
+            spoolClaim("load_bench_files/pending", "load_bench_files/in_progress", name, owner, std::chrono::seconds(600));
+            std::ifstream in("load_bench_files/in_progress/" + name);
+            std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            std::ofstream("load_bench_files/completed/" + name) << content.size();
+            spoolRelease("load_bench_files/in_progress", name);
+        }
+    });
+    auto batched = [&](unsigned depth) {
+        BatchIo io(depth);
+        for (int begin = 0; begin < kTasks; begin += 256) {
+            std::vector<std::pair<std::string, std::string>> moves;
+            std::vector<std::string> paths;
+            std::vector<BatchIo::Write> leases, results;
+            for (int i = begin; i < std::min(kTasks, begin + 256); ++i) {
+                std::string name = "t" + std::to_string(i) + ".json";
+                moves.emplace_back("load_bench_files/pending/" + name, "load_bench_files/in_progress/" + name);
+                paths.push_back(moves.back().second);
+                std::string lease = "load_bench_files/in_progress/" + spoolLeaseName(name);
+                leases.push_back(BatchIo::Write{lease + ".tmp", spoolLeaseRecord(owner, std::chrono::seconds(600)), lease, {}});
+                results.push_back(BatchIo::Write{"load_bench_files/completed/" + name, "", "", {paths.back(), lease}});
+            }
+            std::vector<int> errors;
+            std::vector<std::string> contents;
+            io.rename(moves, errors);
+            io.write(leases, errors);
+            io.read(paths, contents, errors);
+            for (size_t k = 0; k < results.size(); ++k) results[k].content = std::to_string(contents[k].size());
+            io.write(results, errors);
+        }
+        return io.usingIoUring();
+    };
+    bool ring = false;
+    double plain = rate([&] { batched(0); });
+    double uring = rate([&] { ring = batched(256); });
+    std::filesystem::remove_all("load_bench_files");
+    std::cout << std::fixed << std::setprecision(0)
+              << "  one file at a time     " << single << " tasks/s\n"
+              << "  batched, syscalls      " << plain << " tasks/s\n"
+              << "  batched, " << (ring ? "io_uring      " : "no io_uring   ") << uring << " tasks/s\n";
+}
+
+// Durable results per second: fsync of each result and its directory, as
+// queue.durability=each does, against group commits of 64, and against one
+// syncfs per result or per group instead of the fsyncs.
+void result_durability_throughput() {
+    UnitTest::section("Durable Result Writes");
+    const int kResults = 2000;
+    const std::string result = "{\"task_id\": \"bench\", \"status\": \"completed\", \"output\": \"done\"}\n";
+    auto rate = [&](size_t group, unsigned depth, bool syncfs = false) {
+        std::filesystem::remove_all("load_bench_results");
+        std::filesystem::create_directories("load_bench_results");
+        BatchIo io(depth);
+        std::vector<int> errors;
+        auto start = std::chrono::steady_clock::now();
+        for (int begin = 0; begin < kResults; begin += static_cast<int>(group)) {
+            std::vector<BatchIo::Write> writes;
+            for (int i = begin; i < std::min(kResults, begin + static_cast<int>(group)); ++i) {
+                writes.push_back(BatchIo::Write{"load_bench_results/r" + std::to_string(i) + ".json", result, "", {}, !syncfs});
+            }
+            io.write(writes, errors);
+            if (syncfs) {
+                io.syncFilesystems({"load_bench_results"}, errors);
+            } else {
+                io.syncDirectories({"load_bench_results"}, errors);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::filesystem::remove_all("load_bench_results");
+        return kResults / seconds;
+    };
+    double each = rate(1, 0);
+    double grouped = rate(64, 0);
+    double ring = rate(64, 256);
+    double each_syncfs = rate(1, 0, true);
+    double grouped_syncfs = rate(64, 0, true);
+    std::cout << std::fixed << std::setprecision(0)
+              << "  fsync each result      " << each << " results/s\n"
+              << "  group commit of 64     " << grouped << " results/s\n"
+              << "  same, via io_uring     " << ring << " results/s (fsyncs overlap)\n"
+              << "  syncfs each result     " << each_syncfs << " results/s\n"
+              << "  syncfs per group of 64 " << grouped_syncfs << " results/s\n";
+}
+
+} // namespace
+
+int main() {
+    UnitTest::section("Schedule Load/Save Peak RSS");
+
+    // Children generate their own data so every fork starts from the same small baseline.
+    ChildResult legacy_saved = run_in_child(legacy_save, kSavePath);
+    ChildResult streamed = run_in_child(streaming_save, kSchedulePath);
+    size_t file_bytes = std::filesystem::file_size(kSchedulePath);
+    ChildResult legacy = run_in_child(legacy_load, kSchedulePath);
+    ChildResult mapped = run_in_child(mmap_load, kSchedulePath);
+    run_in_child(write_snapshot, kSnapshotPath);
+    size_t snapshot_bytes = std::filesystem::file_size(kSnapshotPath);
+    ChildResult snapshot = run_in_child(snapshot_load, kSnapshotPath);
+    std::remove(kSchedulePath);
+    std::remove(kSnapshotPath);
+    std::remove(kSavePath);
+
+    std::cout << "  Schedule file:  " << file_bytes / (1024 * 1024) << " MiB, " << kTasks << " tasks\n"
+              << "  Snapshot file:  " << snapshot_bytes / (1024 * 1024) << " MiB\n\n"
+              << std::fixed << std::setprecision(2)
+              << "  legacy load     peak RSS " << legacy.max_rss_kib / 1024 << " MiB   " << legacy.seconds << " s\n"
+              << "  mmap load       peak RSS " << mapped.max_rss_kib / 1024 << " MiB   " << mapped.seconds << " s\n"
+              << "  snapshot load   peak RSS " << snapshot.max_rss_kib / 1024 << " MiB   " << snapshot.seconds << " s\n"
+              << "  legacy save     peak RSS " << legacy_saved.max_rss_kib / 1024 << " MiB   " << legacy_saved.seconds << " s\n"
+              << "  streaming save  peak RSS " << streamed.max_rss_kib / 1024 << " MiB   " << streamed.seconds << " s\n"
+              << "  (save times include building the in-memory schedule)\n";
+    queue_enqueue_throughput();
+    task_file_io_throughput();
+    result_durability_throughput();
+    return 0;
+}
@@ -5,12 +5,39 @@
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <thread>
+#include <csignal>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "models/models.h"
 #include "events/events.h"
 #include "core/core.h"
 #include "utils/json_utils.h"
 #include "cli/cli.h"
+#include "utils/metrics.h"
+#include "utils/tracing.h"
+#include "utils/logger.h"
+#include "utils/fd_sink.h"
+#include "utils/json_scan.h"
+#include "utils/crc32c.h"
+#include "utils/batch_io.h"
+#include "utils/dir_watcher.h"
+#include "utils/ndjson.h"
+#include "storage/columnar.h"
+#include "queue/queue_log.h"
+#include "queue/spool.h"
+#include "storage/backup.h"
+#include "storage/compressed_file.h"
 
 // Simple test helper
 void assert_test(bool condition, const std::string& message) {
@@ -117,6 +144,85 @@ void test_json() {
     std::string s_json = to_json(s1);
     Schedule s2 = schedule_from_json(s_json);
     assert_test(s1.name == s2.name && s1.tasks.size() == s2.tasks.size(), "schedule round-trips through JSON");
+    test_step("Serializing strings that need escaping");
+    Task t5("t\"5", "say \"hi\"\\ then\n\ttab \x01 done", "low", {"a\\b"}, "c", -42);
+    std::string escaped = to_json(t5);
+    assert_test(escaped.find("\"say \\\"hi\\\"\\\\ then\\n\\ttab \\u0001 done\"") != std::string::npos, "quotes, backslashes and control characters are escaped");
+    Task t6;
+    JsonParseError err;
+    assert_test(parse_task(escaped, t6, err) && t6.task_id == t5.task_id && t6.description == t5.description &&
+                t6.dependencies == t5.dependencies && t6.max_runtime_sec == -42, "escaped task parses back unchanged");
+    test_step("Writing several values into one buffer");
+    std::string buffer;
+    JsonWriter writer(buffer);
+    writer.beginArray();
+    writer.value(7);
+    writer.value(true);
+    writer.value("x");
+    writer.beginObject();
+    writer.field("n", 1);
+    writer.field("list", std::vector<std::string>{"p", "q"});
+    writer.endObject();
+    writer.endArray();
+    writer.finish();
+    assert_test(buffer == "[7,true,\"x\",{\"n\": 1,\"list\": [\"p\",\"q\"]}]", "writer inserts separators and trims its buffer");
+}
+
+void test_json_parser() {
+    std::cout << "\n\033[1m\033[33m  ── Single-Pass JSON Parser ──\033[0m" << std::endl;
+    test_step("Parsing compact JSON with escapes and unknown keys");
+    Task t;
+    JsonParseError err;
+    bool ok = parse_task("{\"task_id\":\"t\\\"1\",\"extra\":{\"a\":[1,2]},\"description\":\"line\\nnext \\u00e9\",\"max_runtime_sec\":-5,\"confirmed\":true,\"labels\":[ \"a\" , \"b\" ]}", t, err);
+    assert_test(ok && t.task_id == "t\"1" && t.description == "line\nnext \xc3\xa9", "escaped strings are decoded");
+    assert_test(t.max_runtime_sec == -5 && t.confirmed && t.labels.size() == 2, "ints, bools and arrays parse without fixed spacing");
+    test_step("Parsing malformed JSON");
+    Task bad;
+    ok = parse_task("{\"task_id\": \"x\", \"max_runtime_sec\": abc}", bad, err);
+    assert_test(!ok && err.position == 36 && bad.task_id == "x", "errors report the byte offset");
+    Task edge;
+    bool in_range = parse_task("{\"max_runtime_sec\": -2147483648}", edge, err) && edge.max_runtime_sec == INT_MIN &&
+                    parse_task("{\"max_runtime_sec\": 2147483647}", edge, err) && edge.max_runtime_sec == INT_MAX;
+    ok = parse_task("{\"max_runtime_sec\": 2147483648}", edge, err);
+    bool too_big = !ok && err.message == "integer out of range" && err.position == 20;
+    ok = parse_task("{\"max_runtime_sec\": 99999999999999999999999}", edge, err);
+    assert_test(in_range && too_big && !ok && err.message == "integer out of range", "integers outside int are rejected");
+    ok = parse_task("{\"description\": \"\\ud83d\\u0041\"}", edge, err);
+    bool bad_pair = !ok && err.message == "invalid surrogate pair";
+    ok = parse_task("{\"description\": \"\\ud83d\\ude00 \\udc00\"}", edge, err);
+    assert_test(bad_pair && ok && edge.description == "\xf0\x9f\x98\x80 \xef\xbf\xbd", "surrogate pairs are checked, lone ones become U+FFFD");
+    test_step("Parsing a pretty-printed schedule");
+    Schedule sch;
+    ok = parse_schedule("{\n  \"tasks\" : [\n    {\"task_id\" : \"a\"},\n    {\"task_id\" : \"b\", \"dependencies\" : [\"a\"]}\n  ],\n  \"name\" : \"N\"\n}", sch, err);
+    assert_test(ok && sch.name == "N" && sch.tasks.size() == 2 && sch.tasks[1].dependencies[0] == "a", "schedule parses regardless of whitespace and key order");
+
+    test_step("Indexing structurals with an escape run crossing a 64-byte block");
+    // Backslashes at 61..63 escape the quote at 64, so the string closes at 66.
+    std::string doc = "{\"k\": \"" + std::string(54, 'a') + "\\\\\\\"b\", \"n\": [1]}";
+    std::vector<size_t> expected = {0, 1, 3, 4, 6, 61, 62, 63, 66, 67, 69, 71, 72, 74, 76, 77};
+    bool kernels_agree = true;
+    for (ScanKernel kernel : {ScanKernel::SCALAR, ScanKernel::SSE42, ScanKernel::AVX2}) {
+        if (!scanKernelSupported(kernel)) continue;
+        std::vector<size_t> positions;
+        find_structurals(doc, positions, kernel);
+        kernels_agree = kernels_agree && positions == expected;
+    }
+    assert_test(kernels_agree, "every supported kernel finds the same structurals");
+    test_step("Parsing a bulk schedule through the structural index");
+    Schedule bulk("bulk", "Bulk");
+    for (int i = 0; i < 400; ++i) {
+        bulk.addTask(Task("b" + std::to_string(1000 + i), std::string(100 + i % 70, 'x') + "\\ \"quoted\" \n", "low", {}, "c", i));
+    }
+    std::string bulk_doc = to_json(bulk);
+    bool bulk_ok = bulk_doc.size() > 64 * 1024;
+    for (ScanKernel kernel : {ScanKernel::SCALAR, ScanKernel::SSE42, ScanKernel::AVX2}) {
+        setScanKernel(kernel);
+        Schedule parsed;
+        bulk_ok = bulk_ok && parse_schedule(bulk_doc, parsed, err) && parsed.tasks.size() == 400 &&
+                  parsed.tasks[7].description == bulk.tasks[7].description && parsed.tasks[399].max_runtime_sec == 399;
+    }
+    setScanKernel(bestScanKernel());
+    assert_test(bulk_ok, "indexed parse decodes escapes under every kernel");
 }
 
 void test_persistence() {
@@ -133,6 +239,747 @@ void test_persistence() {
     Scheduler s2(pub);
     s2.loadSchedule("test_schedule.json");
     assert_test(s2.getSchedule().tasks.size() == 1 && s2.getSchedule().tasks[0].task_id == "t1", "scheduler can load and save schedules");
+    test_step("Failing a save without touching the saved schedule");
+    s1.saveSchedule("test_replace.json");
+    std::filesystem::create_directory("test_replace.json.tmp"); // the temp file cannot be created
+    Schedule grown = sch;
+    grown.addTask(Task("t2", "T2", "high", {}, "c", 10));
+    Scheduler s4(pub);
+    s4.setSchedule(grown);
+    s4.saveSchedule("test_replace.json", true);
+    std::filesystem::remove("test_replace.json.tmp");
+    Scheduler s5(pub);
+    s5.loadSchedule("test_replace.json");
+    bool kept = s5.getSchedule().tasks.size() == 1;
+    s4.saveSchedule("test_replace.json", true);
+    s5.loadSchedule("test_replace.json");
+    assert_test(kept && s5.getSchedule().tasks.size() == 2 && !std::filesystem::exists("test_replace.json.tmp"),
+                "a failed save keeps the previous file, the next one replaces it");
+    std::remove("test_replace.json");
+
+    test_step("Loading a deep dependency chain from a mapped file");
+    Schedule chain("chain", "Deep Chain");
+    for (int i = 0; i < 5000; ++i) {
+        std::vector<std::string> deps;
+        if (i + 1 < 5000) deps.push_back("c" + std::to_string(i + 1));
+        chain.addTask(Task("c" + std::to_string(i), "C", "low", deps, "c", 1));
+    }
+    { std::ofstream out("test_chain.json"); out << to_json(chain); }
+    Scheduler s3(pub);
+    s3.loadSchedule("test_chain.json");
+    assert_test(s3.getSchedule().tasks.size() == 5000, "deep chains load without recursion");
+
+    test_step("Rejecting a cyclic schedule on load");
+    Schedule cyclic("cyc", "Cyclic");
+    cyclic.addTask(Task("x", "X", "low", {"y"}, "c", 1));
+    cyclic.addTask(Task("y", "Y", "low", {"x"}, "c", 1));
+    { std::ofstream out("test_chain.json"); out << to_json(cyclic); }
+    s3.loadSchedule("test_chain.json");
+    assert_test(s3.getSchedule().name == "Deep Chain", "cyclic schedule is rejected and the current one kept");
+
+    test_step("Rejecting a schedule truncated inside a task");
+    std::string truncated = to_json(cyclic);
+    { std::ofstream out("test_chain.json"); out << truncated.substr(0, truncated.find("\"y\"") + 6); }
+    Scheduler s6(pub);
+    s6.loadSchedule("test_chain.json");
+    assert_test(s6.getSchedule().tasks.empty() && !s6.hasTask("x") && !s6.hasTask("y"), "a schedule that fails to parse is not applied");
+    std::remove("test_chain.json");
+
+    test_step("Streaming a schedule to a file in small chunks");
+    {
+        FdSink sink;
+        sink.open("test_chain.json", 256);
+        assert_test(write_json(chain, sink, 1024) && sink.close(true), "streamed save reports success");
+    }
+    std::ifstream streamed("test_chain.json");
+    std::string streamed_text((std::istreambuf_iterator<char>(streamed)), std::istreambuf_iterator<char>());
+    assert_test(streamed_text == to_json(chain), "streamed output matches to_json byte for byte");
+    std::remove("test_chain.json");
+    FdSink missing;
+    assert_test(!missing.open("no_such_dir/x.json") && !missing.ok(), "sink reports open failures");
+}
+
+void test_snapshot() {
+    std::cout << "\n\033[1m\033[33m  ── Binary Snapshot ──\033[0m" << std::endl;
+    test_step("Checking CRC32C against the standard check value");
+    const char* check = "123456789";
+    assert_test(crc32c(check, 9) == 0xE3069283u, "crc32c matches the Castagnoli check value");
+    assert_test(crc32c(check + 4, 5, crc32c(check, 4)) == crc32c(check, 9), "crc32c chains across calls");
+
+    test_step("Saving a scheduler with completed, pending, paused and draft tasks");
+    Publisher pub;
+    Scheduler s1(pub);
+    Schedule sch("snap", "Snapshot Schedule");
+    sch.addTask(Task("a", "A", "high", {}, "c", 1));
+    sch.addTask(Task("b", "B", "medium", {"a"}, "c", 1));
+    sch.addTask(Task("c", "C \"quoted\"", "low", {"ghost"}, "c", 1));
+    sch.tasks[2].labels = {"x", "y"};
+    sch.tasks[2].confirmed = true;
+    s1.setSchedule(sch);
+    Task* first = s1.getNextAvailableTask();
+    s1.markTaskAsCompleted(first->task_id);
+    s1.pauseTask("c");
+    s1.createDraftTask(Task("d", "D", "low", {}, "c", 1));
+    assert_test(s1.saveSnapshot("test_state.snap"), "snapshot is written");
+
+    test_step("Loading the snapshot into a new scheduler");
+    Scheduler s2(pub);
+    assert_test(s2.loadSnapshot("test_state.snap"), "snapshot loads");
+    const Schedule& loaded = s2.getSchedule();
+    assert_test(loaded.name == "Snapshot Schedule" && loaded.tasks.size() == 3, "schedule metadata and tasks survive");
+    assert_test(s2.getTaskStatus("a") == TaskStatus::Completed && s2.getTaskStatus("c") == TaskStatus::Paused, "task status survives");
+    const Task& c = loaded.tasks[2];
+    assert_test(c.description == "C \"quoted\"" && c.dependencies == std::vector<std::string>{"ghost"} && c.labels.size() == 2 && c.confirmed,
+                "task fields and orphaned dependencies survive");
+    Task* next = s2.getNextAvailableTask();
+    assert_test(next && next->task_id == "b", "restored queue dispatches the unblocked task");
+    s2.submitDraftTask("d");
+    assert_test(s2.getTaskStatus("d") == TaskStatus::Pending, "drafts survive");
+
+    test_step("Rejecting a corrupted snapshot");
+    {
+        std::fstream f("test_state.snap", std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(400);
+        f.put('\x7f');
+    }
+    Scheduler s3(pub);
+    s3.restoreBackup("test_schedule.json");
+    assert_test(!s3.loadSnapshot("test_state.snap") && s3.getSchedule().tasks.size() == 1, "checksum mismatch is refused and state kept");
+    std::remove("test_state.snap");
+    std::remove("test_schedule.json");
+}
+
+void test_write_ahead_log() {
+    std::cout << "\n\033[1m\033[33m  ── Write-Ahead Log ──\033[0m" << std::endl;
+    std::filesystem::remove_all("test_wal");
+    Publisher pub;
+    test_step("Logging transitions without any full save");
+    {
+        Scheduler s1(pub);
+        assert_test(s1.enableWriteAheadLog("test_wal"), "write-ahead log is enabled");
+        s1.submitTask(Task("w1", "W1", "high", {}, "c", 1));
+        s1.submitTask(Task("w2", "W2", "low", {"w1"}, "c", 1));
+        s1.submitTask(Task("w3", "W3", "low", {}, "c", 1));
+        s1.submitTask(Task("w4", "W4", "low", {}, "c", 1));
+        Task* first = s1.getNextAvailableTask();
+        s1.markTaskAsCompleted(first->task_id, "agent-1");
+        s1.pauseTask("w3");
+        s1.cancelTask("w4", "not needed");
+        s1.archiveTask("w2");
+        assert_test(s1.syncWriteAheadLog(), "group commit makes the transitions durable");
+    } // no shutdown(): as if the process died here
+
+    test_step("Replaying the log into a new scheduler");
+    {
+        Scheduler s2(pub);
+        assert_test(s2.enableWriteAheadLog("test_wal"), "log replays on startup");
+        assert_test(s2.getTaskStatus("w1") == TaskStatus::Completed && s2.getTaskStatus("w3") == TaskStatus::Paused,
+                    "dispatch, completion and pause are replayed");
+        assert_test(s2.getFailedTaskCount() == 1 && s2.getTaskStatus("w4") == TaskStatus::Failed, "cancellation is replayed");
+        Task* next = s2.getNextAvailableTask();
+        assert_test(next && next->task_id == "w2" && next->archived, "replayed queue dispatches the unblocked task");
+
+        test_step("Checkpointing and truncating the log");
+        assert_test(s2.checkpoint(), "checkpoint succeeds");
+        assert_test(std::filesystem::file_size("test_wal/wal.log") == 16, "log is truncated to its header");
+        s2.markTaskAsCompleted("w2");
+        s2.syncWriteAheadLog();
+    }
+    {
+        std::ofstream torn("test_wal/wal.log", std::ios::app | std::ios::binary);
+        torn << "\x20\x00\x00\x00garbage";
+    }
+
+    test_step("Recovering from checkpoint plus log with a torn tail");
+    Scheduler s3(pub);
+    assert_test(s3.enableWriteAheadLog("test_wal"), "recovery tolerates a torn final record");
+    assert_test(s3.getCompletedTaskCount() == 2 && s3.getTaskStatus("w2") == TaskStatus::Completed,
+                "checkpoint state plus later records are restored");
+    s3.submitTask(Task("w5", "W5", "low", {}, "c", 1));
+    assert_test(s3.syncWriteAheadLog(), "appends continue after the truncated tail");
+
+    test_step("Requeueing tasks dispatched before the crash");
+    {
+        Task* running = s3.getNextAvailableTask();
+        assert_test(running && running->task_id == "w5" && s3.syncWriteAheadLog(), "the task is dispatched");
+    }
+    {
+        Scheduler s4(pub);
+        assert_test(s4.enableWriteAheadLog("test_wal") && s4.getTaskStatus("w5") == TaskStatus::Pending, "the interrupted task is pending again");
+        Task* again = s4.getNextAvailableTask();
+        assert_test(again && again->task_id == "w5", "and is dispatched again");
+        s4.submitTask(Task("w6", "W6", "low", {}, "c", 1));
+        for (int i = 0; i < 5; ++i) s4.handleTaskFailure(i % 2 ? "w5" : "w6"); // opens the circuit; w6 runs out of retries
+        assert_test(s4.isCircuitBroken() && s4.syncWriteAheadLog(), "failures open the circuit breaker");
+    }
+
+    test_step("Replaying failures without their side effects");
+    {
+        std::filesystem::remove("./queue/dead_letter/w6.json");
+        Counter& failures = MetricsRegistry::instance().counter("quantalista_task_failures_total", "Task failures reported to handleTaskFailure");
+        uint64_t before = failures.value();
+        Scheduler s5(pub);
+        assert_test(s5.enableWriteAheadLog("test_wal"), "the failures replay");
+        assert_test(!s5.isCircuitBroken() && failures.value() == before && !std::filesystem::exists("./queue/dead_letter/w6.json"),
+                    "no circuit opens, metric moves or dead letter is rewritten");
+        assert_test(s5.getTaskStatus("w5") == TaskStatus::Pending && s5.getTaskStatus("w6") == TaskStatus::Failed,
+                    "retried and cancelled tasks end where they were");
+        s5.handleTaskFailure("w5"); // the third failure of w5
+        assert_test(s5.getTaskStatus("w5") == TaskStatus::Failed, "retry counts carry over");
+        std::filesystem::remove("./queue/dead_letter/w5.json");
+        std::filesystem::remove("./queue/dead_letter/w6.json");
+    }
+
+    test_step("Stopping at the first failed write");
+    {
+        WriteAheadLog log;
+        log.open("test_wal/broken.log", 1);
+        uint64_t kept = log.append(WalOp::Dispatch, "before");
+        log.sync(kept);
+        size_t good = std::filesystem::file_size("test_wal/broken.log");
+        rlimit saved;
+        getrlimit(RLIMIT_FSIZE, &saved);
+        auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+        rlimit small = saved;
+        small.rlim_cur = good + 8; // the next record is torn
+        setrlimit(RLIMIT_FSIZE, &small);
+        uint64_t torn = log.append(WalOp::Dispatch, std::string(64, 't'));
+        bool failed = !log.sync(torn) && log.lastError() == EFBIG;
+        setrlimit(RLIMIT_FSIZE, &saved);
+        std::signal(SIGXFSZ, old_handler);
+        uint64_t after = log.append(WalOp::Dispatch, "after");
+        assert_test(failed && after == 0 && !log.sync() && std::filesystem::file_size("test_wal/broken.log") == good + 8,
+                    "later records are refused instead of written past the tear");
+        assert_test(log.truncate() && log.append(WalOp::Dispatch, "fresh") > 0 && log.sync(), "truncating starts the log over");
+        std::vector<std::string> replayed;
+        uint64_t last = 0;
+        std::string error;
+        log.close();
+        WriteAheadLog::replay("test_wal/broken.log", 0, [&](const WalRecord& record) { replayed.emplace_back(record.fields[0]); }, last, error);
+        assert_test(replayed == std::vector<std::string>{"fresh"}, "only records after the truncation replay");
+    }
+    std::filesystem::remove_all("test_wal");
+
+    test_step("Restarting a coordinator over the same queue");
+    std::filesystem::remove_all("test_restart");
+    Project restart_project("rp", "Restart");
+    Workflow restart_flow("rf", "Restart");
+    restart_flow.addTask(Task("rs1", "Restarted", "high", {}, "c", 0));
+    restart_project.addWorkflow(restart_flow);
+    {
+        Coordinator first(restart_project, "./test_restart");
+        first.registerAgent(Agent("ra", "Runner"));
+        first.run();
+        assert_test(first.stateDirectory() == "./test_restart/state" && first.getScheduler().getTaskStatus("rs1") == TaskStatus::Completed,
+                    "the first coordinator logs its state and completes the task");
+    } // no shutdown()
+    {
+        Coordinator second(restart_project, "./test_restart");
+        bool restored = second.getScheduler().getTaskStatus("rs1") == TaskStatus::Completed;
+        assert_test(restored, "a second coordinator over the same queue replays the log");
+        if (restored) second.run(); // nothing left to run
+        second.shutdown();
+    }
+    test_step("Warm-starting from a shutdown snapshot");
+    std::filesystem::create_directories("test_restart/copy/state");
+    std::filesystem::copy_file("test_restart/state/shutdown_state.snap", "test_restart/copy/state/shutdown_state.snap");
+    {
+        Coordinator third(restart_project, "./test_restart/copy");
+        assert_test(third.getScheduler().getTaskStatus("rs1") == TaskStatus::Completed && std::filesystem::exists("test_restart/copy/state/checkpoint.snap"),
+                    "the snapshot is loaded and checkpointed into the log");
+    }
+    std::filesystem::remove_all("test_restart");
+}
+
+void test_ndjson_import() {
+    std::cout << "\n\033[1m\033[33m  ── NDJSON Import ──\033[0m" << std::endl;
+    test_step("Building a multi-megabyte NDJSON export with bad lines mixed in");
+    std::string ndjson;
+    const int count = 6000;
+    for (int i = 0; i < count; ++i) {
+        std::vector<std::string> deps;
+        if (i > 0) deps.push_back("n" + std::to_string(i - 1));
+        Task t("n" + std::to_string(i), std::string(400, 'd'), "low", deps, "c", 1);
+        ndjson += to_json(t) + "\n";
+    }
+    ndjson += "\n";                                                           // blank, skipped
+    ndjson += to_json(Task("n5", "again", "low", {}, "c", 1)) + "\n";        // duplicate
+    ndjson += to_json(Task("bad", "", "low", {}, "c", 1)) + "\n";            // fails validateTask
+    ndjson += "{\"task_id\": \"broken\"\n";                                   // malformed, line count + 4
+    assert_test(ndjson.size() > 2 * 1024 * 1024, "input spans several parse chunks");
+
+    test_step("Importing on four threads");
+    Publisher pub;
+    Scheduler s(pub);
+    s.submitTask(Task("existing", "E", "low", {}, "c", 1));
+    ndjson += to_json(Task("existing", "E", "low", {}, "c", 1)) + "\n";      // duplicate of scheduled task
+    ImportSummary summary = s.importFromLineDelimitedJSON(ndjson, 4);
+    assert_test(summary.imported == count && summary.duplicates == 2 && summary.invalid == 1 && summary.malformed == 1,
+                "valid tasks are imported and bad lines counted");
+    Task* first = s.getNextAvailableTask();
+    assert_test(first && (first->task_id == "n0" || first->task_id == "existing"), "imported chain is dispatchable from its root");
+
+    test_step("Rejecting an import whose dependencies form a cycle");
+    std::string cyclic = to_json(Task("x1", "X", "low", {"x2"}, "c", 1)) + "\n" + to_json(Task("x2", "X", "low", {"x1"}, "c", 1)) + "\n";
+    Scheduler s2(pub);
+    ImportSummary rejected = s2.importFromLineDelimitedJSON(cyclic, 2);
+    assert_test(rejected.cycle && rejected.imported == 0 && s2.getTaskStatus("x1") == TaskStatus::Failed, "cyclic batch is rejected as a whole");
+}
+
+void test_streaming_export() {
+    std::cout << "\n\033[1m\033[33m  ── Streaming Export ──\033[0m" << std::endl;
+    test_step("Building a schedule with tasks in every state");
+    Publisher pub;
+    Scheduler s(pub);
+    Schedule sch("exp", "Export");
+    sch.addTask(Task("e1", "say \"hi\", twice", "high", {}, "c", 1));
+    sch.addTask(Task("e2", "E2", "low", {}, "c", 1));
+    sch.addTask(Task("e3", "E3", "medium", {}, "c", 1));
+    s.setSchedule(sch);
+    Task* next = s.getNextAvailableTask();
+    assert_test(next && next->task_id == "e1", "highest priority task dispatched");
+    s.markTaskAsCompleted("e1", "a1");
+    s.pauseTask("e3");
+
+    test_step("Streaming CSV and NDJSON through a file sink");
+    std::string csv = s.exportToCSV();
+    assert_test(csv.find("\"say \"\"hi\"\", twice\",\"high\",2,") != std::string::npos, "quotes are doubled and status is per row");
+    assert_test(csv.find("\"e2\",\"E2\",\"low\",0,") != std::string::npos && csv.find("\"E3\",\"medium\",4,") != std::string::npos,
+                "pending and paused statuses match getTaskStatus");
+    auto stream = [&](bool as_csv) {
+        FdSink sink;
+        bool ok = sink.open("test_export.out", 16) && (as_csv ? s.exportToCSV(sink) : s.exportToLineDelimitedJSON(sink)) && sink.close();
+        std::ifstream f("test_export.out");
+        std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        return ok ? content : std::string("<write failed>");
+    };
+    assert_test(stream(true) == csv, "streamed CSV matches the in-memory export");
+    assert_test(stream(false) == s.exportToLineDelimitedJSON(), "streamed NDJSON matches the in-memory export");
+    std::filesystem::remove("test_export.out");
+}
+
+void test_columnar_export() {
+    std::cout << "\n\033[1m\033[33m  ── Columnar Export ──\033[0m" << std::endl;
+    test_step("Exporting 2500 tasks in row groups of 1000");
+    Publisher pub;
+    Scheduler s(pub);
+    Schedule sch("col", "Columnar");
+    const char* components[] = {"build", "deploy", "test"};
+    for (int i = 0; i < 2500; ++i) {
+        char id[16];
+        std::snprintf(id, sizeof(id), "t%05d", i);
+        Task t(id, "D", i % 2 ? "low" : "high", {}, components[i / 100 % 3], 10 + i % 7);
+        t.estimated_effort = i;
+        t.actual_effort = 2 * i;
+        sch.addTask(t);
+    }
+    s.setSchedule(sch);
+    s.pauseTask("t00001");
+    FdSink sink;
+    assert_test(sink.open("test_columnar.qlc") && s.exportColumnar(sink, 1000) && sink.close(), "export is written");
+
+    test_step("Reading the footer and scanning two columns");
+    ColumnarReader reader;
+    assert_test(reader.open("test_columnar.qlc"), "footer validates");
+    assert_test(reader.rowCount() == 2500 && reader.rowGroupCount() == 3 && reader.rowGroupRows(2) == 500, "row groups cover every task");
+    const ColumnarStats& effort = reader.stats(1, ColumnarColumn::EstimatedEffort);
+    assert_test(effort.min == 1000 && effort.max == 1999, "int32 statistics bound the group");
+    assert_test(reader.stats(0, ColumnarColumn::TaskId).min_string == "t00000" &&
+                reader.stats(0, ColumnarColumn::Component).max_string == "test", "string statistics bound the group");
+    std::vector<std::string_view> component;
+    std::vector<int32_t> actual;
+    long long deploy_actual = 0;
+    for (size_t g = 0; g < reader.rowGroupCount(); ++g) {
+        bool ok = reader.readStrings(g, ColumnarColumn::Component, component) && reader.readInts(g, ColumnarColumn::ActualEffort, actual);
+        for (size_t r = 0; ok && r < actual.size(); ++r) if (component[r] == "deploy") deploy_actual += actual[r];
+    }
+    long long expected = 0;
+    for (int i = 0; i < 2500; ++i) if (i / 100 % 3 == 1) expected += 2 * i;
+    assert_test(deploy_actual == expected, "run-length component column lines up with the effort column");
+    std::vector<std::string_view> status;
+    assert_test(reader.readStrings(0, ColumnarColumn::Status, status) && status[0] == "Pending" && status[1] == "Paused",
+                "status column holds per-task status names");
+
+    test_step("Corrupting the first column chunk");
+    {
+        std::fstream f("test_columnar.qlc", std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(20);
+        f.put('\x7f');
+    }
+    ColumnarReader damaged;
+    std::vector<std::string_view> ids;
+    assert_test(damaged.open("test_columnar.qlc") && !damaged.readStrings(0, ColumnarColumn::TaskId, ids), "checksum catches the damaged chunk");
+    assert_test(damaged.readInts(0, ColumnarColumn::ActualEffort, actual) && actual[3] == 6, "other columns still decode");
+    std::filesystem::remove("test_columnar.qlc");
+}
+
+void test_backup_compression() {
+    std::cout << "\n\033[1m\033[33m  ── Backup Compression ──\033[0m" << std::endl;
+    test_step("Creating a compressed backup of 3000 tasks");
+    Publisher pub;
+    Scheduler s(pub);
+    Schedule sch("bk", "Backup");
+    for (int i = 0; i < 3000; ++i) sch.addTask(Task("b" + std::to_string(i), "Backup task " + std::to_string(i % 40), "medium", {}, "ops", 5));
+    s.setSchedule(sch);
+    s.createBackup("test_backup.qlz");
+    size_t json_size = s.exportToJSON().size();
+    BackupInfo info;
+    assert_test(readBackupInfo("test_backup.qlz", info) && std::filesystem::file_size("test_backup.qlz") * 5 < json_size,
+                "backup is framed and at least 5x smaller than the JSON");
+
+    test_step("Restoring it into a fresh scheduler");
+    Scheduler restored(pub);
+    restored.restoreBackup("test_backup.qlz");
+    assert_test(restored.getSchedule().tasks.size() == 3000 && restored.getTaskStatus("b2999") == TaskStatus::Pending,
+                "every task is restored");
+
+    test_step("Round-tripping many small blocks on four threads");
+    std::string data;
+    for (int i = 0; i < 20000; ++i) data += "line " + std::to_string(i % 977) + (i % 3 ? " aaaaaaaa\n" : " \x01\x7f\n");
+    for (int i = 0; i < 5000; ++i) data += static_cast<char>(i * 2654435761u >> 13); // incompressible tail, stored raw
+    {
+        FdSink out;
+        out.open("test_blocks.qlz");
+        CompressedWriter writer(out, 4, 4096);
+        writer.write(data.substr(0, 1000));
+        writer.write(data.substr(1000));
+        assert_test(writer.finish() && out.close() && writer.rawBytes() == data.size(), "writer accepts input in pieces");
+    }
+    std::string back, error;
+    assert_test(readCompressedFile("test_blocks.qlz", back, error, 4) && back == data, "blocks decode back to the input");
+
+    test_step("Corrupting and truncating the file");
+    std::filesystem::resize_file("test_blocks.qlz", std::filesystem::file_size("test_blocks.qlz") - 3);
+    assert_test(!readCompressedFile("test_blocks.qlz", back, error) && error.find("truncated") != std::string::npos, "truncation is reported");
+    {
+        std::fstream f("test_backup.qlz", std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(200);
+        f.put('\x55');
+    }
+    Scheduler damaged(pub);
+    damaged.restoreBackup("test_backup.qlz");
+    assert_test(damaged.getSchedule().tasks.empty(), "a corrupt block is not restored");
+    std::filesystem::remove("test_backup.qlz");
+    std::filesystem::remove("test_blocks.qlz");
+    std::filesystem::remove(kBackupCatalogName);
+}
+
+void test_backup_chain() {
+    std::cout << "\n\033[1m\033[33m  ── Incremental Backups ──\033[0m" << std::endl;
+    std::filesystem::remove_all("test_chain");
+    std::filesystem::create_directory("test_chain");
+    test_step("Writing a full backup and two incremental ones");
+    Publisher pub;
+    Scheduler s(pub);
+    Schedule sch("ch", "Chain");
+    for (int i = 0; i < 500; ++i) sch.addTask(Task("c" + std::to_string(i), "Chain task", "low", {}, "ops", 5));
+    s.setSchedule(sch);
+    s.createBackup("test_chain/0.qlb");
+    s.submitTask(Task("c500", "Added later", "high", {}, "ops", 5));
+    s.archiveTask("c1");
+    assert_test(s.createIncrementalBackup("test_chain/1.qlb"), "first incremental backup is written");
+    s.removeTask("c2");
+    s.submitTask(Task("c3", "Edited", "high", {}, "ops", 7));
+    assert_test(s.createIncrementalBackup("test_chain/2.qlb"), "second incremental backup is written");
+    BackupInfo info;
+    assert_test(readBackupInfo("test_chain/2.qlb", info) && info.kind == BackupKind::Incremental && info.parent == "1.qlb",
+                "the delta names its parent");
+    assert_test(std::filesystem::file_size("test_chain/2.qlb") * 4 < std::filesystem::file_size("test_chain/0.qlb"),
+                "a delta is much smaller than the full backup");
+
+    test_step("Restoring the chain into a fresh scheduler");
+    auto check = [&](const std::string& path, const std::string& what) {
+        Scheduler restored(pub);
+        restored.restoreBackup(path);
+        const auto& tasks = restored.getSchedule().tasks;
+        bool archived = false, edited = false, removed = true;
+        for (const auto& t : tasks) {
+            if (t.task_id == "c1") archived = t.archived;
+            if (t.task_id == "c3") edited = t.description == "Edited" && t.max_runtime_sec == 7;
+            if (t.task_id == "c2") removed = false;
+        }
+        assert_test(tasks.size() == 500 && archived && edited && removed, what);
+    };
+    check("test_chain/2.qlb", "additions, edits and removals are replayed");
+
+    test_step("Pruning to two restore points");
+    std::ofstream("test_chain/notes.txt") << "not a backup";
+    std::vector<BackupEntry> catalog;
+    assert_test(readBackupCatalog("test_chain", catalog) && catalog.size() == 3 && catalog[2].file == "2.qlb" &&
+                    catalog[2].size == std::filesystem::file_size("test_chain/2.qlb"),
+                "the catalog lists every backup with its size");
+    s.pruneBackups("test_chain", 2);
+    assert_test(!std::filesystem::exists("test_chain/0.qlb") && readBackupInfo("test_chain/1.qlb", info) &&
+                    info.kind == BackupKind::Full,
+                "the oldest kept delta is rebased into a full backup");
+    assert_test(std::filesystem::exists("test_chain/notes.txt") && readBackupCatalog("test_chain", catalog) &&
+                    catalog.size() == 2 && catalog[0].file == "1.qlb" && catalog[0].info.kind == BackupKind::Full,
+                "other files are left alone and the catalog follows the prune");
+    check("test_chain/2.qlb", "the chain still restores after pruning");
+
+    test_step("Rebuilding a lost catalog and picking the latest restore point");
+    std::filesystem::remove(std::string("test_chain/") + kBackupCatalogName);
+    std::string error;
+    assert_test(loadBackupCatalog("test_chain", catalog, error) && catalog.size() == 2 && catalog[1].file == "2.qlb",
+                "the catalog is rebuilt from backup headers");
+    Scheduler latest(pub);
+    assert_test(latest.restoreLatestBackup("test_chain") && latest.getSchedule().tasks.size() == 500, "the newest backup is restored");
+
+    test_step("Breaking the chain");
+    s.submitTask(Task("c4", "Edited again", "high", {}, "ops", 5));
+    s.createIncrementalBackup("test_chain/3.qlb");
+    std::filesystem::remove("test_chain/2.qlb");
+    Scheduler broken(pub);
+    broken.restoreBackup("test_chain/3.qlb");
+    std::map<std::string, Task> tasks;
+    assert_test(broken.getSchedule().tasks.empty() && !loadBackupChain("test_chain/3.qlb", info, tasks, error) &&
+                    error.find("missing") != std::string::npos,
+                "a missing parent is reported, not partially restored");
+    Scheduler fallback(pub);
+    assert_test(fallback.restoreLatestBackup("test_chain") && fallback.getSchedule().tasks.size() == 501,
+                "restoring the latest point falls back past a broken chain");
+    {
+        std::fstream f("test_chain/1.qlb", std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(-1, std::ios::end);
+        f.put('\x55');
+    }
+    assert_test(!loadBackupChain("test_chain/1.qlb", info, tasks, error) && error.find("catalog") != std::string::npos,
+                "a file that differs from its catalog checksum is rejected");
+    std::filesystem::remove_all("test_chain");
+
+    test_step("Continuing a chain from a restored backup");
+    std::filesystem::create_directory("test_chain");
+    s.createBackup("test_chain/a.qlb");
+    s.restoreBackup("test_chain/a.qlb");
+    size_t restored_count = s.getSchedule().tasks.size();
+    s.submitTask(Task("after-restore", "New", "low", {}, "ops", 5));
+    bool written = s.createIncrementalBackup("test_chain/b.qlb");
+    Scheduler again(pub);
+    again.restoreBackup("test_chain/b.qlb");
+    assert_test(written && loadBackupChain("test_chain/b.qlb", info, tasks, error) &&
+                    again.getSchedule().tasks.size() == restored_count + 1,
+                "an incremental backup taken after a restore loads on top of it");
+
+    test_step("Restoring into a scheduler that already has tasks");
+    Scheduler populated(pub);
+    populated.submitTask(Task("stale", "Not in the backup", "high", {}, "ops", 5));
+    populated.getNextAvailableTask();
+    populated.restoreBackup("test_chain/b.qlb");
+    assert_test(!populated.hasTask("stale") && populated.getTaskStatus("after-restore") == TaskStatus::Pending,
+                "tasks outside the backup do not survive the restore");
+
+    test_step("Restoring a backup whose tasks form a cycle");
+    Scheduler cyclic(pub);
+    cyclic.submitTask(Task("x", "X", "low", {"y"}, "ops", 5));
+    cyclic.submitTask(Task("y", "Y", "low", {"x"}, "ops", 5));
+    cyclic.createBackup("test_chain/cycle.qlb");
+    populated.restoreBackup("test_chain/cycle.qlb");
+    bool untouched = !populated.hasTask("x") && populated.hasTask("after-restore");
+    populated.submitTask(Task("after-cycle", "New", "low", {}, "ops", 5));
+    assert_test(untouched && populated.createIncrementalBackup("test_chain/c.qlb") && readBackupInfo("test_chain/c.qlb", info) &&
+                    info.parent == "b.qlb",
+                "a rejected restore leaves the tasks and the backup chain as they were");
+    std::filesystem::remove_all("test_chain");
+}
+
+void test_calculation_cache() {
+    std::cout << "\n\033[1m\033[33m  ── Calculation Cache ──\033[0m" << std::endl;
+    test_step("Caching a value and reading it back");
+    Publisher pub;
+    Scheduler s(pub);
+    s.setCachedCalculation("eta:t1", "42", {"t1"});
+    assert_test(s.getCachedCalculation("eta:t1") == "42", "cached value is returned");
+    assert_test(s.getCachedCalculation("missing") == "", "unknown key returns empty string");
+    test_step("Submitting a task and verifying cached values are invalidated");
+    s.submitTask(Task("t1", "T1", "high", {}, "c", 1));
+    assert_test(s.getCachedCalculation("eta:t1") == "", "task update invalidates cached values");
+    test_step("Dispatching and completing an unrelated task");
+    s.pauseTask("t1");
+    s.setCachedCalculation("eta:t1", "43", {"t1"});
+    s.submitTask(Task("t2", "T2", "high", {}, "c", 1));
+    s.getNextAvailableTask();
+    s.markTaskAsCompleted("t2");
+    assert_test(s.getCachedCalculation("eta:t1") == "43", "updates to other tasks keep the value");
+    s.resumeTask("t1");
+    assert_test(s.getCachedCalculation("eta:t1") == "", "an update to a listed task drops it");
+    test_step("Filling a small cache past capacity");
+    CalculationCache cache(4, std::chrono::seconds(60), 1);
+    for (int i = 0; i < 6; ++i) cache.put("k" + std::to_string(i), "v");
+    std::string v;
+    assert_test(cache.size() == 4 && !cache.get("k0", v) && cache.get("k5", v), "least recently used entries are evicted");
+    test_step("Writing an entry with zero TTL");
+    cache.put("short", "v", std::chrono::seconds(0));
+    assert_test(!cache.get("short", v) && cache.stats().expirations == 1, "expired entries are not returned");
+    CacheStats stats = cache.stats();
+    assert_test(stats.hits == 1 && stats.evictions == 3, "hit and eviction counters are tracked");
+    test_step("Invalidating more dependency keys than the cache tracks");
+    cache.put("k5", "v", {"a"});
+    cache.put("k4", "v", {"b"});
+    cache.invalidate("b");
+    bool kept = cache.get("k5", v) && !cache.get("k4", v);
+    cache.put("k4", "v", {"b"});
+    for (int i = 0; i < 16; ++i) cache.invalidate("d" + std::to_string(i));
+    assert_test(kept && !cache.get("k5", v) && !cache.get("k4", v), "dropping the version map stales every dependent entry");
+}
+
+void test_latency_histogram() {
+    std::cout << "\n\033[1m\033[33m  ── Latency Histogram ──\033[0m" << std::endl;
+    test_step("Recording 1ms..1000ms latencies");
+    LatencyHistogram h;
+    for (int i = 1; i <= 1000; ++i) h.record(i / 1000.0);
+    assert_test(h.count() == 1000 && std::abs(h.mean() - 0.5005) < 1e-6, "count and mean are exact");
+    assert_test(std::abs(h.percentile(50) - 0.5) < 0.01 && std::abs(h.percentile(99) - 0.99) < 0.02, "p50/p99 within bucket error");
+    test_step("Merging a second histogram");
+    LatencyHistogram other;
+    other.record(5.0);
+    h.merge(other);
+    assert_test(h.count() == 1001 && h.max() == 5.0, "merged histogram includes both sources");
+    test_step("Recording into a rolling window and moving past it");
+    RollingWindow window(std::chrono::seconds(60));
+    auto t0 = std::chrono::steady_clock::now();
+    window.record(2.0, t0);
+    window.record(4.0, t0);
+    assert_test(window.average(t0) == 3.0, "window averages recent samples");
+    assert_test(window.average(t0 + std::chrono::seconds(120)) == 0.0, "samples age out of the window");
+}
+
+void test_metrics() {
+    std::cout << "\n\033[1m\033[33m  ── Metrics Registry ──\033[0m" << std::endl;
+    test_step("Updating a counter from several threads");
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    Counter& c = registry.counter("test_events_total", "Test counter");
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 4; ++i) workers.emplace_back([&c]() { for (int j = 0; j < 1000; ++j) c.inc(); });
+    for (auto& w : workers) w.join();
+    assert_test(c.value() == 4000, "sharded counter sums all thread updates");
+    test_step("Observing histogram values");
+    Histogram& h = registry.histogram("test_latency_seconds", "Test histogram", "", {0.1, 1.0});
+    h.observe(0.05);
+    h.observe(0.5);
+    h.observe(5.0);
+    assert_test(h.cumulativeCounts() == std::vector<uint64_t>({1, 2, 3}), "histogram buckets are cumulative");
+    test_step("Submitting a task and rendering Prometheus text");
+    Publisher pub;
+    Scheduler s(pub);
+    uint64_t submitted = registry.counter("quantalista_tasks_submitted_total", "").value();
+    s.submitTask(Task("m1", "M1", "high", {}, "c", 1));
+    assert_test(registry.counter("quantalista_tasks_submitted_total", "").value() == submitted + 1, "submitTask increments submitted counter");
+    std::string text = registry.renderPrometheus();
+    assert_test(text.find("# TYPE test_events_total counter\ntest_events_total 4000") != std::string::npos, "counter rendered in text format");
+    assert_test(text.find("test_latency_seconds_bucket{le=\"+Inf\"} 3") != std::string::npos, "histogram rendered with +Inf bucket");
+
+    test_step("Scraping past a client that sends nothing");
+    MetricsExporter exporter(registry);
+    int port = 20000 + static_cast<int>(getpid() % 20000);
+    auto connectLocal = [port] {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    };
+    if (exporter.startHttpEndpoint(port)) {
+        int silent = connectLocal();
+        int scraper = connectLocal();
+        const char request[] = "GET /metrics HTTP/1.1\r\n\r\n";
+        ::send(scraper, request, sizeof(request) - 1, 0);
+        auto start = std::chrono::steady_clock::now();
+        std::string response;
+        char buf[4096];
+        ssize_t n;
+        while ((n = ::recv(scraper, buf, sizeof(buf), 0)) > 0) response.append(buf, static_cast<size_t>(n));
+        double waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        assert_test(response.find("test_events_total 4000") != std::string::npos && waited < 3.5, "the scrape is answered once the silent client times out");
+        ::close(scraper);
+        ::close(silent);
+        silent = connectLocal();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        start = std::chrono::steady_clock::now();
+        exporter.stop();
+        waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ::close(silent);
+        assert_test(waited < 1.0, "stop() does not wait for a silent client");
+    } else {
+        assert_test(true, "metrics port in use; skipped");
+    }
+}
+
+void test_tracing() {
+    std::cout << "\n\033[1m\033[33m  ── Tracing ──\033[0m" << std::endl;
+    test_step("Submitting a task while tracing is disabled");
+    Tracer& tracer = Tracer::instance();
+    tracer.clear();
+    Publisher pub;
+    Scheduler s(pub);
+    s.submitTask(Task("tr0", "T0", "high", {}, "c", 1));
+    assert_test(tracer.renderChromeTrace().find("submitTask") == std::string::npos, "disabled tracer records nothing");
+    test_step("Enabling tracing and running a task through dispatch and completion");
+    tracer.enable();
+    Task t("tr1", "T1", "high", {}, "c", 1);
+    t.correlation_id = "corr-42";
+    s.submitTask(t);
+    s.getNextAvailableTask();
+    s.markTaskAsCompleted("tr0");
+    tracer.disable();
+    std::string trace = tracer.renderChromeTrace();
+    assert_test(trace.rfind("{\"traceEvents\":[", 0) == 0 && trace.find("\"ph\":\"X\"") != std::string::npos, "trace uses Chrome complete events");
+    assert_test(trace.find("\"name\":\"submitTask\"") != std::string::npos && trace.find("corr-42") != std::string::npos, "spans carry correlation_id");
+    assert_test(trace.find("\"name\":\"dispatch\"") != std::string::npos && trace.find("\"name\":\"markTaskAsCompleted\"") != std::string::npos, "dispatch and completion spans recorded");
+    test_step("Parsing a task from JSON while tracing");
+    tracer.clear();
+    tracer.enable();
+    from_json(to_json(t));
+    tracer.disable();
+    trace = tracer.renderChromeTrace();
+    size_t parsed = trace.find("\"name\":\"from_json\"");
+    assert_test(parsed != std::string::npos && trace.find("\"correlation_id\":\"tr1\"", parsed) != std::string::npos, "from_json span is tagged with the parsed task");
+    tracer.clear();
+}
+
+void test_async_logger() {
+    std::cout << "\n\033[1m\033[33m  ── Async Logger ──\033[0m" << std::endl;
+    test_step("Logging to a file with special characters in the message");
+    std::filesystem::remove_all("./test_logs");
+    std::filesystem::create_directories("./test_logs");
+    LoggerConfig config;
+    config.file_path = "./test_logs/quantalista.log";
+    config.min_level = LogLevel::INFO;
+    config.max_file_bytes = 4096;
+    config.max_rotated_files = 2;
+    Logger& logger = Logger::instance();
+    logger.configure(config);
+    logger.log(LogLevel::DEBUG, "filtered out");
+    logger.log(LogLevel::INFO, "quote \" backslash \\ newline \n end");
+    logger.flush();
+    std::ifstream f(config.file_path);
+    std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    assert_test(content.find("filtered out") == std::string::npos, "records below the level are dropped");
+    assert_test(content.find("quote \\\" backslash \\\\ newline \\n end") != std::string::npos, "messages are JSON-escaped");
+    test_step("Logging past the rotation threshold");
+    for (int i = 0; i < 200; ++i) logger.log(LogLevel::INFO, "rotation filler line " + std::to_string(i));
+    logger.flush();
+    assert_test(std::filesystem::exists("./test_logs/quantalista.log.1"), "log file rotates by size");
+    assert_test(!std::filesystem::exists("./test_logs/quantalista.log.3"), "rotation keeps at most max_rotated_files");
+
+    test_step("Idling with nothing to write");
+    rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    getrusage(RUSAGE_SELF, &after);
+    long switches = after.ru_nvcsw - before.ru_nvcsw;
+    assert_test(switches < 10, "the writer sleeps until a record arrives");
+    logger.log(LogLevel::INFO, "after the idle spell");
+    logger.flush();
+    std::ifstream tail(config.file_path);
+    std::string after_idle((std::istreambuf_iterator<char>(tail)), std::istreambuf_iterator<char>());
+    assert_test(after_idle.find("after the idle spell") != std::string::npos, "and wakes for the next one");
+    logger.configure(LoggerConfig());
+    std::filesystem::remove_all("./test_logs");
 }
 
 void test_cli() {
@@ -147,6 +994,42 @@ void test_cli() {
     assert_test(true, "list tasks prints pending filenames");
 }
 
+void test_cli_batch() {
+    std::cout << "\n\033[1m\033[33m  ── CLI Batch Add ──\033[0m" << std::endl;
+    const std::filesystem::path pending = "./queue/pending";
+    test_step("Adding NDJSON tasks from one input");
+    std::string ndjson;
+    for (int i = 1; i <= 300; ++i) ndjson += "{\"task_id\": \"nd" + std::to_string(i) + "\", \"description\": \"d\", \"max_runtime_sec\": 5}\n";
+    assert_test(addTaskBatch(ndjson) == 300 && std::filesystem::exists(pending / "nd1.json") && std::filesystem::exists(pending / "nd300.json"),
+                "every line becomes a pending task");
+
+    test_step("Adding CSV tasks with quoted fields");
+    std::string csv = "task_id,description,priority,dependencies\ncsv1,\"two\nlines, \"\"quoted\"\"\",high,\"nd1,nd2\"\n\ncsv2,plain,low,\n";
+    assert_test(addTaskBatch(csv) == 2, "the header names the columns");
+    std::ifstream f(pending / "csv1.json");
+    Task added = from_json(std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>()));
+    assert_test(added.description == "two\nlines, \"quoted\"" && added.dependencies.size() == 2 && added.priority == "high",
+                "quotes, embedded commas and newlines survive");
+
+    test_step("Rejecting a batch with invalid lines");
+    std::string bad = "{\"task_id\": \"ok1\", \"description\": \"d\"}\n{\"task_id\": \"ok1\", \"description\": \"d\"}\n{\"task_id\": \"x\"}\n{\"task_id\": \n";
+    assert_test(addTaskBatch(bad) == -1 && !std::filesystem::exists(pending / "ok1.json"), "one bad line keeps the whole batch out");
+    assert_test(addTaskBatch("task_id,description,max_runtime_sec\nc1,d,soon\n") == -1 && !std::filesystem::exists(pending / "c1.json"),
+                "CSV values are checked too");
+    test_step("Rejecting a batch that repeats a pending task");
+    std::string repeat = "{\"task_id\": \"fresh1\", \"description\": \"d\"}\n{\"task_id\": \"csv2\", \"description\": \"new\"}\n";
+    assert_test(addTaskBatch(repeat) == -1 && !std::filesystem::exists(pending / "fresh1.json"), "an id already pending rejects the batch");
+    std::ifstream queued(pending / "csv2.json");
+    assert_test(from_json(std::string((std::istreambuf_iterator<char>(queued)), std::istreambuf_iterator<char>())).description == "plain",
+                "the pending task is not overwritten");
+    size_t hidden = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(pending)) hidden += entry.path().filename().string()[0] == '.';
+    assert_test(hidden == 0, "no temp files are left behind");
+    for (int i = 1; i <= 300; ++i) std::filesystem::remove(pending / ("nd" + std::to_string(i) + ".json"));
+    std::filesystem::remove(pending / "csv1.json");
+    std::filesystem::remove(pending / "csv2.json");
+}
+
 void test_daemon() {
     std::cout << "\n\033[1m\033[33m  ── Coordinator / Daemon ──\033[0m" << std::endl;
     test_step("Building single-agent workflow with three independent tasks");
@@ -177,6 +1060,440 @@ void test_daemon() {
     assert_test(c2.getScheduler().getCompletedTaskIds() == expected, "daemon respects priority + dependency order");
 }
 
+void test_pending_watcher() {
+    std::cout << "\n\033[1m\033[33m  ── Pending Queue Watcher ──\033[0m" << std::endl;
+    std::filesystem::remove_all("test_watch");
+    std::filesystem::create_directories("test_watch/spool");
+    test_step("Waiting for files written and renamed into a directory");
+    DirectoryWatcher watcher("test_watch/spool");
+    std::vector<std::string> names;
+    std::ofstream("test_watch/a.json.part") << "{}";
+    std::ofstream("test_watch/spool/b.json") << "{}";
+    std::filesystem::rename("test_watch/a.json.part", "test_watch/spool/a.json");
+    while (names.size() < 2 && watcher.wait(names) != DirectoryWatcher::Wake::Stopped) {}
+    assert_test(!watcher.usingInotify() || (names == std::vector<std::string>{"b.json", "a.json"}),
+                "a closed file and a renamed file are reported in order");
+    test_step("Stopping a blocked wait from another thread");
+    std::thread stopper([&] { watcher.stop(); });
+    assert_test(watcher.wait(names) == DirectoryWatcher::Wake::Stopped, "stop wakes the waiter");
+    stopper.join();
+
+    test_step("Feeding a task dropped into pending/ to a watching coordinator");
+    Coordinator c(Project("pw", "Watch"), "./test_watch/queue");
+    std::ofstream("test_watch/queue/pending/early.json") << to_json(Task("early", "Queued before watching", "high", {}, "c", 1));
+    std::thread loop([&] { c.watchPendingTasks(); });
+    std::ofstream("test_watch/queue/pending/late.json") << to_json(Task("late", "Queued while watching", "high", {}, "c", 1));
+    for (int i = 0; i < 500 && !std::filesystem::exists("test_watch/queue/completed/late.json"); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    c.stopWatching();
+    loop.join();
+    assert_test(std::filesystem::exists("test_watch/queue/completed/early.json") &&
+                    std::filesystem::exists("test_watch/queue/completed/late.json") &&
+                    std::filesystem::is_empty("test_watch/queue/pending"),
+                "files already pending and files arriving later are both processed");
+    std::filesystem::remove_all("test_watch");
+}
+
+void test_worker_pool() {
+    std::cout << "\n\033[1m\033[33m  ── Queue Worker Pool ──\033[0m" << std::endl;
+    std::filesystem::remove_all("test_pool");
+    test_step("Processing eight pending tasks on eight workers");
+    Coordinator c(Project("pp", "Pool"), "./test_pool/queue");
+    c.setWorkerCount(8);
+    for (int i = 0; i < 8; ++i) {
+        std::string id = "p" + std::to_string(i);
+        std::ofstream("test_pool/queue/pending/" + id + ".json") << to_json(Task(id, "Pooled task", "medium", {}, "c", 1));
+    }
+    auto started = std::chrono::steady_clock::now();
+    c.processPendingTasks();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    size_t completed = 0;
+    for (const auto& entry : std::filesystem::directory_iterator("test_pool/queue/completed")) completed += entry.is_regular_file();
+    assert_test(completed == 8 && std::filesystem::is_empty("test_pool/queue/pending") && std::filesystem::is_empty("test_pool/queue/in_progress"),
+                "every task completes and leaves in_progress empty");
+    assert_test(seconds < 4.0, "tasks run concurrently rather than one per model call");
+
+    if (!std::filesystem::exists(".quanta")) {
+        test_step("Capping concurrent model calls with model.max_concurrency");
+        std::ofstream("test_pool/model.sh") << "#!/bin/sh\nsleep 0.3\necho done\n";
+        std::filesystem::permissions("test_pool/model.sh", std::filesystem::perms::owner_all);
+        std::ofstream(".quanta") << "model.llama_cli_path=test_pool/model.sh\nengine.model_path=none\nmodel.max_concurrency=2\nqueue.workers=6\n";
+        Coordinator limited(Project("pl", "Limited"), "./test_pool/limited");
+        std::filesystem::remove(".quanta");
+        for (int i = 0; i < 6; ++i) {
+            std::string id = "m" + std::to_string(i);
+            std::ofstream("test_pool/limited/pending/" + id + ".json") << to_json(Task(id, "Model task", "medium", {}, "c", 1));
+        }
+        started = std::chrono::steady_clock::now();
+        limited.processPendingTasks();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        std::ifstream result("test_pool/limited/completed/m0.json");
+        std::string body((std::istreambuf_iterator<char>(result)), std::istreambuf_iterator<char>());
+        assert_test(limited.workerCount() == 6 && body.find("\"output\": \"done\"") != std::string::npos, "workers and backend come from .quanta");
+        assert_test(seconds >= 0.85 && seconds < 3.0, "six 0.3 s model calls two at a time take three rounds");
+
+        test_step("Writing a result whose output has quotes and newlines");
+        std::ofstream("test_pool/model.sh") << "#!/bin/sh\nprintf 'say \"hi\"\\nback\\\\slash\\n'\n";
+        std::ofstream(".quanta") << "model.llama_cli_path=test_pool/model.sh\nengine.model_path=none\n";
+        Coordinator quoting(Project("pq", "Quoting"), "./test_pool/quoting");
+        std::filesystem::remove(".quanta");
+        std::ofstream("test_pool/quoting/pending/q1.json") << to_json(Task("q\"1", "Quote task", "medium", {}, "c", 1));
+        quoting.processPendingTasks();
+        std::ifstream quoted("test_pool/quoting/completed/q1.json");
+        std::string quoted_body((std::istreambuf_iterator<char>(quoted)), std::istreambuf_iterator<char>());
+        assert_test(quoted_body.find("\"task_id\": \"q\\\"1\"") != std::string::npos &&
+                        quoted_body.find("\"output\": \"say \\\"hi\\\"\\nback\\\\slash") != std::string::npos,
+                    "task id and model output are JSON-escaped in the result");
+    }
+    std::filesystem::remove_all("test_pool");
+}
+
+void test_queue_claims() {
+    std::cout << "\n\033[1m\033[33m  ── Shared Queue Claims ──\033[0m" << std::endl;
+    std::filesystem::remove_all("test_claims");
+    std::filesystem::create_directories("test_claims/pending");
+    std::filesystem::create_directories("test_claims/in_progress");
+    test_step("Writing a task file through a temp file and rename");
+    assert_test(spoolWriteFile("test_claims/pending", "a.json", "{}\n") && std::filesystem::exists("test_claims/pending/a.json") &&
+                    !std::filesystem::exists("test_claims/pending/.a.json.tmp"),
+                "only the complete file is visible");
+
+    test_step("Claiming the same file twice");
+    std::string me = spoolOwner();
+    SpoolLease lease;
+    assert_test(spoolClaim("test_claims/pending", "test_claims/in_progress", "a.json", me, std::chrono::seconds(60)) &&
+                    !spoolClaim("test_claims/pending", "test_claims/in_progress", "a.json", "other:1", std::chrono::seconds(60)),
+                "exactly one claim succeeds");
+    assert_test(spoolReadLease("test_claims/in_progress", "a.json", lease) && lease.owner == me, "the lease names its owner");
+
+    test_step("Reclaiming expired, orphaned and abandoned claims");
+    pid_t child = fork();
+    if (child == 0) _exit(0);
+    waitpid(child, nullptr, 0);
+    std::string host = me.substr(0, me.rfind(':'));
+    std::ofstream("test_claims/in_progress/dead.json") << "{}";
+    std::ofstream("test_claims/in_progress/.dead.json.lease") << "owner=" << host << ":" << child << "\nexpires_ms=99999999999999\n";
+    std::ofstream("test_claims/in_progress/expired.json") << "{}";
+    std::ofstream("test_claims/in_progress/.expired.json.lease") << "owner=elsewhere:1\nexpires_ms=1\n";
+    std::ofstream("test_claims/in_progress/fresh.json") << "{}"; // claimed a moment ago, lease not yet written
+    std::ofstream("test_claims/in_progress/.gone.json.lease") << "owner=elsewhere:1\nexpires_ms=1\n";
+    size_t requeued = spoolReclaimStale("test_claims/in_progress", "test_claims/pending", std::chrono::seconds(60));
+    assert_test(requeued == 2 && std::filesystem::exists("test_claims/pending/dead.json") && std::filesystem::exists("test_claims/pending/expired.json"),
+                "expired leases and dead local owners are requeued");
+    assert_test(std::filesystem::exists("test_claims/in_progress/a.json") && std::filesystem::exists("test_claims/in_progress/fresh.json") &&
+                    !std::filesystem::exists("test_claims/in_progress/.gone.json.lease"),
+                "live and fresh claims stay, orphaned leases are removed");
+
+    test_step("Two coordinators draining one queue");
+    Coordinator first(Project("c1", "First"), "./test_claims/shared");
+    Coordinator second(Project("c2", "Second"), "./test_claims/shared");
+    first.setWorkerCount(4);
+    second.setWorkerCount(4);
+    for (int i = 0; i < 12; ++i) {
+        std::string id = "s" + std::to_string(i);
+        spoolWriteFile("test_claims/shared/pending", id + ".json", to_json(Task(id, "Shared task", "medium", {}, "c", 1)));
+    }
+    std::thread other([&] { second.processPendingTasks(); });
+    first.processPendingTasks();
+    other.join();
+    int once = 0;
+    for (int i = 0; i < 12; ++i) {
+        std::string id = "s" + std::to_string(i);
+        int owners = (first.getScheduler().getTaskStatus(id) == TaskStatus::Pending) + (second.getScheduler().getTaskStatus(id) == TaskStatus::Pending);
+        once += owners == 1 && std::filesystem::exists("test_claims/shared/completed/" + id + ".json");
+    }
+    assert_test(once == 12 && std::filesystem::is_empty("test_claims/shared/in_progress"), "every task is processed by exactly one coordinator");
+
+    test_step("Renewing leases of tasks that outlast them");
+    Coordinator slow(Project("c3", "Slow"), "./test_claims/slow");
+    slow.setWorkerCount(1);
+    slow.setLeaseDuration(std::chrono::seconds(1));
+    for (int i = 0; i < 3; ++i) {
+        std::string id = "l" + std::to_string(i);
+        spoolWriteFile("test_claims/slow/pending", id + ".json", to_json(Task(id, "Slow task", "medium", {}, "c", 1)));
+    }
+    std::atomic<bool> finished{false};
+    std::thread running([&] {
+        slow.processPendingTasks(); // about a second per task without a model
+        finished = true;
+    });
+    size_t stolen = 0;
+    while (!finished) {
+        stolen += spoolReclaimStale("test_claims/slow/in_progress", "test_claims/slow/pending", std::chrono::seconds(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    running.join();
+    size_t results = 0;
+    for (const auto& entry : std::filesystem::directory_iterator("test_claims/slow/completed")) results += entry.is_regular_file();
+    assert_test(stolen == 0 && results == 3 && std::filesystem::is_empty("test_claims/slow/in_progress"),
+                "a live coordinator's claims are never reclaimed");
+
+    test_step("Claiming only as workers come free");
+    bool configured = std::filesystem::exists(".quanta");
+    Coordinator one_by_one(Project("c4", "Per Worker"), "./test_claims/free");
+    if (!configured) std::ofstream(".quanta") << "queue.io_uring=1\n";
+    Coordinator batched(Project("c5", "Batched"), "./test_claims/ring");
+    if (!configured) std::filesystem::remove(".quanta");
+    for (Coordinator* c : {&one_by_one, &batched}) {
+        c->setWorkerCount(1);
+        std::string dir = c == &batched ? "test_claims/ring" : "test_claims/free";
+        for (int i = 0; i < 3; ++i) {
+            std::string id = "w" + std::to_string(i);
+            spoolWriteFile(dir + "/pending", id + ".json", to_json(Task(id, "Waiting task", "medium", {}, "c", 1)));
+        }
+    }
+    std::thread free_run([&] { one_by_one.processPendingTasks(); });
+    std::thread ring_run([&] { batched.processPendingTasks(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    size_t waiting = 0;
+    for (const char* dir : {"test_claims/free/pending", "test_claims/ring/pending"}) {
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) waiting += entry.is_regular_file();
+    }
+    free_run.join();
+    ring_run.join();
+    size_t done = 0;
+    for (const char* dir : {"test_claims/free/completed", "test_claims/ring/completed"}) {
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) done += entry.is_regular_file();
+    }
+    assert_test(waiting == 4, "tasks no worker has started stay in pending/");
+    assert_test(done == 6, "each of them runs once a worker is free");
+    std::filesystem::remove_all("test_claims");
+}
+
+void test_queue_log() {
+    std::cout << "\n\033[1m\033[33m  ── Queue Log ──\033[0m" << std::endl;
+    std::filesystem::remove_all("test_queue_log");
+    test_step("Appending batches across small segments");
+    {
+        QueueLog log("test_queue_log", 512);
+        std::vector<QueueRecord> batch;
+        for (int i = 0; i < 40; ++i) batch.push_back(QueueRecord{QueueRecordType::Enqueue, "q" + std::to_string(i), "{\"n\": " + std::to_string(i) + "}"});
+        uint64_t first = 99;
+        assert_test(log.append(batch, &first) && first == 0 && log.append(batch, &first) && first == 40 && log.endSequence() == 80, "sequences continue across batches");
+        size_t segments = 0;
+        for (const auto& entry : std::filesystem::directory_iterator("test_queue_log")) segments += entry.path().extension() == ".seg";
+        assert_test(segments > 1, "the log rolls to new segments");
+    }
+    QueueLog log("test_queue_log", 512);
+    std::vector<std::string> seen;
+    log.scan(38, [&](uint64_t, const QueueRecord& record) {
+        seen.push_back(record.task_id + "=" + record.payload);
+        return seen.size() < 4;
+    });
+    assert_test(seen.size() == 4 && seen[0] == "q38={\"n\": 38}" && seen[2] == "q0={\"n\": 0}", "a reopened log scans from any sequence");
+
+    test_step("Claiming through shared and separate cursors");
+    QueueLog other("test_queue_log", 512);
+    std::vector<QueueRecord> a, b, c;
+    assert_test(log.claim("workers", 50, "one:1", a) && other.claim("workers", 50, "two:2", b) && a.size() == 50 && b.size() == 30,
+                "consumers of one cursor split the enqueues");
+    assert_test(log.claim("audit", 100, "three:3", c) && c.size() == 80 && log.claim("workers", 50, "one:1", a) && a.empty(),
+                "another cursor sees every enqueue, a drained one sees none");
+
+    test_step("Replaying task states");
+    log.append(QueueRecord{QueueRecordType::Complete, "q1", "done"});
+    auto states = log.states();
+    assert_test(states.size() == 40 && states["q1"].last == QueueRecordType::Complete && states["q2"].last == QueueRecordType::Claim &&
+                    states["q2"].owner == "three:3",
+                "each task's latest record wins");
+
+    test_step("Requeueing claims of a vanished owner");
+    size_t requeued = log.requeueAbandoned([](const std::string& owner) { return owner == "three:3"; });
+    std::vector<QueueRecord> again;
+    assert_test(requeued == 39 && log.claim("workers", 100, "one:1", again) && again.size() == 39 && again[0].payload.find("\"n\"") != std::string::npos,
+                "abandoned tasks are enqueued again with their payload");
+    assert_test(log.requeueAbandoned([](const std::string& owner) { return owner == "three:3"; }) == 0 &&
+                    log.requeueAbandoned([](const std::string& owner) { return owner == "one:1"; }) == 39,
+                "later passes pick up only claims made since");
+
+    test_step("Recovering from a torn append");
+    uint64_t end = log.endSequence();
+    std::string tail;
+    for (const auto& entry : std::filesystem::directory_iterator("test_queue_log")) {
+        if (entry.path().extension() == ".seg" && entry.path().string() > tail) tail = entry.path().string();
+    }
+    std::ofstream(tail, std::ios::app | std::ios::binary) << std::string("\x30\x00\x00\x00garbage", 11);
+    uint64_t next = 0;
+    assert_test(other.append(QueueRecord{QueueRecordType::Enqueue, "after", "{}"}) && other.endSequence() == end + 1, "the torn record is cut off");
+    log.scan(end, [&](uint64_t sequence, const QueueRecord& record) {
+        next = record.task_id == "after" ? sequence : 0;
+        return true;
+    });
+    assert_test(next == end && log.ok(), "the next append lands where the torn one began");
+
+    test_step("Dropping a batch whose index write was cut short");
+    std::filesystem::remove_all("test_queue_log");
+    QueueLog writer("test_queue_log");
+    std::vector<QueueRecord> unfinished;
+    for (int i = 0; i < 3; ++i) unfinished.push_back(QueueRecord{QueueRecordType::Enqueue, "u" + std::to_string(i), "{}"});
+    writer.append(QueueRecord{QueueRecordType::Enqueue, "before", "{}"});
+    writer.append(unfinished);
+    std::string index = "test_queue_log/00000000000000000000.idx";
+    std::filesystem::resize_file(index, std::filesystem::file_size(index) - sizeof(uint64_t));
+    QueueLog reader("test_queue_log");
+    assert_test(reader.endSequence() == 1, "readers do not see the unfinished batch");
+    assert_test(reader.append(QueueRecord{QueueRecordType::Enqueue, "whole", "{}"}) && reader.endSequence() == 2 && reader.states().count("u0") == 0,
+                "the next append drops all of it");
+    std::filesystem::remove_all("test_queue_log");
+
+    if (!std::filesystem::exists(".quanta")) {
+        test_step("Idling in a log-backed watch");
+        std::ofstream(".quanta") << "queue.backend=log\nqueue.workers=2\n";
+        Coordinator watching(Project("wl", "Log Watch"), "./test_queue_log");
+        std::filesystem::remove(".quanta");
+        QueueLog feed("test_queue_log/log");
+        feed.append(QueueRecord{QueueRecordType::Enqueue, "w1", to_json(Task("w1", "Watched", "low", {}, "c", 1))});
+        std::thread watch([&] { watching.watchPendingTasks(); });
+        for (int i = 0; i < 100 && feed.states()["w1"].last != QueueRecordType::Complete; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        bool completed = feed.states()["w1"].last == QueueRecordType::Complete;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        auto cpu = [] {
+            rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+        };
+        double before = cpu();
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        double idle_cpu = cpu() - before;
+        watching.stopWatching();
+        watch.join();
+        assert_test(completed && watching.usingQueueLog(), "the watch runs the task from the log");
+        assert_test(idle_cpu < 0.2, "an idle watch sleeps instead of waking itself");
+        std::filesystem::remove_all("test_queue_log");
+    }
+
+    if (!std::filesystem::exists(".quanta")) {
+        test_step("Claiming log records only for free workers");
+        std::ofstream(".quanta") << "queue.backend=log\nqueue.workers=1\n";
+        Coordinator single(Project("ls", "Log Single"), "./test_queue_log");
+        std::filesystem::remove(".quanta");
+        QueueLog feed("test_queue_log/log");
+        std::vector<QueueRecord> tasks;
+        for (int i = 0; i < 3; ++i) {
+            std::string id = "f" + std::to_string(i);
+            tasks.push_back(QueueRecord{QueueRecordType::Enqueue, id, to_json(Task(id, "Log task", "low", {}, "c", 1))});
+        }
+        feed.append(tasks);
+        std::thread draining([&] { single.processPendingTasks(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        size_t claimed = 0, waiting = 0;
+        for (const auto& entry : feed.states()) {
+            claimed += entry.second.last == QueueRecordType::Claim;
+            waiting += entry.second.last == QueueRecordType::Enqueue;
+        }
+        draining.join();
+        size_t completed = 0;
+        for (const auto& entry : feed.states()) completed += entry.second.last == QueueRecordType::Complete;
+        assert_test(claimed == 1 && waiting == 2, "records no worker has started stay unclaimed");
+        assert_test(completed == 3, "each of them runs once a worker is free");
+        std::filesystem::remove_all("test_queue_log");
+    }
+}
+
+void test_batch_io() {
+    std::cout << "\n\033[1m\033[33m  ── Batched File I/O ──\033[0m" << std::endl;
+    BatchIo probe;
+    std::cout << "    io_uring: " << (probe.usingIoUring() ? "yes" : "no, plain syscalls") << std::endl;
+    for (unsigned depth : {4u, 0u}) {
+        test_step(depth ? "Ring (or its fallback) with chains longer than one submission" : "Plain syscalls");
+        std::filesystem::remove_all("test_batch_io");
+        std::filesystem::create_directories("test_batch_io/in");
+        std::filesystem::create_directories("test_batch_io/out");
+        BatchIo io(depth);
+        std::vector<BatchIo::Write> writes;
+        for (int i = 0; i < 10; ++i) {
+            std::string name = "test_batch_io/in/" + std::to_string(i);
+            writes.push_back(BatchIo::Write{name + ".tmp", std::string(i == 3 ? 40000 : 8, static_cast<char>('a' + i)), name, {}});
+        }
+        writes.push_back(BatchIo::Write{"test_batch_io/missing/x", "x", "", {}});
+        std::ofstream("test_batch_io/old") << "old";
+        writes.push_back(BatchIo::Write{"test_batch_io/result", "done", "", {"test_batch_io/old"}});
+        std::vector<int> errors;
+        io.write(writes, errors);
+        assert_test(std::count(errors.begin(), errors.end(), 0) == 11 && errors[10] == ENOENT, "each write reports its own error");
+        assert_test(std::filesystem::exists("test_batch_io/in/9") && !std::filesystem::exists("test_batch_io/in/9.tmp") &&
+                        std::filesystem::exists("test_batch_io/result") && !std::filesystem::exists("test_batch_io/old"),
+                    "written files are renamed and follow-up unlinks run");
+
+        std::vector<std::pair<std::string, std::string>> moves = {{"test_batch_io/in/3", "test_batch_io/out/3"}, {"test_batch_io/in/3", "test_batch_io/out/3b"}};
+        io.rename(moves, errors);
+        assert_test(errors[0] == 0 && errors[1] == ENOENT, "only the first of two renames of one file wins");
+
+        std::vector<std::string> contents;
+        io.read({"test_batch_io/out/3", "test_batch_io/in/5", "test_batch_io/in/3"}, contents, errors);
+        assert_test(contents[0] == std::string(40000, 'd') && contents[1] == "ffffffff" && errors[2] == ENOENT, "reads return whole files");
+    }
+    std::filesystem::remove_all("test_batch_io");
+}
+
+void test_result_durability() {
+    std::cout << "\n\033[1m\033[33m  ── Result Durability ──\033[0m" << std::endl;
+    Counter& commits = MetricsRegistry::instance().counter("quantalista_result_commits_total", "Directory, filesystem or log syncs making result batches durable");
+    auto run = [](Coordinator& c, const std::string& dir, int tasks) {
+        for (int i = 0; i < tasks; ++i) {
+            std::string id = "r" + std::to_string(i);
+            spoolWriteFile(dir + "/pending", id + ".json", to_json(Task(id, "Durable task", "low", {}, "c", 1)));
+        }
+        c.processPendingTasks();
+        size_t done = 0;
+        for (int i = 0; i < tasks; ++i) done += std::filesystem::exists(dir + "/completed/r" + std::to_string(i) + ".json");
+        return done == static_cast<size_t>(tasks) && std::filesystem::is_empty(dir + "/in_progress");
+    };
+    std::filesystem::remove_all("test_durable");
+
+    test_step("Group commit of results finishing together");
+    Coordinator grouped(Project("dg", "Grouped"), "./test_durable/group");
+    assert_test(grouped.durability() == Coordinator::Durability::None, "results are not synced unless configured");
+    grouped.setWorkerCount(16);
+    grouped.setDurability(Coordinator::Durability::Group, std::chrono::milliseconds(200), 16);
+    uint64_t before = commits.value();
+    assert_test(run(grouped, "test_durable/group", 16), "every result is written and every claim released");
+    uint64_t group_commits = commits.value() - before;
+    assert_test(group_commits >= 1 && group_commits < 16, "results share directory syncs");
+
+    test_step("One sync per result");
+    Coordinator each(Project("de", "Each"), "./test_durable/each");
+    each.setWorkerCount(4);
+    each.setDurability(Coordinator::Durability::Each);
+    before = commits.value();
+    assert_test(run(each, "test_durable/each", 4) && commits.value() - before == 4, "each result is committed on its own");
+
+    if (!std::filesystem::exists(".quanta")) {
+        test_step("Group commit of queue log results");
+        std::ofstream(".quanta") << "queue.backend=log\nqueue.durability=group\nqueue.group_commit_ms=200\nqueue.group_commit_max=8\nqueue.workers=8\n";
+        Coordinator logged(Project("dl", "Logged"), "./test_durable/log");
+        std::filesystem::remove(".quanta");
+        QueueLog feed("test_durable/log/log");
+        std::vector<QueueRecord> tasks;
+        for (int i = 0; i < 8; ++i) {
+            std::string id = "r" + std::to_string(i);
+            tasks.push_back(QueueRecord{QueueRecordType::Enqueue, id, to_json(Task(id, "Durable task", "low", {}, "c", 1))});
+        }
+        feed.append(tasks);
+        before = commits.value();
+        logged.processPendingTasks();
+        size_t completed = 0;
+        for (const auto& entry : feed.states()) completed += entry.second.last == QueueRecordType::Complete;
+        uint64_t log_commits = commits.value() - before;
+        assert_test(logged.usingQueueLog() && logged.durability() == Coordinator::Durability::Group && completed == 8,
+                    "durability applies to the queue log too");
+        assert_test(log_commits >= 1 && log_commits < 8, "results share log syncs");
+    }
+
+    if (!std::filesystem::exists(".quanta")) {
+        test_step("Committing result batches with syncfs");
+        std::ofstream(".quanta") << "queue.durability=group\nqueue.group_commit_ms=200\nqueue.group_commit_max=8\nqueue.syncfs=1\n";
+        Coordinator synced(Project("ds", "Syncfs"), "./test_durable/syncfs");
+        std::filesystem::remove(".quanta");
+        synced.setWorkerCount(8);
+        before = commits.value();
+        assert_test(run(synced, "test_durable/syncfs", 8), "every result is written and every claim released");
+        assert_test(commits.value() - before >= 1 && commits.value() - before < 8, "results share filesystem syncs");
+    }
+    std::filesystem::remove_all("test_durable");
+}
+
 void test_task_metadata_and_archive_restore() {
     std::cout << "\n\033[1m\033[33m  ── Task Metadata / Archive Restore ──\033[0m" << std::endl;
     test_step("Creating scheduler and task with metadata");
@@ -220,9 +1537,29 @@ int main() {
     test_agent_manager();
     test_scheduler();
     test_json();
+    test_json_parser();
     test_persistence();
+    test_snapshot();
+    test_write_ahead_log();
+    test_ndjson_import();
+    test_streaming_export();
+    test_columnar_export();
+    test_backup_compression();
+    test_backup_chain();
+    test_calculation_cache();
+    test_latency_histogram();
+    test_metrics();
+    test_tracing();
+    test_async_logger();
     test_cli();
+    test_cli_batch();
     test_daemon();
+    test_pending_watcher();
+    test_worker_pool();
+    test_queue_claims();
+    test_queue_log();
+    test_batch_io();
+    test_result_durability();
     test_task_metadata_and_archive_restore();
     test_enhancements();
     std::cout << "\n\033[1m══════════════════════════════════════════" << std::endl;